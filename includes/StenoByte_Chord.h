@@ -0,0 +1,147 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Chord.h is the header file for defining the Chord State of a session: the Bit Array that the held keys
+    form, and the byte last computed from it.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_CHORD_H
+#define STENOBYTE_CHORD_H
+
+#include <sys/types.h>
+#include <stdbool.h>
+
+// Number of Bits in the Bit Array, chosen at compile time: 8, 10, 12 or 16 (set with -DSTENOBYTE_CHORD_BITS=N)
+#ifndef STENOBYTE_CHORD_BITS
+# define STENOBYTE_CHORD_BITS 8
+#endif
+# define BITS_ARR_SIZE STENOBYTE_CHORD_BITS
+
+// The word a chord computes: a single byte for 8 keys, so that the 8-bit build keeps its byte-sized fast paths, and a
+// 16-bit word written out as two bytes for wider chords
+#if BITS_ARR_SIZE == 8
+typedef u_int8_t chord_word;
+#elif BITS_ARR_SIZE == 10 || BITS_ARR_SIZE == 12 || BITS_ARR_SIZE == 16
+typedef u_int16_t chord_word;
+#else
+# error "STENOBYTE_CHORD_BITS must be 8, 10, 12 or 16"
+#endif
+
+// Number of bytes each stroke writes out, and the number of distinct chords
+#define CHORD_WORD_SIZE ((BITS_ARR_SIZE + 7) / 8)
+#define CHORD_WORD_COUNT (1u << BITS_ARR_SIZE)
+
+enum stenobyte_mode {
+    NOT_SET = 0,
+    DEMO,
+    WRITER
+};
+
+// Chord Timing defaults, in milliseconds (0 turns the check off)
+#define DEFAULT_CHORD_WINDOW_MS 0
+#define DEFAULT_DEBOUNCE_MS 0
+
+// Order of the bytes a chord word is written out in (only matters when CHORD_WORD_SIZE is more than 1)
+enum chord_byte_order {
+    CHORD_LITTLE_ENDIAN = 0,    // Lowest byte first (b0 to b7, then b8 to b15)
+    CHORD_BIG_ENDIAN            // Highest byte first
+};
+
+// What computes the byte from the Bit Array
+enum chord_commit_mode {
+    COMMIT_ON_KEY = 0,  // Pressing the commit key (the space bar by default) computes the byte from the keys held
+    COMMIT_ON_RELEASE   // Releasing the last key of a chord computes the byte from every key held since its first press
+};
+
+// What a chord does instead of writing out its word, when it is committed with an edit key rather than the commit key.
+// The word gives how many times (0 counts as 1).
+enum chord_edit {
+    CHORD_EDIT_NONE = 0,    // The word is written out
+    CHORD_EDIT_BACKSPACE,   // Deletes the bytes before the cursor
+    CHORD_EDIT_UNDO,        // Takes back the last strokes & edits
+    CHORD_EDIT_LEFT,        // Moves the cursor back
+    CHORD_EDIT_RIGHT,       // Moves the cursor forward
+    CHORD_EDIT_END          // Moves the cursor to the end of the output
+};
+
+struct chord_state {
+    chord_word bit_arr_mask;    // Bit Array packed with b0 as the lowest bit; keys set & clear their bit as events
+                                // arrive
+    bool ready_to_compute_byte; // Whether to convert the bit array into a word and process it
+    chord_word current_word;    // The word last computed from the bit array (a byte in the 8-bit build)
+    u_int8_t edit;  // The chord's enum chord_edit: CHORD_EDIT_NONE unless it is committed with an edit key
+
+    // Chord Timing (COMMIT_ON_RELEASE), where bit_arr_mask is the union of the keys held since the chord's first press
+    enum chord_commit_mode commit_mode;
+    chord_word held_bit_mask;   // The bit keys held right now
+    bool commit_key_held;   // The commit key (or an edit key) on its own strokes 0x00, and adds nothing to a chord
+    u_int64_t chord_start_us;   // Kernel timestamp of the chord's first press
+    u_int64_t minimum_chord_us; // A chord released sooner than this after its first press is rejected as accidental
+    u_int64_t debounce_us;  // A key changing state again sooner than this after its last accepted change is a bounce
+    u_int64_t last_change_us[BITS_ARR_SIZE + 1];    // Kernel timestamp of each key's last accepted change, then the
+                                                    // commit & edit keys'
+};
+
+// Outcome of a key event in COMMIT_ON_RELEASE mode
+enum chord_stroke_result {
+    CHORD_STROKE_UPDATED = 0,   // The chord changed, or the event did not affect it
+    CHORD_STROKE_COMMITTED,     // The last key was released: the chord is ready to be computed
+    CHORD_STROKE_REJECTED,      // The last key was released before the minimum chord window
+    CHORD_STROKE_BOUNCE         // The key changed state within the debounce time, so the event was ignored
+};
+
+/*
+ * Gets the value (0 or 1) of a bit in the Bit Array
+ */
+static inline int get_bit(const struct chord_state* chord, const int bit_index) {
+    return chord->bit_arr_mask >> bit_index & 1;
+}
+
+/*
+ * Replaces the keys held with the ones a keyboard really reports, after the kernel dropped events or a keyboard was
+ * unplugged. In COMMIT_ON_RELEASE mode the chord keeps the keys it already had, unless no key is held any more: the
+ * release that ended it was lost, so the chord is dropped rather than committed late.
+ */
+static inline void resync_chord(struct chord_state* chord, const chord_word held_bit_mask) {
+    if (chord->commit_mode == COMMIT_ON_RELEASE) {
+        const bool chord_in_progress = chord->held_bit_mask != 0 || chord->commit_key_held;
+        chord->bit_arr_mask = held_bit_mask == 0 ? 0x00
+                                                 : (chord_in_progress ? chord->bit_arr_mask : 0x00) | held_bit_mask;
+        chord->held_bit_mask = held_bit_mask;
+        chord->commit_key_held = false;
+    } else {
+        chord->bit_arr_mask = held_bit_mask;
+    }
+}
+
+/*
+ * Splits a chord word into the bytes it is written out as, in the given byte order
+ */
+static inline void get_chord_word_bytes(const chord_word word, const enum chord_byte_order byte_order,
+                                        u_int8_t bytes[CHORD_WORD_SIZE]) {
+#if CHORD_WORD_SIZE == 1
+    (void) byte_order;
+    bytes[0] = word;
+#else
+    for (int i = 0; i < CHORD_WORD_SIZE; i++) {
+        const int shift = 8 * (byte_order == CHORD_BIG_ENDIAN ? CHORD_WORD_SIZE - 1 - i : i);
+        bytes[i] = (u_int8_t) (word >> shift);
+    }
+#endif
+}
+
+#endif //STENOBYTE_CHORD_H
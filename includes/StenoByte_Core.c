@@ -24,81 +24,216 @@
 #include "StenoByte_Core.h"
 
 // Arrays & Variables
-// Bit Array that contains the bits that forms a byte
-bool bit_arr[BITS_ARR_SIZE] = {0, 0, 0, 0, 0, 0, 0, 0}; // ordered from b0 to b7 during initialisation
-char keys_arr[BITS_ARR_SIZE] = {';', 'L', 'K', 'J', 'F', 'D', 'S', 'A'}; // ';' = b0, 'L' = b1, ... 'A' = b7
-u_int8_t subvalues_arr[BITS_ARR_SIZE];
-bool ready_to_compute_byte = false;  // the state for whether to convert the bit array into a byte and process it
-const char* output_file_path;  // The path to the file write to
-FILE *output_file_ptr;  // The pointer of the file itself to write to
-enum stenobyte_mode mode = NOT_SET;
-
-u_int8_t current_byte = 0x00;  // The byte last computed from the bit array
+char keys_arr[BITS_ARR_SIZE]; // Labels from the Keymap: ';' = b0, 'L' = b1, ... 'A' = b7 by default
+chord_word subvalues_arr[BITS_ARR_SIZE];
+static bool keymap_ready = false;   // Whether setup_stenobyte_keymap() has been called
 
 
 // Methods & Functions
 
-int setup_stenobyte_demo() {
+int setup_stenobyte_demo(struct stenobyte_session* session, int argc, const char* argv[]) {
+    // Reads the input settings from the Command Line Arguments
+    struct stenobyte_options options;
+    if (parse_stenobyte_options(&options, argc, argv) != 0) {
+        return 1;
+    }
+
     printf("Starting StenoType...\n");
-    mode = DEMO;
-    return setup_stenobyte();
+    return setup_stenobyte_cli_session(session, DEMO, &options);
 }
 
-int setup_stenobyte_writer(int argc, const char* argv[]) {
-    if (argc < 2) {
-        // Default File Path if none is provided
-        output_file_path = "./output.txt";
-    } else {
-        // File Path Provided by Command Line Arguments
-        output_file_path = argv[1];
+int setup_stenobyte_writer(struct stenobyte_session* session, int argc, const char* argv[]) {
+    // Reads the file path (default is "./output.txt") and output settings from the Command Line Arguments
+    struct stenobyte_options options;
+    if (parse_stenobyte_options(&options, argc, argv) != 0) {
+        return 1;
+    }
+
+    // With a stdout sink, stdout carries only the committed bytes, so everything else is printed to stderr
+    if (has_stdout_sink(options.sinks, options.sink_count) && reserve_stdout_for_sink() != 0) {
+        return 1;
+    }
+
+    printf("Welcome to StenoByte Writer.\nWriting to file: %s\n", options.output_file_path);
+    return setup_stenobyte_cli_session(session, WRITER, &options);
+}
+
+/*
+ * Byte Sink that adds a committed byte to the session's Output Engine, which writes it to the file according to its
+ * flush policy
+ */
+static int write_byte_to_output_engine(void* context, const u_int8_t byte) {
+    return push_byte_to_output(context, byte);
+}
+
+/*
+ * Edit Sink that applies an edit to the session's Output Engine
+ */
+static int apply_edit_to_output_engine(void* context, const enum chord_edit edit, const unsigned int count) {
+    return apply_output_edit(context, edit, count);
+}
+
+/*
+ * Resets every field of a session so that end_stenobyte() only releases what was set up, without opening anything.
+ * Committed bytes go to the session's Output Engine.
+ */
+void prepare_stenobyte_session(struct stenobyte_session* session, const enum stenobyte_mode mode,
+                               const struct stenobyte_options* options) {
+    memset(session, 0, sizeof(*session));
+    session->mode = mode;
+    session->options = *options;
+    session->output_engine.file_descriptor = -1;
+    session->output_engine.journal.file_descriptor = -1;
+    session->output_engine.fanout.epoll_file_descriptor = -1;
+    session->metrics_server.file_descriptor = -1;
+    session->event_source.file_descriptor = -1;
+    session->event_source.replay_file_descriptor = -1;
+    session->capture_recorder.file_descriptor = -1;
+    session->epoll_file_descriptor = -1;
+    session->wake_file_descriptor = -1;
+    session->pipelined = options->pipeline;
+    session->chord.commit_mode = options->commit_mode;
+    session->chord.minimum_chord_us = (u_int64_t) options->chord_window_ms * 1000u;
+    session->chord.debounce_us = (u_int64_t) options->debounce_ms * 1000u;
+    setup_stroke_translator(&session->translator, nullptr, options->dictionary_timeout_ms, options->byte_order);
+    setup_keyboard_set(&session->keyboards, options->device_path, options->grab, options->raw_input, -1);
+    setup_pipeline(&session->pipeline, session);
+    set_stenobyte_byte_sink(session, nullptr, nullptr);
+}
+
+/*
+ * Sets up the Keymap shared by every session, from a keymap file (or the default layout if keymap_file_path is
+ * nullptr), then labels the bits with their keys. Must be called once, before any session is set up; the Keymap and
+ * the labels are only read after that, so sessions can then be set up and run on any thread.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_stenobyte_keymap(const char* keymap_file_path) {
+    setup_subvalues_array();
+    if (keymap_file_path != nullptr && load_keymap_file(keymap_file_path, BITS_ARR_SIZE) != 0) {
+        return 1;
     }
+    get_keymap_labels(keys_arr, BITS_ARR_SIZE);
+    keymap_ready = true;
+    return 0;
+}
 
-    printf("Welcome to StenoByte Writer.\nWriting to file: %s\n", output_file_path);
-    output_file_ptr = fopen(output_file_path, "w");
-    mode = WRITER;
-    return setup_stenobyte();
+/*
+ * Sets up a session from its options: opens the output file in WRITER mode (rebuilding it from the Journal if the last
+ * session writing it did not end cleanly) and its sinks, then the event loop and its inputs.
+ * Without an output file path, committed bytes only reach the session's Byte Sink.
+ * The terminal and the process's signals are left alone, so a program can run several sessions at once. The Keymap
+ * must already be set up with setup_stenobyte_keymap(), as it is shared by every session; a session's options cannot
+ * give a keymap file of their own.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_stenobyte_session(struct stenobyte_session* session, const enum stenobyte_mode mode,
+                            const struct stenobyte_options* options) {
+    prepare_stenobyte_session(session, mode, options);
+    if (options->keymap_file_path != nullptr) {
+        fprintf(stderr, "A session cannot load a Keymap of its own; load it with setup_stenobyte_keymap() instead\n");
+        return 1;
+    }
+    if (!keymap_ready) {
+        fprintf(stderr, "The Keymap must be set up with setup_stenobyte_keymap() before a session\n");
+        return 1;
+    }
+    if (mode == WRITER && options->output_file_path != nullptr &&
+        setup_output_engine(&session->output_engine, options->output_file_path, options->output_mode,
+                            options->flush_policy, options->durability, options->flush_interval_ms) != 0) {
+        return 1;
+    }
+    if (mode == WRITER && options->output_file_path != nullptr) {
+        // Before the Journal, so that the bytes it recovers are encoded too
+        attach_output_encoder(&session->output_engine, options->output_encoding);
+    }
+    if (mode == WRITER && options->output_file_path != nullptr && options->edit &&
+        attach_output_editor(&session->output_engine) != 0) {
+        return 1;
+    }
+    if (mode == WRITER && options->output_file_path != nullptr && options->journal_file_path != nullptr &&
+        attach_output_journal(&session->output_engine, options->journal_file_path, options->journal_interval_ms) != 0) {
+        return 1;
+    }
+    if (mode == WRITER && options->output_file_path != nullptr && options->sink_count > 0 &&
+        attach_output_fanout(&session->output_engine, options->sinks, options->sink_count,
+                             options->sink_buffer_size) != 0) {
+        return 1;
+    }
+    if (mode == WRITER && options->dictionary_file_path != nullptr) {
+        if (load_dictionary_file(&session->dictionary, options->dictionary_file_path) != 0) {
+            return 1;
+        }
+        setup_stroke_translator(&session->translator, &session->dictionary, options->dictionary_timeout_ms,
+                                options->byte_order);
+    }
+    return setup_stenobyte(session);
 }
 
 /*
- * Generates the Byte based on the bits in the array
+ * Sends the committed bytes of a session to a callback instead of its Output Engine, or back to the Output Engine if
+ * write_byte is nullptr. Only the Output Engine takes edits, and only with --edit. Must be called before
+ * run_stenobyte().
  */
-void compute_byte() {
-    current_byte = 0x00;    // Resets the Byte to zero
-    for (int i = 0; i < BITS_ARR_SIZE; i++) {
-        current_byte = current_byte ^ bit_arr[i] << i;
+void set_stenobyte_byte_sink(struct stenobyte_session* session, const byte_sink_callback write_byte, void* context) {
+    if (write_byte == nullptr) {
+        session->byte_sink = (struct byte_sink) {
+            .write_byte = write_byte_to_output_engine,
+            .apply_edit = session->options.edit ? apply_edit_to_output_engine : nullptr,
+            .context = &session->output_engine
+        };
+    } else {
+        session->byte_sink = (struct byte_sink) {.write_byte = write_byte, .context = context};
     }
-    ready_to_compute_byte = false;
+}
+
+/*
+ * Generates the Byte (or the word, for chords wider than 8 bits) based on the bits in the array. The bits are already
+ * packed, so this is a single load.
+ */
+void compute_byte(struct chord_state* chord) {
+    chord->current_word = chord->bit_arr_mask;
+    chord->ready_to_compute_byte = false;
 }
 
 /*
  * Sets up the sub-values array for labelling
  */
 void setup_subvalues_array() {
-    for (int i = BITS_ARR_SIZE; i >= 0; i--) {
-        const u_int8_t val = 0;
-        subvalues_arr[i] = val ^ 1 << i;
+    for (int i = BITS_ARR_SIZE - 1; i >= 0; i--) {
+        subvalues_arr[i] = (chord_word) (1u << i);
     }
 }
 
 /*
  * Gets Byte Summary as a String (an array of chars)
- * Assumes msg has a minimum length of 35. Assumes value of current_byte will not exceed 255.
+ * Assumes msg has a minimum length of 72.
+ * The raw value is replaced by a space if it is not a printable character, so that it cannot break the layout. Words
+ * wider than a byte are shown in hex instead, in the same column, so that the Renderer can update both layouts.
  */
-void get_byte_summary(char* msg) {
-    sprintf(msg + strlen(msg), "Last Computed Byte as decimal: %d\n", current_byte);  // Prints between 33 and 35 chars
-    sprintf(msg + strlen(msg), R"(Last Computed Byte as Raw Value: %c)", (char) current_byte);
+void get_byte_summary(char* msg, const struct chord_state* chord) {
+    const chord_word current_word = chord->current_word;
+#if CHORD_WORD_SIZE == 1
+    sprintf(msg + strlen(msg), "Last Computed Byte as decimal: %d\n", current_word);  // Prints between 33 and 35 chars
+    sprintf(msg + strlen(msg), R"(Last Computed Byte as Raw Value: %c)",
+            isprint(current_word) ? (char) current_word : ' ');   // Prints 34 chars
+#else
+    sprintf(msg + strlen(msg), "Last Computed Word as decimal: %d\n", current_word);  // Prints between 33 and 37 chars
+    sprintf(msg + strlen(msg), "Last Computed Word as hex value: 0x%04X", current_word);   // Prints 39 chars
+#endif
 }
 
 /*
  * Prints the Byte Summary
  */
-void print_byte_summary() {
-    char msg[35];
-    get_byte_summary(msg);
+void print_byte_summary(const struct chord_state* chord) {
+    char msg[BYTE_SUMMARY_SIZE] = "";
+    get_byte_summary(msg, chord);
     printf("%s", msg);
 }
 
-void print_current_mode(char* msg) {
+void print_current_mode(char* msg, const enum stenobyte_mode mode) {
     // Min Chars Printed: 11
     // Max Chars Printed: 19
     sprintf(msg+strlen(msg), "Mode: "); // Prints 6 chars
@@ -122,57 +257,151 @@ void print_current_mode(char* msg) {
 }
 
 /*
- * Prints the current state of the Bit Array
- * TODO: The repeated for loops could probably be simplified into a dedicated method
+ * Gets the whole Bit Array Summary (the table, the last byte and the instructions) as a String.
+ * Each part is written at a running offset so that building the summary is linear in its length.
+ *
+ * Returns the number of chars written to msg, which must have a length of at least BIT_ARR_SUMMARY_SIZE
  */
-void print_bit_arr_summary() {
-    char msg[673] = "";
+int get_bit_arr_summary(char* msg, const enum stenobyte_mode mode, const struct chord_state* chord) {
+    int length = 0;
+    msg[0] = '\0';
 
-    print_current_mode(msg);    // Prints between 11 and 19 chars
-    sprintf(msg + strlen(msg), "\nBits in Array:\n");   // Prints 16 chars
-    sprintf(msg + strlen(msg), "\tBit Value:\t| "); // Prints 14 chars
-    for (int i = 7; i >= 0; i--) {  // Repeats 8 times
-        sprintf(msg + strlen(msg), "\t%d\t|", bit_arr[i]);  // Prints between 4 and 6 chars
+    print_current_mode(msg, mode);  // Prints between 11 and 19 chars
+    length = (int) strlen(msg);
+    length += sprintf(msg + length, "\nBits in Array:\n");   // Prints 16 chars
+    length += sprintf(msg + length, "\tBit Value:\t| "); // Prints 14 chars
+    for (int i = BITS_ARR_SIZE - 1; i >= 0; i--) {  // Repeats BITS_ARR_SIZE times
+        length += sprintf(msg + length, "\t%d\t|", get_bit(chord, i));  // Prints 4 chars
     }
-    sprintf(msg + strlen(msg), "\n");   // Prints 1 char
+    msg[length++] = '\n';
 
-    for (int i=0; i<24+16*BITS_ARR_SIZE; i++) { // Repeats 24+(16*8) times, which is 152
-        sprintf(msg + strlen(msg), "-");    // Prints 1 char
-    }
+    memset(msg + length, '-', SUMMARY_DIVIDER_LENGTH); // Prints 24+(16*BITS_ARR_SIZE) chars, 152 for 8 bits
+    length += SUMMARY_DIVIDER_LENGTH;
 
-    sprintf(msg + strlen(msg), "\n\tSub-Value:\t|");    // Prints 14 chars
-    for (int i = 7; i >= 0; i--) {  // Repeats 8 times
-        sprintf(msg + strlen(msg), "\t[%d]\t|", subvalues_arr[i]);  // Prints between 6 and 8 chars
+    length += sprintf(msg + length, "\n\tSub-Value:\t|");    // Prints 14 chars
+    for (int i = BITS_ARR_SIZE - 1; i >= 0; i--) {  // Repeats BITS_ARR_SIZE times
+        length += sprintf(msg + length, "\t[%d]\t|", subvalues_arr[i]);  // Prints between 6 and 10 chars
     }
 
-    sprintf(msg + strlen(msg), "\n\tBit Index:\t|");    // Prints 14 chars
-    for (int i = 7; i >= 0; i--) {  // Repeats 8 times
-        sprintf(msg + strlen(msg), "\t[b%d]\t|", i);    // Prints 7 chars
+    length += sprintf(msg + length, "\n\tBit Index:\t|");    // Prints 14 chars
+    for (int i = BITS_ARR_SIZE - 1; i >= 0; i--) {  // Repeats BITS_ARR_SIZE times
+        length += sprintf(msg + length, "\t[b%d]\t|", i);    // Prints 7 or 8 chars
     }
-    sprintf(msg + strlen(msg), "\n\tKey:\t\t|");    // Prints 9 times
+    length += sprintf(msg + length, "\n\tKey:\t\t|");    // Prints 9 chars
 
-    for (int i = 7; i >= 0; i--) {  // Repeats 8 times
-        sprintf(msg + strlen(msg), "\t[%c]\t|", keys_arr[i]);   // Prints 6 chars
+    for (int i = BITS_ARR_SIZE - 1; i >= 0; i--) {  // Repeats BITS_ARR_SIZE times
+        length += sprintf(msg + length, "\t[%c]\t|", keys_arr[i]);   // Prints 6 chars
     }
-    sprintf(msg + strlen(msg), "\n");   // Prints 1 char
-    get_byte_summary(msg);   // Prints between 33 and 35 chars
-    sprintf(msg + strlen(msg), "\nPress & Hold the keys corresponding to the bits in the"
+    msg[length++] = '\n';
+    msg[length] = '\0';
+    get_byte_summary(msg + length, chord);    // Prints between 67 and 76 chars
+    length += (int) strlen(msg + length);
+    length += sprintf(msg + length, "\nPress & Hold the keys corresponding to the bits in the"
                                " byte you would like to set to 1.");    // Prints 88 chars
-    sprintf(msg + strlen(msg), "\nBits will be 0 if keys are not pressed.");    // Prints 40 chars
-    sprintf(msg + strlen(msg), "\nPress SPACE BAR to compute Byte\t\t|\t"
-                               "Press ESC to exit\n");  // Prints 53 chars
+    length += sprintf(msg + length, "\nBits will be 0 if keys are not pressed.");    // Prints 40 chars
+    length += sprintf(msg + length, chord->commit_mode == COMMIT_ON_RELEASE
+                                        ? "\nRelease every key to compute Byte\t|\tPress ESC to exit\n"
+                                        : "\nPress SPACE BAR to compute Byte\t\t|\tPress ESC to exit\n");  // 53 chars
 
-    printf("%s", msg);
+    return length;
+}
+
+/*
+ * Prints the current state of the Bit Array
+ */
+void print_bit_arr_summary(const enum stenobyte_mode mode, const struct chord_state* chord) {
+    char msg[BIT_ARR_SUMMARY_SIZE];
+    const int length = get_bit_arr_summary(msg, mode, chord);
+    fwrite(msg, 1, (size_t) length, stdout);
+}
+
+/*
+ * Hands the byte just computed to the session's Byte Sink (by default the Output Engine, which writes it to the file
+ * according to its flush policy). A word wider than a byte is handed over one byte at a time, in the session's byte
+ * order.
+ */
+void write_byte_to_sink(struct stenobyte_session* session) {
+#if CHORD_WORD_SIZE == 1
+    session->byte_sink.write_byte(session->byte_sink.context, session->chord.current_word);
+#else
+    u_int8_t bytes[CHORD_WORD_SIZE];
+    get_chord_word_bytes(session->chord.current_word, session->options.byte_order, bytes);
+    for (int i = 0; i < CHORD_WORD_SIZE; i++) {
+        session->byte_sink.write_byte(session->byte_sink.context, bytes[i]);
+    }
+#endif
+}
+
+/*
+ * Hands the byte just computed to a Byte Sink through the session's Dictionary, which may write out a whole string
+ * for it or hold it back until the next stroke shows which entry is meant. time_us is the kernel timestamp of the
+ * stroke. Without a Dictionary, this is the same as write_byte_to_sink().
+ * A chord committed with an edit key is applied as an edit instead, repeated as many times as its word says (once for
+ * 0), after the strokes held back by the Dictionary have been written out.
+ */
+void write_stroke_to_sink(struct stenobyte_session* session, const struct byte_sink* sink, const u_int64_t time_us) {
+    if (sink->apply_edit != nullptr && session->chord.edit != CHORD_EDIT_NONE) {
+        flush_stenobyte_strokes(session, sink);
+        const unsigned int count = session->chord.current_word != 0 ? session->chord.current_word : 1;
+        sink->apply_edit(sink->context, session->chord.edit, count);
+        session->chord.edit = CHORD_EDIT_NONE;
+        return;
+    }
+    if (sink->apply_edit != nullptr) {
+        sink->apply_edit(sink->context, CHORD_EDIT_NONE, 0);
+    }
+    const size_t written = translate_stroke(&session->translator, session->chord.current_word, time_us, sink);
+    add_to_metric(&session->metrics.bytes_committed, written);
+}
+
+/*
+ * Writes out the strokes still held back by the Dictionary, such as when the session ends
+ */
+void flush_stenobyte_strokes(struct stenobyte_session* session, const struct byte_sink* sink) {
+    add_to_metric(&session->metrics.bytes_committed, flush_stroke_translator(&session->translator, sink));
 }
 
-void write_byte_to_file() {
-    fprintf(output_file_ptr, "%c", (char) current_byte);
+/*
+ * Gets how long the event loop may sleep before a timed action is due (such as flushing the output)
+ *
+ * Returns the timeout in milliseconds, or -1 if the event loop may sleep until the next event
+ */
+int get_stenobyte_timeout_ms(const struct stenobyte_session* session) {
+    int timeout_ms = get_renderer_timeout_ms(&session->renderer);
+    if (session->mode == WRITER) {
+        const int flush_timeout_ms = get_output_flush_timeout_ms(&session->output_engine);
+        if (flush_timeout_ms >= 0 && (timeout_ms < 0 || flush_timeout_ms < timeout_ms)) {
+            timeout_ms = flush_timeout_ms;
+        }
+        const int translator_timeout_ms = get_translator_timeout_ms(&session->translator);
+        if (translator_timeout_ms >= 0 && (timeout_ms < 0 || translator_timeout_ms < timeout_ms)) {
+            timeout_ms = translator_timeout_ms;
+        }
+    }
+    return timeout_ms;
 }
 
 /*
- * Closes the File and frees up memory safely
+ * Performs the timed actions that are due. Called by the event loop after every wake-up. Stops the session once the
+ * Output Engine refuses bytes.
  */
-void end_stenobyte_writer() {
-    fclose(output_file_ptr);
-    end_stenobyte();
-}
\ No newline at end of file
+void process_stenobyte_timeouts(struct stenobyte_session* session) {
+    render_frame_if_due(&session->renderer, &session->chord);
+    if (session->mode == WRITER) {
+        add_to_metric(&session->metrics.bytes_committed,
+                      process_translator_timeout(&session->translator, &session->byte_sink));
+        process_output_timeout(&session->output_engine);
+        if (session->output_engine.journal_failed) {
+            stop_stenobyte(session);
+        }
+    }
+}
+
+/*
+ * Flushes & Closes the File and frees up memory safely
+ */
+void end_stenobyte_writer(struct stenobyte_session* session) {
+    end_output_engine(&session->output_engine);
+    print_output_counters(&session->output_engine);
+    end_stenobyte(session);
+}
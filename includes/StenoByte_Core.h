@@ -22,46 +22,58 @@
 #ifndef STENOBYTE_CORE_H
 #define STENOBYTE_CORE_H
 
+#include "StenoByte_Chord.h"
 #include "StenoByte_Helper.h"
+#include "StenoByte_Options.h"
+#include "StenoByte_Output.h"
+#include "StenoByte_Pipeline.h"
+#include "StenoByte_Renderer.h"
+#include "StenoByte_Session.h"
 
-enum stenobyte_mode {
-    NOT_SET = 0,
-    DEMO,
-    WRITER
-};
+#include <ctype.h>
 
-// Number of Bits in the Bit Array (should be 8)
-# define BITS_ARR_SIZE 8
+// Lengths of the summaries printed to the terminal
+#define BYTE_SUMMARY_SIZE 72
+#define SUMMARY_DIVIDER_LENGTH (24 + 16 * BITS_ARR_SIZE)
+#define BIT_ARR_SUMMARY_SIZE (448 + 48 * BITS_ARR_SIZE)   // 832 for 8 bits, 1216 for 16
 
 // Arrays & Variables
-// Bit Array that contains the bits that forms a byte
-extern bool bit_arr[BITS_ARR_SIZE]; // ordered from b0 to b7 during initialisation
+// The labels are shared by every session, like the Keymap they come from, and only written by setup_stenobyte_keymap()
 extern char keys_arr[BITS_ARR_SIZE]; // ';' = b0, 'L' = b1, ... 'A' = b7
-extern u_int8_t subvalues_arr[BITS_ARR_SIZE];
-extern bool ready_to_compute_byte;  // the state for whether to convert the bit array into a byte and process it
-extern u_int8_t current_byte;  // The byte last computed from the bit array
-extern const char* output_file_path;  // The path to the file write to
-extern FILE *output_file_ptr;  // The pointer of the file itself to write to
-extern enum stenobyte_mode mode;  // What mode is the program currently in
+extern chord_word subvalues_arr[BITS_ARR_SIZE];
 
 
 
 // Externally Declared Methods & Functions (expected to be declared & defined StenoByte_Helper files)
-extern void update_bit_arr(int key_code, bool new_state);
-extern int setup_stenobyte();
-extern void run_stenobyte();
-extern void end_stenobyte();
+extern void update_bit_arr(struct chord_state* chord, int key_code, bool new_state);
+extern int setup_stenobyte(struct stenobyte_session* session);
+extern int setup_stenobyte_cli_session(struct stenobyte_session* session, enum stenobyte_mode mode,
+                                       const struct stenobyte_options* options);
+extern void run_stenobyte(struct stenobyte_session* session);
+extern void stop_stenobyte(struct stenobyte_session* session);
+extern void end_stenobyte(struct stenobyte_session* session);
 
 // Methods & Functions
-int setup_stenobyte_demo();
-int setup_stenobyte_writer(int argc, const char* argv[]);
-void compute_byte();
+int setup_stenobyte_demo(struct stenobyte_session* session, int argc, const char* argv[]);
+int setup_stenobyte_writer(struct stenobyte_session* session, int argc, const char* argv[]);
+int setup_stenobyte_keymap(const char* keymap_file_path);
+void prepare_stenobyte_session(struct stenobyte_session* session, enum stenobyte_mode mode,
+                               const struct stenobyte_options* options);
+int setup_stenobyte_session(struct stenobyte_session* session, enum stenobyte_mode mode,
+                            const struct stenobyte_options* options);
+void set_stenobyte_byte_sink(struct stenobyte_session* session, byte_sink_callback write_byte, void* context);
+void compute_byte(struct chord_state* chord);
 void setup_subvalues_array();
-void get_byte_summary(char* msg);
-void print_byte_summary();
-void print_current_mode(char* msg);
-void print_bit_arr_summary();
-void write_byte_to_file();
-void end_stenobyte_writer();
+void get_byte_summary(char* msg, const struct chord_state* chord);
+void print_byte_summary(const struct chord_state* chord);
+void print_current_mode(char* msg, enum stenobyte_mode mode);
+int get_bit_arr_summary(char* msg, enum stenobyte_mode mode, const struct chord_state* chord);
+void print_bit_arr_summary(enum stenobyte_mode mode, const struct chord_state* chord);
+void write_byte_to_sink(struct stenobyte_session* session);
+void write_stroke_to_sink(struct stenobyte_session* session, const struct byte_sink* sink, u_int64_t time_us);
+void flush_stenobyte_strokes(struct stenobyte_session* session, const struct byte_sink* sink);
+int get_stenobyte_timeout_ms(const struct stenobyte_session* session);
+void process_stenobyte_timeouts(struct stenobyte_session* session);
+void end_stenobyte_writer(struct stenobyte_session* session);
 
 #endif //STENOBYTE_CORE_H
@@ -0,0 +1,749 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Daemon.c is the source file for implementing the Daemon: a single process that serves a session for
+    every keyboard listed in a config file, with a small pool of worker threads sharing one epoll set.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Daemon.h"
+#include "StenoByte_Core.h"
+
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+// Number of events a worker takes per wake-up: one, so that the other ready handles go to idle workers
+#define DAEMON_EPOLL_EVENTS 1
+
+/*
+ * Packs what a file descriptor belongs to into the data of its epoll registration
+ */
+static epoll_data_t get_daemon_handle(const enum daemon_handle_kind kind, const u_int32_t index) {
+    return (epoll_data_t) {.u64 = (u_int64_t) kind << 32 | index};
+}
+
+/*
+ * Registers a file descriptor with the Daemon's epoll set. Every handle except the shutdown eventfd is one-shot, so
+ * that it is handled by one worker at a time and must be re-armed once handled.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int add_daemon_handle(const struct stenobyte_daemon* daemon, const int file_descriptor,
+                             const enum daemon_handle_kind kind, const u_int32_t index) {
+    struct epoll_event handle_event = {
+        .events = kind == DAEMON_HANDLE_SHUTDOWN ? EPOLLIN : EPOLLIN | EPOLLONESHOT,
+        .data = get_daemon_handle(kind, index)
+    };
+    if (epoll_ctl(daemon->epoll_file_descriptor, EPOLL_CTL_ADD, file_descriptor, &handle_event) < 0) {
+        perror("Failed to register with the daemon's epoll set");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Re-arms a one-shot handle once it has been handled
+ */
+static void rearm_daemon_handle(const struct stenobyte_daemon* daemon, const int file_descriptor,
+                                const enum daemon_handle_kind kind, const u_int32_t index) {
+    struct epoll_event handle_event = {.events = EPOLLIN | EPOLLONESHOT, .data = get_daemon_handle(kind, index)};
+    epoll_ctl(daemon->epoll_file_descriptor, EPOLL_CTL_MOD, file_descriptor, &handle_event);
+}
+
+/*
+ * Returns the session with the given name, or nullptr if there is none
+ */
+static struct daemon_session* find_daemon_session(const struct stenobyte_daemon* daemon, const char* name) {
+    for (int i = 0; i < daemon->session_count; i++) {
+        if (strcmp(daemon->sessions[i].name, name) == 0) {
+            return &daemon->sessions[i];
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Sends committed bytes to every watcher of a session. A watcher that cannot take them straight away is
+ * disconnected, so that a slow client never holds up the keyboards. Called with the session's lock held.
+ */
+static void send_to_watchers(struct daemon_session* daemon_session, const u_int8_t* bytes, const size_t length) {
+    for (int i = 0; i < MAX_SESSION_WATCHERS; i++) {
+        const int watcher = daemon_session->watchers[i];
+        if (watcher >= 0 && send(watcher, bytes, length, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t) length) {
+            close(watcher);
+            daemon_session->watchers[i] = -1;
+        }
+    }
+}
+
+/*
+ * Adds a client to the watchers of a session. Called with the session's lock held.
+ *
+ * Returns 0 if the client was added, 1 if the session already has MAX_SESSION_WATCHERS watchers
+ */
+static int add_session_watcher(struct daemon_session* daemon_session, const int file_descriptor) {
+    for (int i = 0; i < MAX_SESSION_WATCHERS; i++) {
+        if (daemon_session->watchers[i] < 0) {
+            daemon_session->watchers[i] = file_descriptor;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Byte Sink of a Daemon session: writes the byte to the session's output file, if it has one, and streams it to its
+ * watchers. Bytes committed while the session is paused are discarded.
+ */
+static int write_daemon_session_byte(void* context, const u_int8_t byte) {
+    struct daemon_session* daemon_session = context;
+    if (daemon_session->paused) {
+        return 0;
+    }
+
+    int result = 0;
+    if (daemon_session->session.output_engine.file_descriptor >= 0) {
+        result = push_byte_to_output(&daemon_session->session.output_engine, byte);
+    }
+    send_to_watchers(daemon_session, &byte, 1);
+    return result;
+}
+
+/*
+ * Arms the flush timer of a session for when its next timed action is due, or disarms it if none is. Called with the
+ * session's lock held.
+ */
+static void arm_session_timer(const struct daemon_session* daemon_session) {
+    const int timeout_ms = get_stenobyte_timeout_ms(&daemon_session->session);
+    struct itimerspec timer = {0};
+    if (timeout_ms > 0) {
+        timer.it_value = (struct timespec) {.tv_sec = timeout_ms / 1000, .tv_nsec = timeout_ms % 1000 * 1000000L};
+    } else if (timeout_ms == 0) {
+        timer.it_value.tv_nsec = 1;    // Due now (a zero it_value would disarm the timer)
+    }
+    timerfd_settime(daemon_session->timer_file_descriptor, 0, &timer, nullptr);
+}
+
+/*
+ * Creates the listening socket that a "unix:PATH" output streams the session's bytes to
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int setup_output_socket(struct daemon_session* daemon_session, const char* socket_path) {
+    daemon_session->output_address = (struct sockaddr_un) {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(daemon_session->output_address.sun_path)) {
+        fprintf(stderr, "Output socket path is too long: %s\n", socket_path);
+        return 1;
+    }
+    strcpy(daemon_session->output_address.sun_path, socket_path);
+
+    daemon_session->output_file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (daemon_session->output_file_descriptor < 0) {
+        perror("Failed to create output socket");
+        return 1;
+    }
+    unlink(socket_path);
+    if (bind(daemon_session->output_file_descriptor, (const struct sockaddr*) &daemon_session->output_address,
+             sizeof(daemon_session->output_address)) < 0 ||
+        listen(daemon_session->output_file_descriptor, MAX_SESSION_WATCHERS) < 0) {
+        perror("Failed to listen on output socket");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Reads a session from a line of the config file, which is its name, the path of its keyboard, its output (a file
+ * path, or "unix:PATH" for a socket) and then any of the Writer's options that apply to a single session
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int parse_daemon_session(struct daemon_session* daemon_session, struct stenobyte_options* options,
+                                const char* config_file_path, const int line_number) {
+    const char* arguments[MAX_DAEMON_CONFIG_ARGUMENTS];
+    int argument_count = 0;
+    char* position;
+
+    for (char* token = strtok_r(daemon_session->config_line, " \t\r\n", &position);
+         token != nullptr && argument_count < MAX_DAEMON_CONFIG_ARGUMENTS;
+         token = strtok_r(nullptr, " \t\r\n", &position)) {
+        arguments[argument_count++] = token;
+    }
+    if (argument_count < 3 || strncmp(arguments[2], "--", 2) == 0) {
+        fprintf(stderr, "%s:%d: Expected a name, a device and an output\n", config_file_path, line_number);
+        return 1;
+    }
+    if (strlen(arguments[0]) >= sizeof(daemon_session->name)) {
+        fprintf(stderr, "%s:%d: Session name is too long: %s\n", config_file_path, line_number, arguments[0]);
+        return 1;
+    }
+    strcpy(daemon_session->name, arguments[0]);
+
+    // The options after the device are parsed like the Writer's command line, with the output as the file path
+    const char* device_path = arguments[1];
+    arguments[1] = arguments[0];
+    if (parse_stenobyte_options(options, argument_count - 1, arguments + 1) != 0) {
+        fprintf(stderr, "%s:%d: Invalid options for session %s\n", config_file_path, line_number, arguments[0]);
+        return 1;
+    }
+    if (options->replay_file_path != nullptr || options->keymap_file_path != nullptr || options->pipeline ||
+        options->metrics_socket_path != nullptr || options->edit) {
+        fprintf(stderr, "%s:%d: --replay, --keymap, --pipeline, --metrics and --edit cannot be set per session\n",
+                config_file_path, line_number);
+        return 1;
+    }
+    if (has_stdout_sink(options->sinks, options->sink_count)) {
+        fprintf(stderr, "%s:%d: The Daemon has no stdout to give a session's sink\n", config_file_path, line_number);
+        return 1;
+    }
+    options->device_path = device_path;
+    options->headless = true;
+    return 0;
+}
+
+/*
+ * Sets up a session of the Daemon: opens its keyboard and output, and registers its epoll instance, flush timer and
+ * output socket with the Daemon's epoll set. The exit key is ignored, since a session runs until the Daemon stops.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int setup_daemon_session(const struct stenobyte_daemon* daemon, struct daemon_session* daemon_session,
+                                struct stenobyte_options* options, const u_int32_t index) {
+    const char* output = options->output_file_path;
+    const bool socket_output = strncmp(output, DAEMON_OUTPUT_SOCKET_PREFIX, strlen(DAEMON_OUTPUT_SOCKET_PREFIX)) == 0;
+    if (socket_output) {
+        options->output_file_path = nullptr;
+    }
+
+    printf("Session %s: %s -> %s\n", daemon_session->name, options->device_path, output);
+    if (setup_stenobyte_session(&daemon_session->session, WRITER, options) != 0) {
+        return 1;
+    }
+    daemon_session->session.ignore_exit_key = true;
+    setup_renderer(&daemon_session->session.renderer, false, WRITER);
+    set_stenobyte_byte_sink(&daemon_session->session, write_daemon_session_byte, daemon_session);
+
+    daemon_session->timer_file_descriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (daemon_session->timer_file_descriptor < 0) {
+        perror("Failed to create flush timer");
+        return 1;
+    }
+    if (socket_output && setup_output_socket(daemon_session, output + strlen(DAEMON_OUTPUT_SOCKET_PREFIX)) != 0) {
+        return 1;
+    }
+
+    if (add_daemon_handle(daemon, daemon_session->session.epoll_file_descriptor, DAEMON_HANDLE_SESSION, index) != 0 ||
+        add_daemon_handle(daemon, daemon_session->timer_file_descriptor, DAEMON_HANDLE_TIMER, index) != 0) {
+        return 1;
+    }
+    if (socket_output &&
+        add_daemon_handle(daemon, daemon_session->output_file_descriptor, DAEMON_HANDLE_OUTPUT, index) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Reads the config file and sets up a session for each of its lines. Blank lines and lines starting with '#' are
+ * ignored.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int load_daemon_config(struct stenobyte_daemon* daemon, const char* config_file_path) {
+    FILE* config_file = fopen(config_file_path, "r");
+    if (config_file == nullptr) {
+        perror("Failed to open config file");
+        return 1;
+    }
+
+    daemon->sessions = calloc(MAX_DAEMON_SESSIONS, sizeof(struct daemon_session));
+    if (daemon->sessions == nullptr) {
+        perror("Failed to allocate sessions");
+        fclose(config_file);
+        return 1;
+    }
+
+    char line[DAEMON_CONFIG_LINE_SIZE];
+    int line_number = 0;
+    int result = 0;
+    while (result == 0 && fgets(line, sizeof(line), config_file) != nullptr) {
+        line_number++;
+        char first_token[2] = "";
+        if (sscanf(line, " %1s", first_token) != 1 || first_token[0] == '#') {
+            continue;
+        }
+        if (daemon->session_count == MAX_DAEMON_SESSIONS) {
+            fprintf(stderr, "%s:%d: More than %d sessions\n", config_file_path, line_number, MAX_DAEMON_SESSIONS);
+            result = 1;
+            break;
+        }
+
+        // Prepared first, so that end_daemon() can close a session that failed to parse or set up
+        struct daemon_session* daemon_session = &daemon->sessions[daemon->session_count];
+        prepare_stenobyte_session(&daemon_session->session, WRITER, &default_stenobyte_options);
+        daemon_session->timer_file_descriptor = -1;
+        daemon_session->output_file_descriptor = -1;
+        for (int i = 0; i < MAX_SESSION_WATCHERS; i++) {
+            daemon_session->watchers[i] = -1;
+        }
+        pthread_mutex_init(&daemon_session->lock, nullptr);
+        strcpy(daemon_session->config_line, line);
+
+        struct stenobyte_options options;
+        result = parse_daemon_session(daemon_session, &options, config_file_path, line_number);
+        if (result == 0 && find_daemon_session(daemon, daemon_session->name) != nullptr) {
+            fprintf(stderr, "%s:%d: Session %s is defined twice\n", config_file_path, line_number,
+                    daemon_session->name);
+            result = 1;
+        }
+        daemon->session_count++;
+        if (result == 0) {
+            result = setup_daemon_session(daemon, daemon_session, &options, (u_int32_t) daemon->session_count - 1);
+        }
+    }
+    fclose(config_file);
+
+    if (result == 0 && daemon->session_count == 0) {
+        fprintf(stderr, "%s: No sessions are defined\n", config_file_path);
+        result = 1;
+    }
+    return result;
+}
+
+/*
+ * Creates the control socket that clients connect to in order to list, watch and control the sessions
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int setup_control_socket(struct stenobyte_daemon* daemon, const char* control_socket_path) {
+    daemon->control_address = (struct sockaddr_un) {.sun_family = AF_UNIX};
+    if (strlen(control_socket_path) >= sizeof(daemon->control_address.sun_path)) {
+        fprintf(stderr, "Control socket path is too long: %s\n", control_socket_path);
+        return 1;
+    }
+    strcpy(daemon->control_address.sun_path, control_socket_path);
+
+    daemon->control_file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (daemon->control_file_descriptor < 0) {
+        perror("Failed to create control socket");
+        return 1;
+    }
+    unlink(control_socket_path);
+    if (bind(daemon->control_file_descriptor, (const struct sockaddr*) &daemon->control_address,
+             sizeof(daemon->control_address)) < 0 ||
+        listen(daemon->control_file_descriptor, MAX_DAEMON_CLIENTS) < 0) {
+        perror("Failed to listen on control socket");
+        return 1;
+    }
+    return add_daemon_handle(daemon, daemon->control_file_descriptor, DAEMON_HANDLE_CONTROL, 0);
+}
+
+/*
+ * Sets up the Daemon: its epoll set, its control socket and a session for every line of the config file.
+ * The Keymap must already be loaded, as it is shared by every session.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_daemon(struct stenobyte_daemon* daemon, const char* config_file_path, const char* control_socket_path) {
+    memset(daemon, 0, sizeof(*daemon));
+    daemon->shutdown_file_descriptor = -1;
+    daemon->control_file_descriptor = -1;
+    pthread_mutex_init(&daemon->clients_lock, nullptr);
+    for (int i = 0; i < MAX_DAEMON_CLIENTS; i++) {
+        daemon->clients[i].file_descriptor = -1;
+    }
+
+    daemon->epoll_file_descriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (daemon->epoll_file_descriptor < 0) {
+        perror("Failed to create epoll instance");
+        return 1;
+    }
+    daemon->shutdown_file_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (daemon->shutdown_file_descriptor < 0) {
+        perror("Failed to create shutdown eventfd");
+        return 1;
+    }
+    if (add_daemon_handle(daemon, daemon->shutdown_file_descriptor, DAEMON_HANDLE_SHUTDOWN, 0) != 0) {
+        return 1;
+    }
+
+    if (load_daemon_config(daemon, config_file_path) != 0) {
+        return 1;
+    }
+    return setup_control_socket(daemon, control_socket_path);
+}
+
+/*
+ * Handles the ready events of a session on its own epoll instance, then re-arms its flush timer
+ */
+static void handle_daemon_session(const struct stenobyte_daemon* daemon, struct daemon_session* daemon_session,
+                                  const u_int32_t index) {
+    pthread_mutex_lock(&daemon_session->lock);
+    process_stenobyte_events(&daemon_session->session, 0);
+    arm_session_timer(daemon_session);
+    pthread_mutex_unlock(&daemon_session->lock);
+    rearm_daemon_handle(daemon, daemon_session->session.epoll_file_descriptor, DAEMON_HANDLE_SESSION, index);
+}
+
+/*
+ * Performs the timed actions of a session that are due, such as flushing its output
+ */
+static void handle_daemon_timer(const struct stenobyte_daemon* daemon, struct daemon_session* daemon_session,
+                                const u_int32_t index) {
+    u_int64_t expirations;
+    pthread_mutex_lock(&daemon_session->lock);
+    if (read(daemon_session->timer_file_descriptor, &expirations, sizeof(expirations)) > 0) {
+        process_stenobyte_timeouts(&daemon_session->session);
+        arm_session_timer(daemon_session);
+    }
+    pthread_mutex_unlock(&daemon_session->lock);
+    rearm_daemon_handle(daemon, daemon_session->timer_file_descriptor, DAEMON_HANDLE_TIMER, index);
+}
+
+/*
+ * Accepts the readers of a session's output socket as watchers of the session
+ */
+static void handle_daemon_output(const struct stenobyte_daemon* daemon, struct daemon_session* daemon_session,
+                                 const u_int32_t index) {
+    int reader_file_descriptor;
+    while ((reader_file_descriptor = accept(daemon_session->output_file_descriptor, nullptr, nullptr)) >= 0) {
+        fcntl(reader_file_descriptor, F_SETFD, FD_CLOEXEC);
+        shutdown(reader_file_descriptor, SHUT_RD);
+
+        pthread_mutex_lock(&daemon_session->lock);
+        const int result = add_session_watcher(daemon_session, reader_file_descriptor);
+        pthread_mutex_unlock(&daemon_session->lock);
+        if (result != 0) {
+            close(reader_file_descriptor);
+        }
+    }
+    rearm_daemon_handle(daemon, daemon_session->output_file_descriptor, DAEMON_HANDLE_OUTPUT, index);
+}
+
+/*
+ * Accepts every pending control client and waits for its request line
+ */
+static void accept_daemon_clients(struct stenobyte_daemon* daemon) {
+    int client_file_descriptor;
+    while ((client_file_descriptor = accept(daemon->control_file_descriptor, nullptr, nullptr)) >= 0) {
+        fcntl(client_file_descriptor, F_SETFL, O_NONBLOCK);
+        fcntl(client_file_descriptor, F_SETFD, FD_CLOEXEC);
+
+        pthread_mutex_lock(&daemon->clients_lock);
+        int slot = -1;
+        for (int i = 0; i < MAX_DAEMON_CLIENTS && slot < 0; i++) {
+            if (daemon->clients[i].file_descriptor < 0) {
+                slot = i;
+            }
+        }
+        if (slot >= 0) {
+            daemon->clients[slot].file_descriptor = client_file_descriptor;
+            daemon->clients[slot].request_length = 0;
+        }
+        pthread_mutex_unlock(&daemon->clients_lock);
+
+        if (slot < 0 ||
+            add_daemon_handle(daemon, client_file_descriptor, DAEMON_HANDLE_CLIENT, (u_int32_t) slot) != 0) {
+            close(client_file_descriptor);  // Too many clients at once
+            if (slot >= 0) {
+                pthread_mutex_lock(&daemon->clients_lock);
+                daemon->clients[slot].file_descriptor = -1;
+                pthread_mutex_unlock(&daemon->clients_lock);
+            }
+        }
+    }
+    rearm_daemon_handle(daemon, daemon->control_file_descriptor, DAEMON_HANDLE_CONTROL, 0);
+}
+
+/*
+ * Frees the slot of a control client, leaving its connection open if it became a watcher
+ */
+static void release_daemon_client(struct stenobyte_daemon* daemon, struct daemon_client* client,
+                                  const bool close_connection) {
+    epoll_ctl(daemon->epoll_file_descriptor, EPOLL_CTL_DEL, client->file_descriptor, nullptr);
+    if (close_connection) {
+        close(client->file_descriptor);
+    }
+    pthread_mutex_lock(&daemon->clients_lock);
+    client->file_descriptor = -1;
+    pthread_mutex_unlock(&daemon->clients_lock);
+}
+
+/*
+ * Writes one line describing each session
+ *
+ * Returns the number of chars written
+ */
+static int list_daemon_sessions(const struct stenobyte_daemon* daemon, char* response, const size_t response_size) {
+    int length = 0;
+    for (int i = 0; i < daemon->session_count && (size_t) length < response_size; i++) {
+        struct daemon_session* daemon_session = &daemon->sessions[i];
+        pthread_mutex_lock(&daemon_session->lock);
+        int watcher_count = 0;
+        for (int j = 0; j < MAX_SESSION_WATCHERS; j++) {
+            watcher_count += daemon_session->watchers[j] >= 0;
+        }
+        length += snprintf(response + length, response_size - (size_t) length,
+                           "%s device=%s keyboards=%d chords=%llu watchers=%d %s\n", daemon_session->name,
+                           daemon_session->session.options.device_path,
+                           count_attached_keyboards(&daemon_session->session.keyboards),
+                           (unsigned long long) daemon_session->session.metrics.chords_committed, watcher_count,
+                           daemon_session->paused ? "paused" : "running");
+        pthread_mutex_unlock(&daemon_session->lock);
+    }
+    return (size_t) length < response_size ? length : (int) response_size - 1;
+}
+
+/*
+ * Runs the command in a client's request line:
+ *     list                 One line per session
+ *     stats NAME [json]    The Metrics of a session, as text or JSON
+ *     watch NAME           Streams every byte the session commits from now on, until the client disconnects
+ *     pause NAME           Discards the bytes the session commits
+ *     resume NAME          Writes the bytes the session commits again
+ *     flush NAME           Writes the session's buffered bytes to its output file now
+ *     shutdown             Stops the Daemon
+ *
+ * Returns the number of chars of the response, and sets watched_session if the client is to become a watcher
+ */
+static int run_daemon_command(struct stenobyte_daemon* daemon, const char* request, char* response,
+                              const size_t response_size, struct daemon_session** watched_session) {
+    char command[16] = "", name[DAEMON_SESSION_NAME_SIZE] = "", format[8] = "";
+    sscanf(request, "%15s %31s %7s", command, name, format);
+
+    if (strcmp(command, "list") == 0) {
+        return list_daemon_sessions(daemon, response, response_size);
+    }
+    if (strcmp(command, "shutdown") == 0) {
+        stop_daemon(daemon);
+        return snprintf(response, response_size, "OK\n");
+    }
+
+    struct daemon_session* daemon_session = find_daemon_session(daemon, name);
+    if (daemon_session == nullptr) {
+        return snprintf(response, response_size, command[0] == '\0' ? "ERROR Empty request\n"
+                                                 : name[0] == '\0' ? "ERROR Unknown command or missing session name\n"
+                                                 : "ERROR No session named %s\n", name);
+    }
+
+    int length;
+    pthread_mutex_lock(&daemon_session->lock);
+    if (strcmp(command, "stats") == 0) {
+        length = format_metrics(&daemon_session->session, response, response_size, strcmp(format, "json") == 0);
+    } else if (strcmp(command, "watch") == 0) {
+        *watched_session = daemon_session;
+        length = snprintf(response, response_size, "OK\n");
+    } else if (strcmp(command, "pause") == 0 || strcmp(command, "resume") == 0) {
+        daemon_session->paused = strcmp(command, "pause") == 0;
+        length = snprintf(response, response_size, "OK\n");
+    } else if (strcmp(command, "flush") == 0) {
+        const int result = flush_output_engine(&daemon_session->session.output_engine);
+        arm_session_timer(daemon_session);
+        length = snprintf(response, response_size, result == 0 ? "OK\n" : "ERROR Failed to flush\n");
+    } else {
+        length = snprintf(response, response_size, "ERROR Unknown command: %s\n", command);
+    }
+    pthread_mutex_unlock(&daemon_session->lock);
+    return length;
+}
+
+/*
+ * Reads a control client's request and answers it once the request line is complete. The connection is closed after
+ * the answer, unless the client asked to watch a session.
+ */
+static void serve_daemon_client(struct stenobyte_daemon* daemon, const u_int32_t slot) {
+    struct daemon_client* client = &daemon->clients[slot];
+    const ssize_t received = read(client->file_descriptor, client->request + client->request_length,
+                                  sizeof(client->request) - 1 - client->request_length);
+    if (received < 0 && errno == EAGAIN) {
+        rearm_daemon_handle(daemon, client->file_descriptor, DAEMON_HANDLE_CLIENT, slot);
+        return;
+    }
+    if (received > 0) {
+        client->request_length += (size_t) received;
+    }
+    client->request[client->request_length] = '\0';
+    if (received > 0 && strchr(client->request, '\n') == nullptr &&
+        client->request_length < sizeof(client->request) - 1) {
+        rearm_daemon_handle(daemon, client->file_descriptor, DAEMON_HANDLE_CLIENT, slot);
+        return;     // Waits for the rest of the request line
+    }
+
+    char response[DAEMON_RESPONSE_SIZE];
+    struct daemon_session* watched_session = nullptr;
+    const int length = run_daemon_command(daemon, client->request, response, sizeof(response), &watched_session);
+
+    // The answer fits in the socket's buffer, so a client that does not read it is simply dropped
+    send(client->file_descriptor, response, (size_t) length, MSG_NOSIGNAL);
+    if (watched_session == nullptr) {
+        release_daemon_client(daemon, client, true);
+        return;
+    }
+
+    const int watcher_file_descriptor = client->file_descriptor;
+    release_daemon_client(daemon, client, false);
+    shutdown(watcher_file_descriptor, SHUT_RD);
+    pthread_mutex_lock(&watched_session->lock);
+    const int result = add_session_watcher(watched_session, watcher_file_descriptor);
+    pthread_mutex_unlock(&watched_session->lock);
+    if (result != 0) {
+        static const char too_many_watchers[] = "ERROR Too many watchers\n";
+        send(watcher_file_descriptor, too_many_watchers, sizeof(too_many_watchers) - 1, MSG_NOSIGNAL);
+        close(watcher_file_descriptor);
+    }
+}
+
+/*
+ * Worker Thread: takes one ready handle at a time from the shared epoll set and handles it, until the Daemon stops.
+ * Sessions are handled by whichever worker is free, but never by two workers at once.
+ */
+static void* run_daemon_worker(void* argument) {
+    struct stenobyte_daemon* daemon = argument;
+    struct epoll_event ready_events[DAEMON_EPOLL_EVENTS];
+
+    while (true) {
+        const int ready_count = epoll_wait(daemon->epoll_file_descriptor, ready_events, DAEMON_EPOLL_EVENTS, -1);
+        if (ready_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to wait for events");
+            return nullptr;
+        }
+
+        for (int i = 0; i < ready_count; i++) {
+            const enum daemon_handle_kind kind = (enum daemon_handle_kind) (ready_events[i].data.u64 >> 32);
+            const u_int32_t index = (u_int32_t) ready_events[i].data.u64;
+            switch (kind) {
+                case DAEMON_HANDLE_SHUTDOWN:
+                    return nullptr;     // The eventfd is left readable so that every worker sees it
+                case DAEMON_HANDLE_CONTROL:
+                    accept_daemon_clients(daemon);
+                    break;
+                case DAEMON_HANDLE_CLIENT:
+                    serve_daemon_client(daemon, index);
+                    break;
+                case DAEMON_HANDLE_SESSION:
+                    handle_daemon_session(daemon, &daemon->sessions[index], index);
+                    break;
+                case DAEMON_HANDLE_TIMER:
+                    handle_daemon_timer(daemon, &daemon->sessions[index], index);
+                    break;
+                case DAEMON_HANDLE_OUTPUT:
+                    handle_daemon_output(daemon, &daemon->sessions[index], index);
+                    break;
+            }
+        }
+    }
+}
+
+/*
+ * Starts the worker threads. SIGINT & SIGTERM are left to the thread that called this function.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int start_daemon_workers(struct stenobyte_daemon* daemon, const int worker_count) {
+    sigset_t stop_signals;
+    sigset_t previous_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_signals);
+
+    int result = 0;
+    while (result == 0 && daemon->worker_count < worker_count) {
+        const int error = pthread_create(&daemon->workers[daemon->worker_count], nullptr, run_daemon_worker, daemon);
+        if (error != 0) {
+            errno = error;
+            perror("Failed to start worker thread");
+            result = 1;
+        } else {
+            daemon->worker_count++;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+    return result;
+}
+
+/*
+ * Makes every worker finish. Safe to call from a signal handler or a worker.
+ */
+void stop_daemon(const struct stenobyte_daemon* daemon) {
+    if (daemon->shutdown_file_descriptor >= 0) {
+        eventfd_write(daemon->shutdown_file_descriptor, 1);
+    }
+}
+
+/*
+ * Waits for every worker to finish after stop_daemon() was called
+ */
+void wait_for_daemon(struct stenobyte_daemon* daemon) {
+    for (int i = 0; i < daemon->worker_count; i++) {
+        pthread_join(daemon->workers[i], nullptr);
+    }
+    daemon->worker_count = 0;
+}
+
+/*
+ * Flushes & closes the output of every session, then closes the sessions, their watchers and the control socket.
+ * Must be called once the workers have finished.
+ */
+void end_daemon(struct stenobyte_daemon* daemon) {
+    for (int i = 0; i < daemon->session_count; i++) {
+        struct daemon_session* daemon_session = &daemon->sessions[i];
+        flush_stenobyte_strokes(&daemon_session->session, &daemon_session->session.byte_sink);
+        end_output_engine(&daemon_session->session.output_engine);
+        printf("Session %s: %llu bytes committed, %llu written to file\n", daemon_session->name,
+               (unsigned long long) daemon_session->session.metrics.bytes_committed,
+               (unsigned long long) daemon_session->session.output_engine.bytes_written);
+        end_stenobyte(&daemon_session->session);
+
+        for (int j = 0; j < MAX_SESSION_WATCHERS; j++) {
+            if (daemon_session->watchers[j] >= 0) {
+                close(daemon_session->watchers[j]);
+            }
+        }
+        if (daemon_session->output_file_descriptor >= 0) {
+            close(daemon_session->output_file_descriptor);
+            unlink(daemon_session->output_address.sun_path);
+        }
+        if (daemon_session->timer_file_descriptor >= 0) {
+            close(daemon_session->timer_file_descriptor);
+        }
+        pthread_mutex_destroy(&daemon_session->lock);
+    }
+    free(daemon->sessions);
+    daemon->sessions = nullptr;
+    daemon->session_count = 0;
+
+    for (int i = 0; i < MAX_DAEMON_CLIENTS; i++) {
+        if (daemon->clients[i].file_descriptor >= 0) {
+            close(daemon->clients[i].file_descriptor);
+        }
+    }
+    if (daemon->control_file_descriptor >= 0) {
+        close(daemon->control_file_descriptor);
+        unlink(daemon->control_address.sun_path);
+    }
+    if (daemon->shutdown_file_descriptor >= 0) {
+        close(daemon->shutdown_file_descriptor);
+    }
+    if (daemon->epoll_file_descriptor >= 0) {
+        close(daemon->epoll_file_descriptor);
+    }
+    pthread_mutex_destroy(&daemon->clients_lock);
+}
@@ -0,0 +1,103 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Daemon.h is the header file for defining the Daemon: a single process that serves a session for every
+    keyboard listed in a config file, with a small pool of worker threads sharing one epoll set.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_DAEMON_H
+#define STENOBYTE_DAEMON_H
+
+#include "StenoByte_Session.h"
+
+#include <sys/un.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+// Config File
+#define DAEMON_CONFIG_LINE_SIZE 512
+#define MAX_DAEMON_CONFIG_ARGUMENTS 16
+#define DAEMON_SESSION_NAME_SIZE 32
+#define MAX_DAEMON_SESSIONS 64
+
+// Output given as "unix:PATH" streams the session's bytes to the readers of a Unix domain socket instead of a file
+#define DAEMON_OUTPUT_SOCKET_PREFIX "unix:"
+
+// Worker Pool
+#define DEFAULT_DAEMON_WORKERS 2
+#define MAX_DAEMON_WORKERS 16
+
+// Control Socket
+#define DEFAULT_DAEMON_CONTROL_PATH "/run/stenobyte.sock"
+#define MAX_DAEMON_CLIENTS 16
+#define MAX_SESSION_WATCHERS 8
+#define DAEMON_REQUEST_SIZE 128
+#define DAEMON_RESPONSE_SIZE 8192
+
+// What a file descriptor in the Daemon's epoll set belongs to, stored in the upper half of its epoll data
+enum daemon_handle_kind {
+    DAEMON_HANDLE_SHUTDOWN = 0, // The eventfd written to by stop_daemon()
+    DAEMON_HANDLE_CONTROL,      // The listening control socket
+    DAEMON_HANDLE_CLIENT,       // A control client, indexed by its slot
+    DAEMON_HANDLE_SESSION,      // The epoll instance of a session, indexed by the session
+    DAEMON_HANDLE_TIMER,        // The flush timer of a session
+    DAEMON_HANDLE_OUTPUT        // The listening output socket of a session
+};
+
+struct daemon_session {
+    char name[DAEMON_SESSION_NAME_SIZE];
+    char config_line[DAEMON_CONFIG_LINE_SIZE];  // The session's line of the config file, which its options point into
+    struct stenobyte_session session;
+    pthread_mutex_t lock;   // Held by the worker handling the session, so that it is handled by one worker at a time
+    int timer_file_descriptor;  // timerfd armed when the Output Engine has bytes due to be flushed
+    bool paused;    // Whether committed bytes are discarded instead of written
+    int output_file_descriptor; // Listening socket for "unix:PATH" outputs, -1 otherwise
+    struct sockaddr_un output_address;
+    int watchers[MAX_SESSION_WATCHERS]; // Clients that every committed byte is streamed to, -1 for a free slot
+};
+
+// A client of the control socket, waiting for its request line
+struct daemon_client {
+    int file_descriptor;    // -1 when the slot is free
+    char request[DAEMON_REQUEST_SIZE];
+    size_t request_length;
+};
+
+struct stenobyte_daemon {
+    struct daemon_session* sessions;
+    int session_count;
+
+    int epoll_file_descriptor;  // The epoll set shared by every worker
+    int shutdown_file_descriptor;   // eventfd written to by stop_daemon()
+
+    int control_file_descriptor;
+    struct sockaddr_un control_address;
+    struct daemon_client clients[MAX_DAEMON_CLIENTS];
+    pthread_mutex_t clients_lock;   // Held while a client slot is taken or freed
+
+    pthread_t workers[MAX_DAEMON_WORKERS];
+    int worker_count;
+};
+
+// Methods & Functions
+int setup_daemon(struct stenobyte_daemon* daemon, const char* config_file_path, const char* control_socket_path);
+int start_daemon_workers(struct stenobyte_daemon* daemon, int worker_count);
+void stop_daemon(const struct stenobyte_daemon* daemon);
+void wait_for_daemon(struct stenobyte_daemon* daemon);
+void end_daemon(struct stenobyte_daemon* daemon);
+
+#endif //STENOBYTE_DAEMON_H
@@ -0,0 +1,414 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Devices.c is the source file for implementing the discovery of keyboards. At startup every event device
+    that has the keys of the Keymap is attached, and the device directory is watched with inotify so that keyboards
+    are attached when they are plugged in and detached when they are unplugged, without restarting the app.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Devices.h"
+#include "StenoByte_Keymap.h"
+
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Sets up an empty set of keyboards. Keyboards are attached by discover_keyboards() and setup_hotplug().
+ */
+void setup_keyboard_set(struct keyboard_set* set, const char* device_path, const bool grab, const bool raw_reads,
+                        const int epoll_fd) {
+    memset(set->keyboards, 0, sizeof(set->keyboards));
+    set->hotplug_file_descriptor = -1;
+    set->link_watch_descriptor = -1;
+    set->link_directory[0] = '\0';
+    set->grab = grab;
+    set->raw_reads = raw_reads;
+    set->device_path = device_path;
+    set->epoll_file_descriptor = epoll_fd;
+}
+
+/*
+ * Checks whether a device has every key that the Keymap uses to set a bit or compute the byte
+ */
+bool is_chord_keyboard(const struct libevdev* device) {
+    if (!libevdev_has_event_type(device, EV_KEY)) {
+        return false;
+    }
+
+    for (unsigned int key_code = 0; key_code < KEYMAP_SIZE; key_code++) {
+        const u_int8_t action = keymap[key_code].action;
+        if ((action == KEY_ACTION_BIT || action == KEY_ACTION_COMMIT) &&
+            !libevdev_has_event_code(device, EV_KEY, key_code)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Asks the kernel to only deliver the key events of the keys in the Keymap, so that other keys, scan codes (EV_MSC),
+ * LED changes and so on do not wake up the event loop at all. Packets left empty by the filter are dropped by the
+ * kernel along with their SYN_REPORT. Kernels without EVIOCSMASK (before Linux 4.4) deliver every event as before.
+ */
+void set_kernel_event_filter(const int event_file_device) {
+    unsigned long key_bits[(KEY_CNT + BITS_PER_LONG - 1) / BITS_PER_LONG] = {0};
+    for (unsigned int key_code = 0; key_code < KEYMAP_SIZE; key_code++) {
+        if (keymap[key_code].action != KEY_ACTION_NONE) {
+            key_bits[key_code / BITS_PER_LONG] |= 1UL << key_code % BITS_PER_LONG;
+        }
+    }
+
+    const struct input_mask key_mask = {
+        .type = EV_KEY, .codes_size = sizeof(key_bits), .codes_ptr = (u_int64_t) (uintptr_t) key_bits
+    };
+    if (ioctl(event_file_device, EVIOCSMASK, &key_mask) < 0) {
+        return;
+    }
+
+    // An empty mask filters out every code of the other event types (EV_SYN is never filtered by the kernel)
+    for (unsigned int type = EV_KEY + 1; type < EV_CNT; type++) {
+        const struct input_mask empty_mask = {.type = type, .codes_size = 0, .codes_ptr = 0};
+        ioctl(event_file_device, EVIOCSMASK, &empty_mask);
+    }
+}
+
+/*
+ * Gets the bits of the Keymap keys that are currently held on any attached keyboard, according to the key state
+ * libevdev has synchronised with the kernel. Keyboards read raw bypass libevdev, so the kernel is asked for their key
+ * state with EVIOCGKEY instead.
+ */
+unsigned int get_held_bit_mask(const struct keyboard_set* set) {
+    unsigned int bit_mask = 0;
+    for (int i = 0; i < MAX_KEYBOARDS; i++) {
+        const struct keyboard* keyboard = &set->keyboards[i];
+        if (!keyboard->attached) {
+            continue;
+        }
+
+        unsigned long key_state[(KEY_CNT + BITS_PER_LONG - 1) / BITS_PER_LONG] = {0};
+        const bool raw_reads = keyboard->source.raw_buffer != nullptr;
+        if (raw_reads && ioctl(libevdev_get_fd(keyboard->device), EVIOCGKEY(sizeof(key_state)), key_state) < 0) {
+            continue;
+        }
+        for (unsigned int key_code = 0; key_code < KEYMAP_SIZE; key_code++) {
+            if (keymap[key_code].action != KEY_ACTION_BIT) {
+                continue;
+            }
+            const bool held = raw_reads ? (key_state[key_code / BITS_PER_LONG] >> key_code % BITS_PER_LONG & 1) != 0
+                                        : libevdev_get_event_value(keyboard->device, EV_KEY, key_code) != 0;
+            if (held) { // Pressed or repeating
+                bit_mask |= keymap[key_code].bit_mask;
+            }
+        }
+    }
+    return bit_mask;
+}
+
+/*
+ * Returns the attached keyboard with the given path, or nullptr if there is none
+ */
+static struct keyboard* find_keyboard_by_path(struct keyboard_set* set, const char* path) {
+    for (int i = 0; i < MAX_KEYBOARDS; i++) {
+        if (set->keyboards[i].attached && strcmp(set->keyboards[i].path, path) == 0) {
+            return &set->keyboards[i];
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Opens a device and attaches it to the set as a keyboard, registering it with the set's epoll instance.
+ * If require_chord_keys is true, devices that are missing keys of the Keymap are skipped.
+ *
+ * Returns 0 if the keyboard was attached, 1 otherwise
+ */
+int attach_keyboard(struct keyboard_set* set, const char* path, const bool require_chord_keys) {
+    if (find_keyboard_by_path(set, path) != nullptr) {
+        return 1;
+    }
+
+    struct keyboard* keyboard = nullptr;
+    for (int i = 0; i < MAX_KEYBOARDS && keyboard == nullptr; i++) {
+        if (!set->keyboards[i].attached) {
+            keyboard = &set->keyboards[i];
+        }
+    }
+    if (keyboard == nullptr) {
+        fprintf(stderr, "Cannot attach %s: %d keyboards are already attached\n", path, MAX_KEYBOARDS);
+        return 1;
+    }
+
+    // Opens the keyboard event file in Read-Only and Non-Blocking Modes
+    const int event_file_device = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (event_file_device < 0) {
+        if (!require_chord_keys) {
+            perror("Failed to open device");
+        }
+        return 1;
+    }
+
+    // Initialises the evdev device, then checks that it can type chords
+    if (libevdev_new_from_fd(event_file_device, &keyboard->device) < 0) {
+        close(event_file_device);
+        return 1;
+    }
+    if (require_chord_keys && !is_chord_keyboard(keyboard->device)) {
+        libevdev_free(keyboard->device);
+        keyboard->device = nullptr;
+        close(event_file_device);
+        return 1;
+    }
+
+    // Timestamps events with the same clock as the Metrics' latency measurements
+    libevdev_set_clock_id(keyboard->device, CLOCK_MONOTONIC);
+    set_kernel_event_filter(event_file_device);
+    if (set->grab && libevdev_grab(keyboard->device, LIBEVDEV_GRAB) < 0) {
+        fprintf(stderr, "Failed to grab %s; its key events will also reach other apps\n", path);
+    }
+
+    if (setup_device_input_source(&keyboard->source, keyboard->device, set->raw_reads) != 0) {
+        libevdev_free(keyboard->device);
+        keyboard->device = nullptr;
+        close(event_file_device);
+        return 1;
+    }
+    struct epoll_event device_event = {.events = EPOLLIN, .data.fd = event_file_device};
+    if (epoll_ctl(set->epoll_file_descriptor, EPOLL_CTL_ADD, event_file_device, &device_event) < 0) {
+        perror("Failed to register device with epoll");
+        end_input_source(&keyboard->source);
+        libevdev_free(keyboard->device);
+        keyboard->device = nullptr;
+        close(event_file_device);
+        return 1;
+    }
+
+    snprintf(keyboard->path, sizeof(keyboard->path), "%s", path);
+    keyboard->attached = true;
+    printf("Keyboard attached: %s (%s)\n", libevdev_get_name(keyboard->device), path);
+    return 0;
+}
+
+/*
+ * Releases the resources of an attached keyboard
+ */
+static void release_keyboard(const struct keyboard_set* set, struct keyboard* keyboard) {
+    const int event_file_device = libevdev_get_fd(keyboard->device);
+    epoll_ctl(set->epoll_file_descriptor, EPOLL_CTL_DEL, event_file_device, nullptr);
+    end_input_source(&keyboard->source);
+    libevdev_free(keyboard->device);
+    close(event_file_device);
+    keyboard->device = nullptr;
+    keyboard->attached = false;
+}
+
+/*
+ * Detaches a keyboard, e.g. after it was unplugged
+ */
+void detach_keyboard(struct keyboard_set* set, struct keyboard* keyboard) {
+    if (keyboard->attached) {
+        printf("Keyboard detached: %s\n", keyboard->path);
+        release_keyboard(set, keyboard);
+    }
+}
+
+/*
+ * Attaches the set's keyboard at device_path if one was given, otherwise every event device that has the keys of
+ * the Keymap
+ *
+ * Returns the number of keyboards attached
+ */
+int discover_keyboards(struct keyboard_set* set) {
+    if (set->device_path != nullptr) {
+        return attach_keyboard(set, set->device_path, false) == 0 ? 1 : 0;
+    }
+
+    DIR* directory = opendir(INPUT_DEVICE_DIRECTORY);
+    if (directory == nullptr) {
+        perror("Failed to open " INPUT_DEVICE_DIRECTORY);
+        return 0;
+    }
+
+    int attached_count = 0;
+    const struct dirent* entry;
+    while ((entry = readdir(directory)) != nullptr) {
+        if (strncmp(entry->d_name, INPUT_DEVICE_PREFIX, strlen(INPUT_DEVICE_PREFIX)) != 0) {
+            continue;
+        }
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", INPUT_DEVICE_DIRECTORY, entry->d_name);
+        if (attach_keyboard(set, path, true) == 0) {
+            attached_count++;
+        }
+    }
+    closedir(directory);
+    return attached_count;
+}
+
+/*
+ * Watches the directory of device_path when it is outside the device directory, such as a /dev/input/by-id link, so
+ * that the link being created by udev after a replug is seen. udev may remove the directory along with its last link,
+ * so this is tried again on every hotplug event until the directory exists.
+ *
+ * Returns true if the directory has just started being watched, false otherwise
+ */
+static bool watch_link_directory(struct keyboard_set* set) {
+    if (set->link_directory[0] == '\0' || set->link_watch_descriptor >= 0) {
+        return false;
+    }
+    set->link_watch_descriptor = inotify_add_watch(set->hotplug_file_descriptor, set->link_directory,
+                                                   IN_CREATE | IN_ATTRIB | IN_MOVED_TO);
+    return set->link_watch_descriptor >= 0;
+}
+
+/*
+ * Checks whether a path that has just appeared is the set's device_path, either as the path itself or as the device
+ * that device_path links to
+ */
+static bool is_configured_device(const struct keyboard_set* set, const char* path) {
+    // A link that points to a device not created yet is matched once the device appears
+    char resolved_path[PATH_MAX];
+    if (realpath(set->device_path, resolved_path) == nullptr) {
+        return false;
+    }
+    return strcmp(path, set->device_path) == 0 || strcmp(path, resolved_path) == 0;
+}
+
+/*
+ * Starts watching the device directory for devices being created, or having their permissions set by udev, and the
+ * directory of device_path if it is a link elsewhere
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_hotplug(struct keyboard_set* set) {
+    set->hotplug_file_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (set->hotplug_file_descriptor < 0) {
+        perror("Failed to create inotify instance");
+        return 1;
+    }
+
+    if (inotify_add_watch(set->hotplug_file_descriptor, INPUT_DEVICE_DIRECTORY, IN_CREATE | IN_ATTRIB) < 0) {
+        perror("Failed to watch " INPUT_DEVICE_DIRECTORY);
+        return 1;
+    }
+
+    const char* last_slash = set->device_path != nullptr ? strrchr(set->device_path, '/') : nullptr;
+    if (last_slash != nullptr) {
+        snprintf(set->link_directory, sizeof(set->link_directory), "%.*s", (int) (last_slash - set->device_path),
+                 set->device_path);
+        if (strcmp(set->link_directory, INPUT_DEVICE_DIRECTORY) == 0) {
+            set->link_directory[0] = '\0';
+        }
+        watch_link_directory(set);
+    }
+
+    struct epoll_event hotplug_event = {.events = EPOLLIN, .data.fd = set->hotplug_file_descriptor};
+    if (epoll_ctl(set->epoll_file_descriptor, EPOLL_CTL_ADD, set->hotplug_file_descriptor, &hotplug_event) < 0) {
+        perror("Failed to register inotify instance with epoll");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Attaches the devices that have appeared in the device directory. Only device_path is considered if one was given,
+ * which matches when it, or the device it links to, appears; it is attached under its own path, so that a link to a
+ * replugged keyboard is followed to whichever device the keyboard now has.
+ *
+ * Returns the number of keyboards attached
+ */
+int process_hotplug_events(struct keyboard_set* set) {
+    char buffer[HOTPLUG_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int attached_count = 0;
+    ssize_t length;
+
+    while ((length = read(set->hotplug_file_descriptor, buffer, sizeof(buffer))) > 0) {
+        for (const char* position = buffer; position < buffer + length;) {
+            const struct inotify_event* event = (const struct inotify_event*) position;
+            position += sizeof(struct inotify_event) + event->len;
+
+            const bool in_link_directory = event->wd == set->link_watch_descriptor;
+            if (in_link_directory && (event->mask & IN_IGNORED) != 0) {
+                set->link_watch_descriptor = -1;
+            }
+            if (event->len == 0 || (!in_link_directory &&
+                                    strncmp(event->name, INPUT_DEVICE_PREFIX, strlen(INPUT_DEVICE_PREFIX)) != 0)) {
+                continue;
+            }
+
+            char path[PATH_MAX + NAME_MAX + 1];  // A directory, then a name from inotify
+            snprintf(path, sizeof(path), "%s/%s", in_link_directory ? set->link_directory : INPUT_DEVICE_DIRECTORY,
+                     event->name);
+            if (set->device_path == nullptr) {
+                attached_count += attach_keyboard(set, path, true) == 0 ? 1 : 0;
+            } else if (is_configured_device(set, path)) {
+                attached_count += attach_keyboard(set, set->device_path, false) == 0 ? 1 : 0;
+            }
+        }
+    }
+    // The link may have been created along with its directory, before the directory could be watched
+    if (watch_link_directory(set) && is_configured_device(set, set->device_path)) {
+        attached_count += attach_keyboard(set, set->device_path, false) == 0 ? 1 : 0;
+    }
+    return attached_count;
+}
+
+/*
+ * Returns the attached keyboard that reads from the given file descriptor, or nullptr if there is none
+ */
+struct keyboard* find_keyboard(struct keyboard_set* set, const int file_descriptor) {
+    for (int i = 0; i < MAX_KEYBOARDS; i++) {
+        if (set->keyboards[i].attached && libevdev_get_fd(set->keyboards[i].device) == file_descriptor) {
+            return &set->keyboards[i];
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Returns the number of keyboards currently attached
+ */
+int count_attached_keyboards(const struct keyboard_set* set) {
+    int attached_count = 0;
+    for (int i = 0; i < MAX_KEYBOARDS; i++) {
+        attached_count += set->keyboards[i].attached;
+    }
+    return attached_count;
+}
+
+/*
+ * Detaches every keyboard and stops watching the device directory
+ */
+void end_keyboards(struct keyboard_set* set) {
+    for (int i = 0; i < MAX_KEYBOARDS; i++) {
+        if (set->keyboards[i].attached) {
+            release_keyboard(set, &set->keyboards[i]);
+        }
+    }
+    if (set->hotplug_file_descriptor >= 0) {
+        close(set->hotplug_file_descriptor);
+        set->hotplug_file_descriptor = -1;
+    }
+}
@@ -0,0 +1,76 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Devices.h is the header file for defining the discovery of keyboards, and for attaching and detaching
+    them as they are plugged in and out.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_DEVICES_H
+#define STENOBYTE_DEVICES_H
+
+#include "StenoByte_Input.h"
+
+#include <limits.h>
+#include <stdbool.h>
+
+// Directory that holds the event devices, and the prefix of their names
+#define INPUT_DEVICE_DIRECTORY "/dev/input"
+#define INPUT_DEVICE_PREFIX "event"
+
+// Largest number of keyboards that can be attached at once
+#define MAX_KEYBOARDS 16
+
+// Number of bits in an unsigned long, used for the key bitmaps passed to the kernel
+#define BITS_PER_LONG (sizeof(unsigned long) * CHAR_BIT)
+
+// Size of the buffer that inotify events for the device directory are read into
+#define HOTPLUG_BUFFER_SIZE 4096
+
+struct keyboard {
+    bool attached;
+    char path[PATH_MAX];
+    struct libevdev* device;
+    struct input_source source; // Device Input Source reading from device
+};
+
+// The keyboards of a session, registered with the epoll instance of its event loop
+struct keyboard_set {
+    struct keyboard keyboards[MAX_KEYBOARDS];
+    int hotplug_file_descriptor;    // inotify instance watching INPUT_DEVICE_DIRECTORY
+    int link_watch_descriptor;  // inotify watch on link_directory, or -1 when there is none (yet)
+    char link_directory[PATH_MAX];  // Directory of device_path if it is not INPUT_DEVICE_DIRECTORY (e.g. a by-id link)
+    bool grab;  // Whether keyboards are grabbed so that their key events only reach StenoByte
+    bool raw_reads; // Whether keyboards are read in batches straight from the device instead of through libevdev
+    const char* device_path;    // The only keyboard to attach, or nullptr for every keyboard that is found
+    int epoll_file_descriptor;  // epoll instance the keyboards are registered with
+};
+
+// Methods & Functions
+void setup_keyboard_set(struct keyboard_set* set, const char* device_path, bool grab, bool raw_reads, int epoll_fd);
+bool is_chord_keyboard(const struct libevdev* device);
+void set_kernel_event_filter(int event_file_device);
+unsigned int get_held_bit_mask(const struct keyboard_set* set);
+int attach_keyboard(struct keyboard_set* set, const char* path, bool require_chord_keys);
+void detach_keyboard(struct keyboard_set* set, struct keyboard* keyboard);
+int discover_keyboards(struct keyboard_set* set);
+int setup_hotplug(struct keyboard_set* set);
+int process_hotplug_events(struct keyboard_set* set);
+struct keyboard* find_keyboard(struct keyboard_set* set, int file_descriptor);
+int count_attached_keyboards(const struct keyboard_set* set);
+void end_keyboards(struct keyboard_set* set);
+
+#endif //STENOBYTE_DEVICES_H
@@ -0,0 +1,519 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Dictionary.c is the source file for implementing the Dictionary: chords, or short sequences of chords,
+    that are written out as whole strings of bytes, and the Stroke Translator that looks them up as strokes arrive.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Dictionary.h"
+#include "StenoByte_Time.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// An entry read from the dictionary file, before the trie is built
+struct dictionary_entry {
+    chord_word strokes[MAX_DICTIONARY_STROKES];
+    int stroke_count;
+    int line_number;
+    u_int32_t output_offset;
+    u_int32_t output_length;
+};
+
+// A range of sorted entries that share their first depth strokes, waiting for its node to be filled in
+struct dictionary_build_range {
+    u_int32_t begin;
+    u_int32_t end;
+    int depth;
+    u_int32_t node;
+};
+
+/*
+ * Grows an array so that it can hold at least required elements
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int reserve_array(void** array, size_t* capacity, const size_t required, const size_t element_size) {
+    if (required <= *capacity) {
+        return 0;
+    }
+    size_t new_capacity = *capacity > 0 ? *capacity * 2 : 1024;
+    while (new_capacity < required) {
+        new_capacity *= 2;
+    }
+    void* grown = realloc(*array, new_capacity * element_size);
+    if (grown == nullptr) {
+        perror("Failed to allocate dictionary");
+        return 1;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+/*
+ * Parses a sequence of strokes such as "0x54/0x48", each the word its chord computes, in hex with or without "0x"
+ *
+ * Returns the number of strokes, or -1 if the sequence is not valid
+ */
+static int parse_strokes(const char* text, chord_word strokes[MAX_DICTIONARY_STROKES]) {
+    int stroke_count = 0;
+    while (true) {
+        char* end;
+        const unsigned long stroke = strtoul(text, &end, 16);
+        if (end == text || stroke >= CHORD_WORD_COUNT || stroke_count == MAX_DICTIONARY_STROKES) {
+            return -1;
+        }
+        strokes[stroke_count++] = (chord_word) stroke;
+        if (*end == '\0') {
+            return stroke_count;
+        }
+        if (*end != '/') {
+            return -1;
+        }
+        text = end + 1;
+    }
+}
+
+/*
+ * Parses a quoted output such as "the\n" into bytes, in place. The escapes are \n \t \r \0 \\ \" and \xHH.
+ *
+ * Returns the number of bytes, or -1 if the output is not valid
+ */
+static int parse_output(char* text) {
+    if (*text != '"') {
+        return -1;
+    }
+    const char* read = text + 1;
+    char* write = text;
+    while (*read != '"') {
+        if (*read == '\0' || *read == '\n') {
+            return -1;  // Not closed
+        }
+        if (*read != '\\') {
+            *write++ = *read++;
+            continue;
+        }
+        read++;
+        switch (*read) {
+            case 'n': *write++ = '\n'; break;
+            case 't': *write++ = '\t'; break;
+            case 'r': *write++ = '\r'; break;
+            case '0': *write++ = '\0'; break;
+            case '\\': *write++ = '\\'; break;
+            case '"': *write++ = '"'; break;
+            case 'x': {
+                char hex[3] = {read[1], read[1] != '\0' ? read[2] : '\0', '\0'};
+                char* end;
+                const long value = strtol(hex, &end, 16);
+                if (!isxdigit((unsigned char) hex[0]) || !isxdigit((unsigned char) hex[1]) || *end != '\0') {
+                    return -1;
+                }
+                *write++ = (char) value;
+                read += 2;
+                break;
+            }
+            default:
+                return -1;
+        }
+        read++;
+    }
+
+    // Only a comment may follow the output
+    for (read++; isspace((unsigned char) *read); read++) {}
+    if (*read != '\0' && *read != '#') {
+        return -1;
+    }
+    return (int) (write - text);
+}
+
+/*
+ * Orders entries by their strokes, so that an entry comes right before the longer entries it begins
+ */
+static int compare_entries(const void* a, const void* b) {
+    const struct dictionary_entry* left = a;
+    const struct dictionary_entry* right = b;
+    const int common_count = left->stroke_count < right->stroke_count ? left->stroke_count : right->stroke_count;
+    for (int i = 0; i < common_count; i++) {
+        if (left->strokes[i] != right->strokes[i]) {
+            return left->strokes[i] < right->strokes[i] ? -1 : 1;
+        }
+    }
+    return left->stroke_count - right->stroke_count;
+}
+
+/*
+ * Builds the trie from the sorted entries, one level at a time, so that the children of every node are allocated
+ * together and their edges are contiguous and sorted
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int build_dictionary_trie(struct chord_dictionary* dictionary, const struct dictionary_entry* entries,
+                                 const u_int32_t entry_count, const char* dictionary_file_path) {
+    // Every stroke of every entry adds at most one node
+    size_t max_node_count = 1;
+    for (u_int32_t i = 0; i < entry_count; i++) {
+        max_node_count += (size_t) entries[i].stroke_count;
+    }
+    if (max_node_count > UINT32_MAX) {
+        fprintf(stderr, "%s: Too many entries\n", dictionary_file_path);
+        return 1;
+    }
+    dictionary->nodes = malloc(max_node_count * sizeof(struct dictionary_node));
+    dictionary->edge_strokes = malloc(max_node_count * sizeof(chord_word));
+    dictionary->edge_targets = malloc(max_node_count * sizeof(u_int32_t));
+    dictionary->root_children = calloc(CHORD_WORD_COUNT, sizeof(u_int32_t));
+    struct dictionary_build_range* ranges = malloc(max_node_count * sizeof(struct dictionary_build_range));
+    if (dictionary->nodes == nullptr || dictionary->edge_strokes == nullptr || dictionary->edge_targets == nullptr ||
+        dictionary->root_children == nullptr || ranges == nullptr) {
+        perror("Failed to allocate dictionary");
+        free(ranges);
+        return 1;
+    }
+
+    u_int32_t edge_count = 0;
+    size_t range_head = 0;
+    size_t range_count = 0;
+    dictionary->node_count = 1;
+    ranges[range_count++] = (struct dictionary_build_range) {.begin = 0, .end = entry_count, .depth = 0, .node = 0};
+
+    int result = 0;
+    while (result == 0 && range_head < range_count) {
+        const struct dictionary_build_range range = ranges[range_head++];
+        struct dictionary_node* node = &dictionary->nodes[range.node];
+        *node = (struct dictionary_node) {.first_edge = edge_count, .output_offset = NO_DICTIONARY_OUTPUT};
+
+        // The entry that ends at this node sorts first; another one with the same strokes is a duplicate
+        u_int32_t begin = range.begin;
+        if (begin < range.end && entries[begin].stroke_count == range.depth) {
+            node->output_offset = entries[begin].output_offset;
+            node->output_length = entries[begin].output_length;
+            begin++;
+            if (begin < range.end && entries[begin].stroke_count == range.depth) {
+                const int first_line = entries[begin - 1].line_number;
+                const int second_line = entries[begin].line_number;
+                fprintf(stderr, "%s:%d: The strokes of line %d are defined again\n", dictionary_file_path,
+                        first_line > second_line ? first_line : second_line,
+                        first_line > second_line ? second_line : first_line);
+                result = 1;
+            }
+        }
+
+        // Every distinct next stroke becomes a child, covering the entries that continue with it
+        while (result == 0 && begin < range.end) {
+            const chord_word stroke = entries[begin].strokes[range.depth];
+            u_int32_t end = begin + 1;
+            while (end < range.end && entries[end].strokes[range.depth] == stroke) {
+                end++;
+            }
+
+            const u_int32_t child = dictionary->node_count++;
+            dictionary->edge_strokes[edge_count] = stroke;
+            dictionary->edge_targets[edge_count] = child;
+            edge_count++;
+            node->edge_count++;
+            if (range.node == 0) {
+                dictionary->root_children[stroke] = child;
+            }
+            ranges[range_count++] = (struct dictionary_build_range) {
+                .begin = begin, .end = end, .depth = range.depth + 1, .node = child
+            };
+            begin = end;
+        }
+    }
+    free(ranges);
+    return result;
+}
+
+/*
+ * Loads a Dictionary file and compiles it into a trie. Each line of the file is a sequence of strokes, separated by
+ * '/', followed by the output they are written out as:
+ *     0x54            "the "
+ *     0x54/0x48       "there "
+ *     0x7F/0x45       "\x7FELF\x02\x01\x01"
+ * Each stroke is the word its chord computes, in hex (a byte in the 8-bit build). The output is quoted, with the
+ * escapes \n \t \r \0 \\ \" and \xHH. Blank lines and lines starting with '#' are ignored.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int load_dictionary_file(struct chord_dictionary* dictionary, const char* dictionary_file_path) {
+    memset(dictionary, 0, sizeof(*dictionary));
+    FILE* dictionary_file = fopen(dictionary_file_path, "r");
+    if (dictionary_file == nullptr) {
+        perror("Failed to open dictionary file");
+        return 1;
+    }
+
+    struct dictionary_entry* entries = nullptr;
+    size_t entry_capacity = 0;
+    size_t outputs_capacity = 0;
+    char line[DICTIONARY_LINE_SIZE];
+    int line_number = 0;
+    int result = 0;
+
+    while (result == 0 && fgets(line, sizeof(line), dictionary_file) != nullptr) {
+        line_number++;
+        char strokes_text[DICTIONARY_STROKES_TEXT_SIZE];
+        int output_start = 0;
+        const int fields = sscanf(line, " %63s %n", strokes_text, &output_start);
+        if (fields <= 0 || strokes_text[0] == '#') {
+            continue;
+        }
+
+        struct dictionary_entry entry = {.line_number = line_number};
+        entry.stroke_count = parse_strokes(strokes_text, entry.strokes);
+        const int output_length = entry.stroke_count > 0 ? parse_output(line + output_start) : -1;
+        if (output_length < 0) {
+            fprintf(stderr, "%s:%d: Expected up to %d strokes in hex separated by '/', then a quoted output\n",
+                    dictionary_file_path, line_number, MAX_DICTIONARY_STROKES);
+            result = 1;
+            break;
+        }
+
+        if (reserve_array((void**) &entries, &entry_capacity, dictionary->entry_count + 1,
+                          sizeof(struct dictionary_entry)) != 0 ||
+            reserve_array((void**) &dictionary->outputs, &outputs_capacity,
+                          dictionary->outputs_size + (size_t) output_length, sizeof(u_int8_t)) != 0) {
+            result = 1;
+            break;
+        }
+        entry.output_offset = (u_int32_t) dictionary->outputs_size;
+        entry.output_length = (u_int32_t) output_length;
+        memcpy(dictionary->outputs + dictionary->outputs_size, line + output_start, (size_t) output_length);
+        dictionary->outputs_size += (size_t) output_length;
+        entries[dictionary->entry_count++] = entry;
+    }
+    fclose(dictionary_file);
+
+    if (result == 0) {
+        qsort(entries, dictionary->entry_count, sizeof(struct dictionary_entry), compare_entries);
+        result = build_dictionary_trie(dictionary, entries, dictionary->entry_count, dictionary_file_path);
+    }
+    free(entries);
+    if (result != 0) {
+        end_dictionary(dictionary);
+        return 1;
+    }
+    printf("Dictionary loaded: %u entries, %u nodes\n", dictionary->entry_count, dictionary->node_count);
+    return 0;
+}
+
+/*
+ * Frees the memory of a Dictionary
+ */
+void end_dictionary(struct chord_dictionary* dictionary) {
+    free(dictionary->nodes);
+    free(dictionary->edge_strokes);
+    free(dictionary->edge_targets);
+    free(dictionary->root_children);
+    free(dictionary->outputs);
+    memset(dictionary, 0, sizeof(*dictionary));
+}
+
+/*
+ * Gets the child of a node for a stroke
+ *
+ * Returns the index of the child, or 0 if the node has none for the stroke
+ */
+static u_int32_t find_dictionary_child(const struct chord_dictionary* dictionary, const u_int32_t node_index,
+                                       const chord_word stroke) {
+    if (node_index == 0) {
+        return dictionary->root_children[stroke];
+    }
+
+    const struct dictionary_node* node = &dictionary->nodes[node_index];
+    u_int32_t low = node->first_edge;
+    u_int32_t high = node->first_edge + node->edge_count;
+    while (low < high) {
+        const u_int32_t middle = low + (high - low) / 2;
+        if (dictionary->edge_strokes[middle] < stroke) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < node->first_edge + node->edge_count && dictionary->edge_strokes[low] == stroke
+               ? dictionary->edge_targets[low]
+               : 0;
+}
+
+/*
+ * Sets up a Stroke Translator. With a nullptr dictionary, every stroke is written out as its own word.
+ */
+void setup_stroke_translator(struct stroke_translator* translator, const struct chord_dictionary* dictionary,
+                             const int timeout_ms, const enum chord_byte_order byte_order) {
+    memset(translator, 0, sizeof(*translator));
+    translator->dictionary = dictionary;
+    translator->timeout_ms = timeout_ms;
+    translator->byte_order = byte_order;
+}
+
+/*
+ * Writes bytes to a Byte Sink
+ */
+static void write_to_sink(const struct byte_sink* sink, const u_int8_t* bytes, const size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        sink->write_byte(sink->context, bytes[i]);
+    }
+}
+
+/*
+ * Writes a stroke out as it is: a single byte in the 8-bit build, otherwise its word in the translator's byte order
+ */
+static void write_stroke_word([[maybe_unused]] const struct stroke_translator* translator, const struct byte_sink* sink,
+                              const chord_word stroke) {
+#if CHORD_WORD_SIZE == 1
+    sink->write_byte(sink->context, stroke);
+#else
+    u_int8_t bytes[CHORD_WORD_SIZE];
+    get_chord_word_bytes(stroke, translator->byte_order, bytes);
+    write_to_sink(sink, bytes, CHORD_WORD_SIZE);
+#endif
+}
+
+/*
+ * Writes out the pending strokes: the longest entry they begin with, or else the first stroke as its own word, over
+ * and over. Unless forced, strokes that could still be the start of a longer entry are left pending.
+ *
+ * Returns the number of bytes written
+ */
+static size_t resolve_pending_strokes(struct stroke_translator* translator, const struct byte_sink* sink,
+                                      const bool force) {
+    const struct chord_dictionary* dictionary = translator->dictionary;
+    size_t written = 0;
+
+    while (translator->pending_count > 0) {
+        u_int32_t node = 0;
+        u_int32_t match_node = 0;
+        int match_count = 0;
+        int depth = 0;
+        while (depth < translator->pending_count) {
+            const u_int32_t child = find_dictionary_child(dictionary, node, translator->pending_strokes[depth]);
+            if (child == 0) {
+                break;
+            }
+            node = child;
+            depth++;
+            if (dictionary->nodes[node].output_offset != NO_DICTIONARY_OUTPUT) {
+                match_node = node;
+                match_count = depth;
+            }
+        }
+
+        if (!force && depth == translator->pending_count && dictionary->nodes[node].edge_count > 0) {
+            translator->pending_node = node;
+            return written;
+        }
+
+        if (match_count > 0) {
+            const struct dictionary_node* match = &dictionary->nodes[match_node];
+            write_to_sink(sink, dictionary->outputs + match->output_offset, match->output_length);
+            written += match->output_length;
+        } else {
+            match_count = 1;    // Begins no entry: written out as it is
+            write_stroke_word(translator, sink, translator->pending_strokes[0]);
+            written += CHORD_WORD_SIZE;
+        }
+        translator->pending_count -= match_count;
+        memmove(translator->pending_strokes, translator->pending_strokes + match_count,
+                (size_t) translator->pending_count * sizeof(chord_word));
+    }
+    translator->pending_node = 0;
+    return written;
+}
+
+/*
+ * Translates a stroke made at time_us (its kernel timestamp in microseconds). Pending strokes the stroke came too late
+ * to continue are written out first.
+ *
+ * Returns the number of bytes written to the sink
+ */
+size_t translate_stroke(struct stroke_translator* translator, const chord_word stroke, const u_int64_t time_us,
+                        const struct byte_sink* sink) {
+    if (translator->dictionary == nullptr) {
+        write_stroke_word(translator, sink, stroke);
+        return CHORD_WORD_SIZE;
+    }
+
+    size_t written = 0;
+    if (translator->pending_count > 0 &&
+        time_us - translator->last_stroke_us >= (u_int64_t) translator->timeout_ms * 1000u) {
+        written += resolve_pending_strokes(translator, sink, true);
+    }
+    translator->last_stroke_us = time_us;
+    clock_gettime(CLOCK_MONOTONIC, &translator->last_stroke_time);
+
+    // Usually the stroke just continues the pending strokes, or starts a new sequence
+    const u_int32_t child = find_dictionary_child(translator->dictionary, translator->pending_node, stroke);
+    if (child != 0) {
+        const struct dictionary_node* node = &translator->dictionary->nodes[child];
+        if (node->edge_count == 0) {
+            translator->pending_count = 0;
+            translator->pending_node = 0;
+            write_to_sink(sink, translator->dictionary->outputs + node->output_offset, node->output_length);
+            return written + node->output_length;
+        }
+        if (translator->pending_count < MAX_DICTIONARY_STROKES) {
+            translator->pending_strokes[translator->pending_count++] = stroke;
+            translator->pending_node = child;
+            return written;
+        }
+    }
+
+    translator->pending_strokes[translator->pending_count++] = stroke;
+    return written + resolve_pending_strokes(translator, sink, false);
+}
+
+/*
+ * Gets how long the pending strokes may wait for the next stroke
+ *
+ * Returns the timeout in milliseconds, or -1 if no stroke is pending
+ */
+int get_translator_timeout_ms(const struct stroke_translator* translator) {
+    if (translator->pending_count == 0) {
+        return -1;
+    }
+    const long long remaining_ms = translator->timeout_ms - milliseconds_since(&translator->last_stroke_time);
+    return remaining_ms > 0 ? (int) remaining_ms : 0;
+}
+
+/*
+ * Writes out the pending strokes if they have waited for the next stroke for too long. Called by the event loop on
+ * timeouts.
+ *
+ * Returns the number of bytes written to the sink
+ */
+size_t process_translator_timeout(struct stroke_translator* translator, const struct byte_sink* sink) {
+    if (get_translator_timeout_ms(translator) != 0) {
+        return 0;
+    }
+    return resolve_pending_strokes(translator, sink, true);
+}
+
+/*
+ * Writes out every pending stroke, such as when the session ends
+ *
+ * Returns the number of bytes written to the sink
+ */
+size_t flush_stroke_translator(struct stroke_translator* translator, const struct byte_sink* sink) {
+    if (translator->pending_count == 0) {
+        return 0;
+    }
+    return resolve_pending_strokes(translator, sink, true);
+}
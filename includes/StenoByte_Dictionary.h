@@ -0,0 +1,101 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Dictionary.h is the header file for defining the Dictionary: chords, or short sequences of chords, that
+    are written out as whole strings of bytes, and the Stroke Translator that looks them up as strokes arrive.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_DICTIONARY_H
+#define STENOBYTE_DICTIONARY_H
+
+#include "StenoByte_Chord.h"
+#include "StenoByte_Output.h"
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Dictionary File
+#define DICTIONARY_LINE_SIZE 1024
+#define MAX_DICTIONARY_STROKES 8    // Longest sequence of chords in an entry
+
+// Default time a stroke that could still start a longer entry waits for the next stroke before it is written out
+#define DEFAULT_DICTIONARY_TIMEOUT_MS 1000
+
+// Longest sequence of strokes in a dictionary file line, written as hex words separated by '/'
+#define DICTIONARY_STROKES_TEXT_SIZE 64
+
+// Output offset of a node that no entry ends at
+#define NO_DICTIONARY_OUTPUT UINT32_MAX
+
+/*
+ * A node of the trie, reached by the sequence of strokes from the root. Its children are the edges in
+ * [first_edge, first_edge + edge_count), sorted by stroke so that they can be binary searched.
+ */
+struct dictionary_node {
+    u_int32_t first_edge;
+    u_int32_t edge_count;
+    u_int32_t output_offset;    // Where the output of the entry ending here starts, or NO_DICTIONARY_OUTPUT
+    u_int32_t output_length;
+};
+
+/*
+ * A Dictionary compiled into a trie when it is loaded. Every node's edges are stored contiguously, and the root's
+ * children are also indexed directly by stroke, so looking up a sequence takes one load for its first stroke and a
+ * binary search of at most CHORD_WORD_COUNT edges for each following one, however many entries the Dictionary holds.
+ */
+struct chord_dictionary {
+    struct dictionary_node* nodes;  // nodes[0] is the root
+    u_int32_t node_count;
+    chord_word* edge_strokes;   // The stroke of each edge
+    u_int32_t* edge_targets;    // The node each edge leads to
+    u_int32_t* root_children;   // The child of the root for each of the CHORD_WORD_COUNT strokes, 0 if there is none
+    u_int8_t* outputs;  // The outputs of every entry, back to back
+    size_t outputs_size;
+    u_int32_t entry_count;
+};
+
+/*
+ * Turns strokes into output through a Dictionary. Strokes that could still start a longer entry are held back until
+ * the next stroke shows which entry is meant, or until timeout_ms passes without one. The longest entry the held
+ * strokes begin with is then written out, and a stroke that begins no entry is written out as its own word, in
+ * byte_order.
+ */
+struct stroke_translator {
+    const struct chord_dictionary* dictionary;  // nullptr when strokes are written out as they are
+    int timeout_ms;
+    enum chord_byte_order byte_order;   // How strokes written out as they are are split into bytes
+    chord_word pending_strokes[MAX_DICTIONARY_STROKES];
+    int pending_count;
+    u_int32_t pending_node; // The node the pending strokes lead to
+    u_int64_t last_stroke_us;   // Kernel timestamp of the last pending stroke
+    struct timespec last_stroke_time;   // When the last pending stroke was translated
+};
+
+// Methods & Functions
+int load_dictionary_file(struct chord_dictionary* dictionary, const char* dictionary_file_path);
+void end_dictionary(struct chord_dictionary* dictionary);
+void setup_stroke_translator(struct stroke_translator* translator, const struct chord_dictionary* dictionary,
+                             int timeout_ms, enum chord_byte_order byte_order);
+size_t translate_stroke(struct stroke_translator* translator, chord_word stroke, u_int64_t time_us,
+                        const struct byte_sink* sink);
+int get_translator_timeout_ms(const struct stroke_translator* translator);
+size_t process_translator_timeout(struct stroke_translator* translator, const struct byte_sink* sink);
+size_t flush_stroke_translator(struct stroke_translator* translator, const struct byte_sink* sink);
+
+#endif //STENOBYTE_DICTIONARY_H
@@ -0,0 +1,319 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Editor.c is the file for the Editor: the output kept in a gap buffer in memory, with an undo history,
+    and written to the file from the first byte that changed.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Editor.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Allocates the buffer of an empty Editor, with the cursor at the start
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_output_editor(struct output_editor* editor) {
+    *editor = (struct output_editor) {0};
+    editor->text = malloc(EDITOR_INITIAL_CAPACITY);
+    if (editor->text == nullptr) {
+        perror("Failed to allocate editor buffer");
+        return 1;
+    }
+    editor->capacity = EDITOR_INITIAL_CAPACITY;
+    editor->gap_end = EDITOR_INITIAL_CAPACITY;
+    editor->new_step_pending = true;
+    return 0;
+}
+
+/*
+ * Gets the number of bytes in the Editor
+ */
+size_t get_editor_length(const struct output_editor* editor) {
+    return editor->capacity - (editor->gap_end - editor->gap_start);
+}
+
+/*
+ * Gets the number of bytes that the next flush writes (at least 1 if the file only needs to be cut short)
+ */
+size_t get_editor_pending_count(const struct output_editor* editor) {
+    const size_t length = get_editor_length(editor);
+    if (editor->dirty_from < length) {
+        return length - editor->dirty_from;
+    }
+    return editor->file_length != length ? 1 : 0;
+}
+
+/*
+ * Moves the cursor to a position (clamped to the end of the bytes) by moving the bytes between it and the cursor
+ * across the gap
+ */
+void move_editor_cursor(struct output_editor* editor, size_t position) {
+    const size_t length = get_editor_length(editor);
+    if (position > length) {
+        position = length;
+    }
+
+    if (position < editor->gap_start) {
+        const size_t moved = editor->gap_start - position;
+        memmove(editor->text + editor->gap_end - moved, editor->text + position, moved);
+        editor->gap_start -= moved;
+        editor->gap_end -= moved;
+    } else if (position > editor->gap_start) {
+        const size_t moved = position - editor->gap_start;
+        memmove(editor->text + editor->gap_start, editor->text + editor->gap_end, moved);
+        editor->gap_start += moved;
+        editor->gap_end += moved;
+    }
+}
+
+/*
+ * Makes the gap at least count bytes long, doubling the buffer until it is
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int grow_editor_gap(struct output_editor* editor, const size_t count) {
+    if (editor->gap_end - editor->gap_start >= count) {
+        return 0;
+    }
+
+    const size_t length = get_editor_length(editor);
+    size_t capacity = editor->capacity;
+    while (capacity - length < count) {
+        capacity *= 2;
+    }
+    u_int8_t* text = realloc(editor->text, capacity);
+    if (text == nullptr) {
+        perror("Failed to grow editor buffer");
+        return 1;
+    }
+
+    // The bytes after the cursor move to the end of the larger buffer
+    const size_t tail_length = editor->capacity - editor->gap_end;
+    memmove(text + capacity - tail_length, text + editor->gap_end, tail_length);
+    editor->text = text;
+    editor->gap_end = capacity - tail_length;
+    editor->capacity = capacity;
+    return 0;
+}
+
+/*
+ * Inserts bytes at the cursor and moves the cursor after them, without recording the change
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int insert_at_cursor(struct output_editor* editor, const u_int8_t* bytes, const size_t count) {
+    if (grow_editor_gap(editor, count) != 0) {
+        return 1;
+    }
+    memcpy(editor->text + editor->gap_start, bytes, count);
+    if (editor->gap_start < editor->dirty_from) {
+        editor->dirty_from = editor->gap_start;
+    }
+    editor->gap_start += count;
+    return 0;
+}
+
+/*
+ * Adds a change to the undo history, forgetting the oldest one when the history is full
+ */
+static void record_editor_change(struct output_editor* editor, const struct editor_change change) {
+    struct editor_change* slot = &editor->changes[editor->change_next];
+    if (editor->change_count == EDITOR_UNDO_STEPS) {
+        free(slot->deleted);
+    } else {
+        editor->change_count++;
+    }
+    *slot = change;
+    editor->change_next = (editor->change_next + 1) % EDITOR_UNDO_STEPS;
+}
+
+/*
+ * Gets the change that the next undo takes back, or nullptr if there is none
+ */
+static struct editor_change* get_last_editor_change(struct output_editor* editor) {
+    if (editor->change_count == 0) {
+        return nullptr;
+    }
+    return &editor->changes[(editor->change_next + EDITOR_UNDO_STEPS - 1) % EDITOR_UNDO_STEPS];
+}
+
+/*
+ * Inserts committed bytes at the cursor. Bytes inserted right after those of the last change are added to it, so that
+ * they are undone together, unless mark_editor_step() was called in between.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int insert_into_editor(struct output_editor* editor, const u_int8_t* bytes, const size_t count) {
+    const size_t position = editor->gap_start;
+    if (insert_at_cursor(editor, bytes, count) != 0) {
+        return 1;
+    }
+
+    struct editor_change* last_change = get_last_editor_change(editor);
+    if (!editor->new_step_pending && last_change != nullptr && last_change->kind == EDITOR_CHANGE_INSERT &&
+        last_change->position + last_change->length == position) {
+        last_change->length += count;
+    } else {
+        record_editor_change(editor, (struct editor_change) {
+            .kind = EDITOR_CHANGE_INSERT, .position = position, .length = count
+        });
+    }
+    editor->new_step_pending = false;
+    return 0;
+}
+
+/*
+ * Makes the next insert a change of its own, such as at the start of a stroke
+ */
+void mark_editor_step(struct output_editor* editor) {
+    editor->new_step_pending = true;
+}
+
+/*
+ * Deletes up to count bytes before the cursor, keeping them so that the deletion can be undone
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int delete_before_cursor(struct output_editor* editor, size_t count) {
+    editor->new_step_pending = true;
+    if (count > editor->gap_start) {
+        count = editor->gap_start;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    u_int8_t* deleted = malloc(count);
+    if (deleted == nullptr) {
+        perror("Failed to allocate undo history");
+        return 1;
+    }
+    editor->gap_start -= count;
+    memcpy(deleted, editor->text + editor->gap_start, count);
+    if (editor->gap_start < editor->dirty_from) {
+        editor->dirty_from = editor->gap_start;
+    }
+    record_editor_change(editor, (struct editor_change) {
+        .kind = EDITOR_CHANGE_DELETE, .position = editor->gap_start, .length = count, .deleted = deleted
+    });
+    return 0;
+}
+
+/*
+ * Takes back up to count of the last changes, newest first, leaving the cursor where it was before each of them
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int undo_editor_changes(struct output_editor* editor, const size_t count) {
+    editor->new_step_pending = true;
+    for (size_t i = 0; i < count && editor->change_count > 0; i++) {
+        struct editor_change* change = get_last_editor_change(editor);
+        if (change->kind == EDITOR_CHANGE_INSERT) {
+            move_editor_cursor(editor, change->position + change->length);
+            editor->gap_start = change->position;
+            if (change->position < editor->dirty_from) {
+                editor->dirty_from = change->position;
+            }
+        } else {
+            move_editor_cursor(editor, change->position);
+            if (insert_at_cursor(editor, change->deleted, change->length) != 0) {
+                return 1;
+            }
+            free(change->deleted);
+        }
+        *change = (struct editor_change) {0};
+        editor->change_next = (editor->change_next + EDITOR_UNDO_STEPS - 1) % EDITOR_UNDO_STEPS;
+        editor->change_count--;
+    }
+    return 0;
+}
+
+/*
+ * Writes all of a span of bytes at an offset in the file, retrying on interrupted and partial writes
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int write_editor_span(const int file_descriptor, const u_int8_t* bytes, const size_t count, const off_t offset) {
+    size_t total = 0;
+    while (total < count) {
+        const ssize_t written = pwrite(file_descriptor, bytes + total, count - total, offset + (off_t) total);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write to output file");
+            return 1;
+        }
+        total += (size_t) written;
+    }
+    return 0;
+}
+
+/*
+ * Writes the bytes from the first one that changed to the end over the file (the bytes before it are already there),
+ * then cuts off whatever is left past the end if the output got shorter. Adds the number of bytes written to
+ * bytes_written.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int flush_output_editor(struct output_editor* editor, const int file_descriptor, u_int64_t* bytes_written) {
+    const size_t length = get_editor_length(editor);
+    size_t position = editor->dirty_from;
+
+    // The bytes before the cursor, then the bytes after it
+    if (position < editor->gap_start) {
+        if (write_editor_span(file_descriptor, editor->text + position, editor->gap_start - position,
+                              (off_t) position) != 0) {
+            return 1;
+        }
+        *bytes_written += editor->gap_start - position;
+        position = editor->gap_start;
+    }
+    if (position < length) {
+        if (write_editor_span(file_descriptor, editor->text + editor->gap_end + (position - editor->gap_start),
+                              length - position, (off_t) position) != 0) {
+            return 1;
+        }
+        *bytes_written += length - position;
+    }
+
+    if (editor->file_length > length && ftruncate(file_descriptor, (off_t) length) != 0) {
+        perror("Failed to truncate output file");
+        return 1;
+    }
+    editor->dirty_from = length;
+    editor->file_length = length;
+    return 0;
+}
+
+/*
+ * Frees the buffer and the undo history of the Editor
+ */
+void end_output_editor(struct output_editor* editor) {
+    for (size_t i = 0; i < EDITOR_UNDO_STEPS; i++) {
+        free(editor->changes[i].deleted);
+        editor->changes[i].deleted = nullptr;
+    }
+    free(editor->text);
+    editor->text = nullptr;
+}
@@ -0,0 +1,81 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Editor.h is the header file for defining the Editor, which keeps the output in memory as a gap buffer so
+    that bytes can be deleted, undone and inserted at a cursor, and only writes the part of the file that changed.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_EDITOR_H
+#define STENOBYTE_EDITOR_H
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size of the buffer when the Editor is set up; it doubles whenever the gap runs out
+#define EDITOR_INITIAL_CAPACITY 65536
+
+// Number of changes that can be undone; older ones are forgotten
+#define EDITOR_UNDO_STEPS 1024
+
+enum editor_change_kind {
+    EDITOR_CHANGE_INSERT = 0,   // Bytes were inserted
+    EDITOR_CHANGE_DELETE        // Bytes were deleted
+};
+
+// A change that can be undone
+struct editor_change {
+    enum editor_change_kind kind;
+    size_t position;    // Where the bytes were inserted or deleted
+    size_t length;      // Number of bytes inserted or deleted
+    u_int8_t* deleted;  // EDITOR_CHANGE_DELETE: the bytes deleted, to insert them again
+};
+
+/*
+ * The output as a gap buffer: the bytes before the cursor are at the start of text, the bytes after it at the end,
+ * with the gap between them, so that inserting or deleting at the cursor never moves the rest of the output
+ */
+struct output_editor {
+    u_int8_t* text;     // nullptr when no Editor is set up
+    size_t capacity;
+    size_t gap_start;   // The cursor: the number of bytes before it
+    size_t gap_end;     // Index of the first byte after the cursor
+
+    size_t dirty_from;  // Position of the first byte that differs from the file
+    size_t file_length; // Number of bytes in the file
+
+    struct editor_change changes[EDITOR_UNDO_STEPS];    // Ring of the changes that can be undone
+    size_t change_next; // Index of the slot of the next change
+    size_t change_count;
+    bool new_step_pending;  // Whether the next insert starts a change of its own, rather than extending the last one
+
+    u_int64_t edits_applied;    // Counter of backspaces, undos & cursor movements
+};
+
+// Methods & Functions
+int setup_output_editor(struct output_editor* editor);
+size_t get_editor_length(const struct output_editor* editor);
+size_t get_editor_pending_count(const struct output_editor* editor);
+int insert_into_editor(struct output_editor* editor, const u_int8_t* bytes, size_t count);
+void mark_editor_step(struct output_editor* editor);
+int delete_before_cursor(struct output_editor* editor, size_t count);
+int undo_editor_changes(struct output_editor* editor, size_t count);
+void move_editor_cursor(struct output_editor* editor, size_t position);
+int flush_output_editor(struct output_editor* editor, int file_descriptor, u_int64_t* bytes_written);
+void end_output_editor(struct output_editor* editor);
+
+#endif //STENOBYTE_EDITOR_H
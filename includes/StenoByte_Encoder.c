@@ -0,0 +1,556 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Encoder.c is the source file for implementing the Encoders, which turn a stream of committed bytes into
+    hex, a canonical hexdump, base64 or a C array as it arrives, keeping their place between batches.
+    The hex & base64 kernels use SSSE3 when the CPU has it, and plain C otherwise.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Encoder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STENOBYTE_SSSE3_KERNELS 1
+#else
+#define STENOBYTE_SSSE3_KERNELS 0
+#endif
+
+#define C_ARRAY_HEADER "unsigned char " C_ARRAY_NAME "[] = {\n"
+
+static const char hex_digits[] = "0123456789abcdef";
+static const char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const char* const encoding_names[] = {
+    [ENCODING_RAW] = "raw",
+    [ENCODING_HEX] = "hex",
+    [ENCODING_HEXDUMP] = "hexdump",
+    [ENCODING_BASE64] = "base64",
+    [ENCODING_C_ARRAY] = "c"
+};
+
+// Set before any encoding starts, so that the kernels can be compared
+static bool scalar_kernels_forced = false;
+
+/*
+ * Parses the name of an encoding: raw, hex, hexdump, base64 or c
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int parse_byte_encoding(const char* name, enum byte_encoding* encoding) {
+    for (size_t i = 0; i < sizeof(encoding_names) / sizeof(encoding_names[0]); i++) {
+        if (strcmp(name, encoding_names[i]) == 0) {
+            *encoding = (enum byte_encoding) i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Returns the name of an encoding, as accepted by parse_byte_encoding()
+ */
+const char* get_byte_encoding_name(const enum byte_encoding encoding) {
+    return encoding_names[encoding];
+}
+
+/*
+ * Makes every encoder use the plain C kernels even when the CPU has SSSE3. Must be called before encoding starts.
+ */
+void use_scalar_encoder_kernels(const bool scalar) {
+    scalar_kernels_forced = scalar;
+}
+
+/*
+ * Returns whether the SSSE3 kernels are used
+ */
+static bool has_ssse3_kernels() {
+#if STENOBYTE_SSSE3_KERNELS
+    return !scalar_kernels_forced && __builtin_cpu_supports("ssse3");
+#else
+    return false;
+#endif
+}
+
+/*
+ * Returns the name of the kernels the encoders use: ssse3 or scalar
+ */
+const char* get_encoder_kernel_name() {
+    return has_ssse3_kernels() ? "ssse3" : "scalar";
+}
+
+#if STENOBYTE_SSSE3_KERNELS
+/*
+ * Writes the 2 hex digits of each of 16 bytes, looking the high & low nibbles up with a shuffle
+ */
+[[gnu::target("ssse3")]]
+static void encode_hex_block_ssse3(const u_int8_t* bytes, char* output) {
+    const __m128i digits = _mm_loadu_si128((const __m128i*) hex_digits);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+
+    const __m128i input = _mm_loadu_si128((const __m128i*) bytes);
+    const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask));
+    const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(input, nibble_mask));
+    _mm_storeu_si128((__m128i*) output, _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128((__m128i*) (output + 16), _mm_unpackhi_epi8(high, low));
+}
+
+/*
+ * Writes 16 bytes as chars, with every byte outside of ' ' to '~' replaced by '.'
+ */
+[[gnu::target("ssse3")]]
+static void encode_printable_block_ssse3(const u_int8_t* bytes, char* output) {
+    const __m128i input = _mm_loadu_si128((const __m128i*) bytes);
+    // Signed compares: bytes from 0x80 are negative, so they fail the first one
+    const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(0x1f)),
+                                            _mm_cmplt_epi8(input, _mm_set1_epi8(0x7f)));
+    const __m128i result = _mm_or_si128(_mm_and_si128(printable, input),
+                                        _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+    _mm_storeu_si128((__m128i*) output, result);
+}
+
+/*
+ * Writes the 16 base64 digits of the first 12 of 16 readable bytes: the 4 groups of 3 bytes are spread over 4 lanes of
+ * 32 bits, their 6 bit indices are moved into place with multiplies, and each index is turned into its digit by adding
+ * the offset of its range, which is looked up with a shuffle
+ */
+[[gnu::target("ssse3")]]
+static void encode_base64_block_ssse3(const u_int8_t* bytes, char* output) {
+    __m128i input = _mm_loadu_si128((const __m128i*) bytes);
+    input = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    const __m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+                                         _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+                                        _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(high, low);
+
+    // 0 for a-z, 1 to 10 for 0-9, 11 for +, 12 for /, 13 for A-Z
+    __m128i ranges = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    ranges = _mm_or_si128(ranges, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    _mm_storeu_si128((__m128i*) output, _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, ranges)));
+}
+#endif
+
+/*
+ * Writes the 2 hex digits of each byte. From 16 bytes on, the SSSE3 kernel covers the tail by encoding the last 16
+ * bytes again, overlapping the block before.
+ */
+static void encode_hex_digits(const u_int8_t* bytes, const size_t count, char* output) {
+    size_t i = 0;
+#if STENOBYTE_SSSE3_KERNELS
+    if (count >= 16 && has_ssse3_kernels()) {
+        for (; i + 16 <= count; i += 16) {
+            encode_hex_block_ssse3(bytes + i, output + 2 * i);
+        }
+        if (i < count) {
+            encode_hex_block_ssse3(bytes + count - 16, output + 2 * (count - 16));
+        }
+        return;
+    }
+#endif
+    for (; i < count; i++) {
+        output[2 * i] = hex_digits[bytes[i] >> 4];
+        output[2 * i + 1] = hex_digits[bytes[i] & 0x0f];
+    }
+}
+
+/*
+ * Writes the bytes as chars, with every byte outside of ' ' to '~' replaced by '.'
+ */
+static void encode_printable_chars(const u_int8_t* bytes, const size_t count, char* output) {
+#if STENOBYTE_SSSE3_KERNELS
+    if (count == 16 && has_ssse3_kernels()) {
+        encode_printable_block_ssse3(bytes, output);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        output[i] = bytes[i] >= ' ' && bytes[i] <= '~' ? (char) bytes[i] : '.';
+    }
+}
+
+/*
+ * Writes the 4 base64 digits of each group of 3 bytes. available is the number of readable bytes from bytes on, which
+ * the SSSE3 kernel needs to be at least 16.
+ */
+static void encode_base64_groups(const u_int8_t* bytes, const size_t groups, const size_t available, char* output) {
+    size_t group = 0;
+#if STENOBYTE_SSSE3_KERNELS
+    if (has_ssse3_kernels()) {
+        for (; group + 4 <= groups && 3 * group + 16 <= available; group += 4) {
+            encode_base64_block_ssse3(bytes + 3 * group, output + 4 * group);
+        }
+    }
+#endif
+    for (; group < groups; group++) {
+        const u_int8_t* input = bytes + 3 * group;
+        char* digits = output + 4 * group;
+        digits[0] = base64_digits[input[0] >> 2];
+        digits[1] = base64_digits[(input[0] & 0x03) << 4 | input[1] >> 4];
+        digits[2] = base64_digits[(input[1] & 0x0f) << 2 | input[2] >> 6];
+        digits[3] = base64_digits[input[2] & 0x3f];
+    }
+}
+
+/*
+ * Sets up an encoder at the start of a stream
+ */
+void setup_byte_encoder(struct byte_encoder* encoder, const enum byte_encoding encoding) {
+    *encoder = (struct byte_encoder){.encoding = encoding};
+}
+
+/*
+ * Returns the most chars that encoding count bytes can write in one call of encode_bytes(), whatever was encoded
+ * before them
+ */
+size_t get_encoded_size_bound(const enum byte_encoding encoding, const size_t count) {
+    switch (encoding) {
+        case ENCODING_HEX:
+            return 2 * count + count / HEX_LINE_BYTES + 1;
+        case ENCODING_HEXDUMP:
+            // A line is at most 79 chars with a 16 digit offset, and the unfinished line may be completed first
+            return (count / HEXDUMP_LINE_BYTES + 1) * 88;
+        case ENCODING_BASE64: {
+            const size_t digits = (count / 3 + 1) * 4;
+            return digits + digits / BASE64_LINE_CHARS + 1;
+        }
+        case ENCODING_C_ARRAY:
+            return sizeof(C_ARRAY_HEADER) + 6 * count + 2 * (count / C_ARRAY_LINE_BYTES + 1);
+        default:
+            return count;
+    }
+}
+
+/*
+ * Returns the most bytes that can be encoded into space chars, going by get_encoded_size_bound()
+ */
+size_t get_encodable_count(const enum byte_encoding encoding, const size_t space) {
+    size_t low = 0;
+    size_t high = space;
+    while (low < high) {
+        const size_t middle = low + (high - low + 1) / 2;
+        if (get_encoded_size_bound(encoding, middle) <= space) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+/*
+ * Writes an offset as at least 8 hex digits
+ *
+ * Returns the number of chars written
+ */
+static size_t write_hexdump_offset(const u_int64_t offset, char* output) {
+    size_t digits = 8;
+    while (digits < 16 && offset >> 4 * digits != 0) {
+        digits++;
+    }
+    for (size_t i = 0; i < digits; i++) {
+        output[i] = hex_digits[offset >> 4 * (digits - 1 - i) & 0x0f];
+    }
+    return digits;
+}
+
+/*
+ * Writes a line of the hexdump, or "*" in place of the first of a run of full lines that repeat the one before
+ *
+ * Returns the number of chars written
+ */
+static size_t write_hexdump_line(struct byte_encoder* encoder, const u_int8_t* line, const size_t length,
+                                 char* output) {
+    const u_int64_t offset = encoder->offset;
+    encoder->offset += length;
+    if (length == HEXDUMP_LINE_BYTES) {
+        if (encoder->has_previous_line && memcmp(line, encoder->previous_line, HEXDUMP_LINE_BYTES) == 0) {
+            if (encoder->squeezing) {
+                return 0;
+            }
+            encoder->squeezing = true;
+            memcpy(output, "*\n", 2);
+            return 2;
+        }
+        memcpy(encoder->previous_line, line, HEXDUMP_LINE_BYTES);
+        encoder->has_previous_line = true;
+    }
+    encoder->squeezing = false;
+
+    char digits[2 * HEXDUMP_LINE_BYTES];
+    encode_hex_digits(line, length, digits);
+
+    char* out = output + write_hexdump_offset(offset, output);
+    *out++ = ' ';
+    for (size_t i = 0; i < HEXDUMP_LINE_BYTES; i++) {
+        if (i % 8 == 0) {
+            *out++ = ' ';
+        }
+        if (i < length) {
+            out[0] = digits[2 * i];
+            out[1] = digits[2 * i + 1];
+        } else {
+            out[0] = ' ';
+            out[1] = ' ';
+        }
+        out[2] = ' ';
+        out += 3;
+    }
+    *out++ = ' ';
+    *out++ = '|';
+    encode_printable_chars(line, length, out);
+    out += length;
+    *out++ = '|';
+    *out++ = '\n';
+    return (size_t) (out - output);
+}
+
+/*
+ * Encodes bytes as plain hex, breaking the lines every HEX_LINE_BYTES bytes
+ *
+ * Returns the number of chars written
+ */
+static size_t encode_hex(struct byte_encoder* encoder, const u_int8_t* bytes, size_t count, char* output) {
+    char* out = output;
+    while (count > 0) {
+        size_t length = HEX_LINE_BYTES - encoder->column;
+        if (length > count) {
+            length = count;
+        }
+        encode_hex_digits(bytes, length, out);
+        out += 2 * length;
+        bytes += length;
+        count -= length;
+        encoder->column += length;
+        if (encoder->column == HEX_LINE_BYTES) {
+            *out++ = '\n';
+            encoder->column = 0;
+        }
+    }
+    return (size_t) (out - output);
+}
+
+/*
+ * Encodes bytes as a canonical hexdump. Lines are only written once they are full; the unfinished one waits in the
+ * encoder.
+ *
+ * Returns the number of chars written
+ */
+static size_t encode_hexdump(struct byte_encoder* encoder, const u_int8_t* bytes, size_t count, char* output) {
+    char* out = output;
+    if (encoder->pending_count > 0) {
+        size_t length = HEXDUMP_LINE_BYTES - encoder->pending_count;
+        if (length > count) {
+            length = count;
+        }
+        memcpy(encoder->pending + encoder->pending_count, bytes, length);
+        encoder->pending_count += length;
+        bytes += length;
+        count -= length;
+        if (encoder->pending_count < HEXDUMP_LINE_BYTES) {
+            return 0;
+        }
+        out += write_hexdump_line(encoder, encoder->pending, HEXDUMP_LINE_BYTES, out);
+        encoder->pending_count = 0;
+    }
+
+    // Full lines are written straight from the bytes
+    for (; count >= HEXDUMP_LINE_BYTES; bytes += HEXDUMP_LINE_BYTES, count -= HEXDUMP_LINE_BYTES) {
+        out += write_hexdump_line(encoder, bytes, HEXDUMP_LINE_BYTES, out);
+    }
+    memcpy(encoder->pending, bytes, count);
+    encoder->pending_count = count;
+    return (size_t) (out - output);
+}
+
+/*
+ * Writes base64 digits, breaking the lines every BASE64_LINE_CHARS chars
+ *
+ * Returns the number of chars written
+ */
+static size_t write_base64_groups(struct byte_encoder* encoder, const u_int8_t* bytes, size_t groups,
+                                  size_t available, char* output) {
+    char* out = output;
+    while (groups > 0) {
+        size_t line_groups = (BASE64_LINE_CHARS - encoder->column) / 4;
+        if (line_groups > groups) {
+            line_groups = groups;
+        }
+        encode_base64_groups(bytes, line_groups, available, out);
+        out += 4 * line_groups;
+        bytes += 3 * line_groups;
+        available -= 3 * line_groups;
+        groups -= line_groups;
+        encoder->column += 4 * line_groups;
+        if (encoder->column == BASE64_LINE_CHARS) {
+            *out++ = '\n';
+            encoder->column = 0;
+        }
+    }
+    return (size_t) (out - output);
+}
+
+/*
+ * Encodes bytes as base64. The bytes of an unfinished group of 3 wait in the encoder.
+ *
+ * Returns the number of chars written
+ */
+static size_t encode_base64(struct byte_encoder* encoder, const u_int8_t* bytes, size_t count, char* output) {
+    char* out = output;
+    if (encoder->pending_count > 0) {
+        while (encoder->pending_count < 3 && count > 0) {
+            encoder->pending[encoder->pending_count++] = *bytes++;
+            count--;
+        }
+        if (encoder->pending_count < 3) {
+            return 0;
+        }
+        out += write_base64_groups(encoder, encoder->pending, 1, 3, out);
+        encoder->pending_count = 0;
+    }
+
+    const size_t groups = count / 3;
+    out += write_base64_groups(encoder, bytes, groups, count, out);
+    memcpy(encoder->pending, bytes + 3 * groups, count - 3 * groups);
+    encoder->pending_count = count - 3 * groups;
+    return (size_t) (out - output);
+}
+
+/*
+ * Encodes bytes as the elements of a C array, writing the array's header before the first one
+ *
+ * Returns the number of chars written
+ */
+static size_t encode_c_array(struct byte_encoder* encoder, const u_int8_t* bytes, size_t count, char* output) {
+    char* out = output;
+    if (!encoder->started) {
+        memcpy(out, C_ARRAY_HEADER, sizeof(C_ARRAY_HEADER) - 1);
+        out += sizeof(C_ARRAY_HEADER) - 1;
+        encoder->started = true;
+    }
+
+    char digits[2 * 256];
+    while (count > 0) {
+        const size_t length = count < 256 ? count : 256;
+        encode_hex_digits(bytes, length, digits);
+        for (size_t i = 0; i < length; i++) {
+            if (encoder->offset > 0) {
+                if (encoder->column == C_ARRAY_LINE_BYTES) {
+                    *out++ = ',';
+                    *out++ = '\n';
+                    encoder->column = 0;
+                } else {
+                    *out++ = ',';
+                    *out++ = ' ';
+                }
+            }
+            if (encoder->column == 0) {
+                *out++ = ' ';
+                *out++ = ' ';
+            }
+            out[0] = '0';
+            out[1] = 'x';
+            out[2] = digits[2 * i];
+            out[3] = digits[2 * i + 1];
+            out += 4;
+            encoder->column++;
+            encoder->offset++;
+        }
+        bytes += length;
+        count -= length;
+    }
+    return (size_t) (out - output);
+}
+
+/*
+ * Encodes the next bytes of the stream into output, which must have room for get_encoded_size_bound() chars
+ *
+ * Returns the number of chars written
+ */
+size_t encode_bytes(struct byte_encoder* encoder, const u_int8_t* bytes, const size_t count, char* output) {
+    switch (encoder->encoding) {
+        case ENCODING_HEX:
+            return encode_hex(encoder, bytes, count, output);
+        case ENCODING_HEXDUMP:
+            return encode_hexdump(encoder, bytes, count, output);
+        case ENCODING_BASE64:
+            return encode_base64(encoder, bytes, count, output);
+        case ENCODING_C_ARRAY:
+            return encode_c_array(encoder, bytes, count, output);
+        default:
+            memcpy(output, bytes, count);
+            return count;
+    }
+}
+
+/*
+ * Writes what ends the stream into output, which must have room for ENCODER_TAIL_SIZE chars: the unfinished line or
+ * group, base64 padding, the hexdump's final offset, or the end of the C array & its length
+ *
+ * Returns the number of chars written
+ */
+size_t finish_byte_encoder(struct byte_encoder* encoder, char* output) {
+    char* out = output;
+    switch (encoder->encoding) {
+        case ENCODING_HEX:
+            if (encoder->column > 0) {
+                *out++ = '\n';
+            }
+            break;
+        case ENCODING_HEXDUMP:
+            if (encoder->pending_count > 0) {
+                out += write_hexdump_line(encoder, encoder->pending, encoder->pending_count, out);
+            }
+            if (encoder->offset > 0) {
+                out += write_hexdump_offset(encoder->offset, out);
+                *out++ = '\n';
+            }
+            break;
+        case ENCODING_BASE64:
+            if (encoder->pending_count > 0) {
+                const u_int8_t* input = encoder->pending;
+                const bool two_bytes = encoder->pending_count == 2;
+                out[0] = base64_digits[input[0] >> 2];
+                out[1] = base64_digits[(input[0] & 0x03) << 4 | (two_bytes ? input[1] >> 4 : 0)];
+                out[2] = two_bytes ? base64_digits[(input[1] & 0x0f) << 2] : '=';
+                out[3] = '=';
+                out += 4;
+                encoder->column += 4;
+            }
+            if (encoder->column > 0) {
+                *out++ = '\n';
+            }
+            break;
+        case ENCODING_C_ARRAY:
+            if (!encoder->started) {
+                out += encode_c_array(encoder, nullptr, 0, out);
+            }
+            out += sprintf(out, "%s};\nunsigned int " C_ARRAY_NAME "_len = %llu;\n", encoder->offset > 0 ? "\n" : "",
+                           (unsigned long long) encoder->offset);
+            break;
+        default:
+            break;
+    }
+    encoder->pending_count = 0;
+    encoder->column = 0;
+    return (size_t) (out - output);
+}
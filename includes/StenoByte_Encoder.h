@@ -0,0 +1,77 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Encoder.h is the header file for defining the Encoders, which turn a stream of committed bytes into hex,
+    a canonical hexdump, base64 or a C array as it arrives, keeping their place between batches.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_ENCODER_H
+#define STENOBYTE_ENCODER_H
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bytes per line of each encoding, as written by xxd -p, hexdump -C, base64 and xxd -i
+#define HEX_LINE_BYTES 30
+#define HEXDUMP_LINE_BYTES 16
+#define BASE64_LINE_CHARS 76
+#define C_ARRAY_LINE_BYTES 12
+
+// Name of the array written by ENCODING_C_ARRAY; its length is written as NAME_len
+#define C_ARRAY_NAME "stenobyte_bytes"
+
+// Size of a buffer that always holds what encoding a single byte, or finishing an encoder, writes
+#define ENCODER_TAIL_SIZE 256
+
+enum byte_encoding {
+    ENCODING_RAW = 0,   // The bytes themselves
+    ENCODING_HEX,       // Plain lowercase hex, 30 bytes per line (as xxd -p)
+    ENCODING_HEXDUMP,   // Offset, hex & printable chars, 16 bytes per line, repeated lines as "*" (as hexdump -C)
+    ENCODING_BASE64,    // Standard base64 with padding, 76 chars per line (as base64)
+    ENCODING_C_ARRAY    // An unsigned char array definition followed by its length (as xxd -i)
+};
+
+// The state an encoder keeps between batches
+struct byte_encoder {
+    enum byte_encoding encoding;
+    bool started;       // Whether anything has been encoded (ENCODING_C_ARRAY: whether the header has been written)
+    u_int64_t offset;   // Number of bytes encoded (ENCODING_HEXDUMP: up to the start of the unfinished line)
+    size_t column;      // ENCODING_HEX & ENCODING_C_ARRAY: bytes on the current line; ENCODING_BASE64: chars on it
+
+    // ENCODING_HEXDUMP: the bytes of the unfinished line; ENCODING_BASE64: the bytes of the unfinished 3 byte group
+    u_int8_t pending[HEXDUMP_LINE_BYTES];
+    size_t pending_count;
+
+    // ENCODING_HEXDUMP: the last full line, so that repeats of it are written as a single "*"
+    u_int8_t previous_line[HEXDUMP_LINE_BYTES];
+    bool has_previous_line;
+    bool squeezing;
+};
+
+// Methods & Functions
+int parse_byte_encoding(const char* name, enum byte_encoding* encoding);
+const char* get_byte_encoding_name(enum byte_encoding encoding);
+void use_scalar_encoder_kernels(bool scalar);
+const char* get_encoder_kernel_name();
+void setup_byte_encoder(struct byte_encoder* encoder, enum byte_encoding encoding);
+size_t get_encoded_size_bound(enum byte_encoding encoding, size_t count);
+size_t get_encodable_count(enum byte_encoding encoding, size_t space);
+size_t encode_bytes(struct byte_encoder* encoder, const u_int8_t* bytes, size_t count, char* output);
+size_t finish_byte_encoder(struct byte_encoder* encoder, char* output);
+
+#endif //STENOBYTE_ENCODER_H
@@ -0,0 +1,828 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Fanout.c is the source file for implementing the Fan-out. The thread writing the output pushes each
+    committed byte to a queue and wakes the fan-out thread once per batch; the fan-out thread copies the bytes into the
+    buffer of every consumer and writes them out without blocking, so a consumer that falls behind only ever holds up
+    its own buffer, unless its sink's policy is to block.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Fanout.h"
+#include "StenoByte_Time.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Number of bytes moved from the queue to the consumers at a time
+#define FANOUT_BATCH_SIZE 4096
+
+// Number of chars a batch may encode to; get_encoded_size_bound() of FANOUT_BATCH_SIZE is below it for every encoding
+#define FANOUT_ENCODED_BATCH_SIZE (8 * FANOUT_BATCH_SIZE)
+
+// Number of epoll events the fan-out thread handles per wake-up
+#define FANOUT_MAX_EVENTS 16
+
+// How long the writing thread sleeps before trying again when the fan-out queue is full
+#define FANOUT_BACKOFF_NS 50000
+
+// epoll tags: the wake-up eventfd, or a sink's index in the high bits and a consumer slot (or the listening socket)
+#define FANOUT_WAKE_TAG UINT64_MAX
+#define FANOUT_LISTENER_SLOT 0xFF
+
+// stdout as it was before reserve_stdout_for_sink(), or -1 if it was not reserved
+static int reserved_stdout_file_descriptor = -1;
+
+/*
+ * Parses a sink given as KIND[:PATH][,POLICY][,ENCODING], where KIND is file, stdout, fifo or socket, POLICY is drop
+ * (the default), block or disconnect, and ENCODING is one of parse_byte_encoding()'s (raw by default). The spec points
+ * into value, which must outlive it.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int parse_sink_spec(struct sink_spec* spec, const char* value) {
+    static const char* const policy_names[] = {[SINK_DROP] = "drop", [SINK_BLOCK] = "block",
+                                               [SINK_DISCONNECT] = "disconnect"};
+    static const char* const kind_names[] = {[SINK_FILE] = "file", [SINK_STDOUT] = "stdout", [SINK_FIFO] = "fifo",
+                                             [SINK_SOCKET] = "socket"};
+
+    *spec = (struct sink_spec) {.name = value, .policy = SINK_DROP, .encoding = ENCODING_RAW};
+    size_t length = strlen(value);
+    bool has_policy = false;
+    bool has_encoding = false;
+    while (true) {
+        // The policy & the encoding may come in either order, each at most once
+        size_t comma = length;
+        while (comma > 0 && value[comma - 1] != ',') {
+            comma--;
+        }
+        if (comma == 0) {
+            break;
+        }
+
+        char token[16];
+        if (length - comma >= sizeof(token)) {
+            return 1;
+        }
+        snprintf(token, sizeof(token), "%.*s", (int) (length - comma), value + comma);
+        bool matched = false;
+        for (size_t i = 0; i < sizeof(policy_names) / sizeof(policy_names[0]) && !has_policy && !matched; i++) {
+            if (strcmp(token, policy_names[i]) == 0) {
+                spec->policy = (enum sink_policy) i;
+                has_policy = matched = true;
+            }
+        }
+        if (!matched && !has_encoding && parse_byte_encoding(token, &spec->encoding) == 0) {
+            has_encoding = matched = true;
+        }
+        if (!matched) {
+            return 1;
+        }
+        length = comma - 1;
+    }
+
+    const char* colon = memchr(value, ':', length);
+    const size_t kind_length = colon != nullptr ? (size_t) (colon - value) : length;
+    for (size_t i = 0; i < sizeof(kind_names) / sizeof(kind_names[0]); i++) {
+        if (strlen(kind_names[i]) == kind_length && strncmp(value, kind_names[i], kind_length) == 0) {
+            spec->kind = (enum sink_kind) i;
+            spec->path = colon != nullptr ? colon + 1 : nullptr;
+            spec->path_length = colon != nullptr ? length - kind_length - 1 : 0;
+
+            // Every kind but stdout needs a path
+            if (spec->kind == SINK_STDOUT) {
+                return colon == nullptr ? 0 : 1;
+            }
+            return spec->path_length > 0 ? 0 : 1;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Checks whether any of the sinks writes to stdout
+ */
+bool has_stdout_sink(const struct sink_spec* specs, const int spec_count) {
+    for (int i = 0; i < spec_count; i++) {
+        if (specs[i].kind == SINK_STDOUT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Keeps stdout for a stdout sink alone: what the program prints from now on (messages, the Bit Array Summary) goes to
+ * stderr instead, so that a tool reading stdout only ever gets the committed bytes
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int reserve_stdout_for_sink() {
+    if (reserved_stdout_file_descriptor >= 0) {
+        return 0;
+    }
+
+    fflush(stdout);
+    reserved_stdout_file_descriptor = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+    if (reserved_stdout_file_descriptor < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        perror("Failed to reserve stdout");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Opens stdout (the one reserved for the sink, if reserve_stdout_for_sink() was called) for a stdout sink, as a file
+ * description of its own where possible. On a terminal, stdout and stderr usually share one description, so making a
+ * dup of stdout non-blocking would make all the other output of the program non-blocking too. A regular file would
+ * lose its offset if reopened through /proc, and a socket cannot be reopened, so those share the description.
+ *
+ * Returns the file descriptor, or -1 if there were errors
+ */
+static int open_stdout_sink(bool* shared_description) {
+    const int stdout_file_descriptor = reserved_stdout_file_descriptor >= 0 ? reserved_stdout_file_descriptor
+                                                                            : STDOUT_FILENO;
+    struct stat file_status;
+    if (fstat(stdout_file_descriptor, &file_status) != 0) {
+        return -1;
+    }
+    *shared_description = S_ISREG(file_status.st_mode) || S_ISSOCK(file_status.st_mode);
+    if (*shared_description) {
+        return fcntl(stdout_file_descriptor, F_DUPFD_CLOEXEC, 0);
+    }
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", stdout_file_descriptor);
+    return open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+/*
+ * Registers a file descriptor with the fan-out thread's epoll instance. Regular files cannot be waited on, but never
+ * make a write wait either, so they are simply left out.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int watch_fanout_file(const struct byte_fanout* fanout, const int file_descriptor, const u_int32_t events,
+                             const u_int64_t tag) {
+    struct epoll_event event = {.events = events, .data.u64 = tag};
+    if (epoll_ctl(fanout->epoll_file_descriptor, EPOLL_CTL_ADD, file_descriptor, &event) < 0 && errno != EPERM) {
+        perror("Failed to register sink with epoll");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Starts writing to a consumer that has just been opened or has just connected, with an empty buffer and, if the sink
+ * has an encoding, at the start of a new encoded stream. A consumer with a file description of its own is made
+ * non-blocking; one that shares its description with the rest of the program is left as it is.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int connect_sink_consumer(struct byte_fanout* fanout, const int sink_index, const int slot,
+                                 const int file_descriptor, const bool shared_description) {
+    struct sink_consumer* consumer = &fanout->sinks[sink_index].consumers[slot];
+    consumer->send_flags = 0;
+    if (shared_description) {
+        // A regular file never makes a write wait, and a socket can be written to without waiting with MSG_DONTWAIT
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) == 0 && S_ISSOCK(file_status.st_mode)) {
+            consumer->send_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+        }
+    } else {
+        const int flags = fcntl(file_descriptor, F_GETFL);
+        if (flags < 0 || fcntl(file_descriptor, F_SETFL, flags | O_NONBLOCK) < 0) {
+            perror("Failed to make sink non-blocking");
+            close(file_descriptor);
+            return 1;
+        }
+    }
+
+    // Edge-triggered, since the fan-out thread always writes until the consumer's buffer is empty or the write would
+    // block
+    const u_int32_t events = EPOLLOUT | EPOLLET | (fanout->sinks[sink_index].spec.kind == SINK_SOCKET
+                                                     ? EPOLLIN | EPOLLRDHUP
+                                                     : 0);
+    if (watch_fanout_file(fanout, file_descriptor, events, (u_int64_t) sink_index << 8 | (u_int64_t) slot) != 0) {
+        close(file_descriptor);
+        return 1;
+    }
+    consumer->file_descriptor = file_descriptor;
+    consumer->buffer_head = 0;
+    consumer->buffer_count = 0;
+    setup_byte_encoder(&consumer->encoder, fanout->sinks[sink_index].spec.encoding);
+    return 0;
+}
+
+/*
+ * Stops writing to a consumer and closes it, discarding the bytes it had not taken. A file or stdout sink is closed for
+ * the rest of the session; a named pipe is opened again for its next reader.
+ */
+static void disconnect_sink_consumer(const struct byte_fanout* fanout, struct fanout_sink* sink,
+                                     struct sink_consumer* consumer) {
+    if (consumer->file_descriptor < 0) {
+        return;
+    }
+
+    epoll_ctl(fanout->epoll_file_descriptor, EPOLL_CTL_DEL, consumer->file_descriptor, nullptr);
+    close(consumer->file_descriptor);
+    consumer->file_descriptor = -1;
+    consumer->buffer_count = 0;
+    sink->closed = sink->closed || sink->spec.kind == SINK_FILE || sink->spec.kind == SINK_STDOUT;
+}
+
+/*
+ * Opens a named pipe for writing if a reader has it open
+ */
+static void open_sink_fifo(struct byte_fanout* fanout, const int sink_index, const char* path) {
+    const int file_descriptor = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (file_descriptor >= 0) {
+        connect_sink_consumer(fanout, sink_index, 0, file_descriptor, false);
+    } else if (errno != ENXIO) {    // ENXIO: no reader yet
+        perror("Failed to open sink named pipe");
+    }
+}
+
+/*
+ * Creates the listening socket of a socket sink. A stale socket file left by a previous session is replaced.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int listen_on_sink_socket(struct byte_fanout* fanout, const int sink_index, const char* path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Sink socket path is too long: %s\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    struct fanout_sink* sink = &fanout->sinks[sink_index];
+    sink->listen_file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sink->listen_file_descriptor < 0) {
+        perror("Failed to create sink socket");
+        return 1;
+    }
+
+    unlink(path);
+    if (bind(sink->listen_file_descriptor, (const struct sockaddr*) &address, sizeof(address)) < 0 ||
+        listen(sink->listen_file_descriptor, MAX_SINK_SUBSCRIBERS) < 0) {
+        perror("Failed to listen on sink socket");
+        return 1;
+    }
+    return watch_fanout_file(fanout, sink->listen_file_descriptor, EPOLLIN,
+                             (u_int64_t) sink_index << 8 | FANOUT_LISTENER_SLOT);
+}
+
+/*
+ * Opens a sink: creates or truncates its file, takes over the reserved stdout, creates its named pipe (opening it if
+ * a reader is already waiting) or listens on its socket, then allocates a buffer for each of its consumers
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int open_fanout_sink(struct byte_fanout* fanout, const int sink_index) {
+    struct fanout_sink* sink = &fanout->sinks[sink_index];
+    for (int i = 0; i < sink->consumer_slots; i++) {
+        struct sink_consumer* consumer = &sink->consumers[i];
+        consumer->buffer = malloc(fanout->buffer_size);
+        if (consumer->buffer == nullptr) {
+            perror("Failed to allocate sink buffer");
+            return 1;
+        }
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%.*s", (int) sink->spec.path_length,
+             sink->spec.path != nullptr ? sink->spec.path : "");
+
+    int file_descriptor;
+    switch (sink->spec.kind) {
+        case SINK_FILE:
+            file_descriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (file_descriptor < 0) {
+                perror("Failed to open sink file");
+                return 1;
+            }
+            return connect_sink_consumer(fanout, sink_index, 0, file_descriptor, false);
+        case SINK_STDOUT: {
+            bool shared_description;
+            file_descriptor = open_stdout_sink(&shared_description);
+            if (file_descriptor < 0) {
+                perror("Failed to open stdout sink");
+                return 1;
+            }
+            return connect_sink_consumer(fanout, sink_index, 0, file_descriptor, shared_description);
+        }
+        case SINK_FIFO: {
+            struct stat file_status;
+            if (mkfifo(path, 0644) != 0 && (errno != EEXIST || stat(path, &file_status) != 0 ||
+                                            !S_ISFIFO(file_status.st_mode))) {
+                fprintf(stderr, "Failed to create sink named pipe: %s\n", path);
+                return 1;
+            }
+            open_sink_fifo(fanout, sink_index, path);
+            return 0;
+        }
+        case SINK_SOCKET:
+            return listen_on_sink_socket(fanout, sink_index, path);
+    }
+    return 1;
+}
+
+/*
+ * Writes to a consumer without blocking, retrying if interrupted. A consumer that has gone away is disconnected.
+ *
+ * Returns the number of bytes written, 0 if the consumer cannot take any more yet, or -1 if it was disconnected
+ */
+static ssize_t write_without_blocking(const struct byte_fanout* fanout, struct fanout_sink* sink,
+                                      struct sink_consumer* consumer, const struct iovec* buffers,
+                                      const int buffer_count) {
+    while (true) {
+        const ssize_t written = consumer->send_flags != 0
+                                ? sendmsg(consumer->file_descriptor, &(struct msghdr) {
+                                    .msg_iov = (struct iovec*) buffers, .msg_iovlen = (size_t) buffer_count
+                                }, consumer->send_flags)
+                                : writev(consumer->file_descriptor, buffers, buffer_count);
+        if (written >= 0) {
+            sink->bytes_delivered += (u_int64_t) written;
+            return written;
+        }
+        if (errno == EAGAIN) {
+            return 0;   // The rest is written once epoll reports the consumer as writable again
+        }
+        if (errno != EINTR) {   // EPIPE: the reader or subscriber has gone away
+            disconnect_sink_consumer(fanout, sink, consumer);
+            return -1;
+        }
+    }
+}
+
+/*
+ * Writes as much of a consumer's buffer as it takes, with a single writev() call per attempt (two buffers when the
+ * ring has wrapped)
+ */
+static void write_to_sink_consumer(const struct byte_fanout* fanout, struct fanout_sink* sink,
+                                   struct sink_consumer* consumer) {
+    while (consumer->file_descriptor >= 0 && consumer->buffer_count > 0) {
+        const size_t first_length = consumer->buffer_head + consumer->buffer_count <= fanout->buffer_size
+                                        ? consumer->buffer_count
+                                        : fanout->buffer_size - consumer->buffer_head;
+        const struct iovec buffers[2] = {
+            {.iov_base = consumer->buffer + consumer->buffer_head, .iov_len = first_length},
+            {.iov_base = consumer->buffer, .iov_len = consumer->buffer_count - first_length}
+        };
+
+        const ssize_t written = write_without_blocking(fanout, sink, consumer, buffers, buffers[1].iov_len > 0 ? 2 : 1);
+        if (written <= 0) {
+            return;
+        }
+        consumer->buffer_head = (consumer->buffer_head + (size_t) written) % fanout->buffer_size;
+        consumer->buffer_count -= (size_t) written;
+    }
+    if (consumer->buffer_count == 0) {
+        consumer->buffer_head = 0;
+    }
+}
+
+/*
+ * Delivers bytes to a consumer. A consumer that has taken everything so far is written to straight from the bytes, so
+ * only what it does not take yet is added to its buffer. If that does not all fit, the sink's policy decides: the bytes
+ * that do not fit are dropped, or the consumer is disconnected (for the rest of the session, unless it is a socket's
+ * subscriber). With SINK_BLOCK they always fit, since the fan-out thread only takes as many bytes from the queue as
+ * every blocking consumer has room for.
+ */
+static void deliver_to_sink_consumer(const struct byte_fanout* fanout, struct fanout_sink* sink,
+                                     struct sink_consumer* consumer, const u_int8_t* bytes, size_t count) {
+    while (consumer->buffer_count == 0 && count > 0) {
+        const struct iovec buffer = {.iov_base = (void*) bytes, .iov_len = count};
+        const ssize_t written = write_without_blocking(fanout, sink, consumer, &buffer, 1);
+        if (written < 0) {
+            return;
+        }
+        if (written == 0) {
+            break;
+        }
+        bytes += written;
+        count -= (size_t) written;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    const size_t free_space = fanout->buffer_size - consumer->buffer_count;
+    if (count > free_space) {
+        if (sink->spec.policy == SINK_DISCONNECT) {
+            sink->disconnects++;
+            sink->closed = sink->spec.kind != SINK_SOCKET;
+            disconnect_sink_consumer(fanout, sink, consumer);
+            return;
+        }
+        sink->bytes_dropped += count - free_space;
+        count = free_space;
+    }
+
+    const size_t tail = (consumer->buffer_head + consumer->buffer_count) % fanout->buffer_size;
+    const size_t first_length = count <= fanout->buffer_size - tail ? count : fanout->buffer_size - tail;
+    memcpy(consumer->buffer + tail, bytes, first_length);
+    memcpy(consumer->buffer, bytes + first_length, count - first_length);
+    consumer->buffer_count += count;
+}
+
+/*
+ * Returns the number of bytes a consumer of a blocking sink has room for, leaving room to finish its encoding
+ */
+static size_t get_sink_consumer_room(const struct byte_fanout* fanout, const struct fanout_sink* sink,
+                                     const struct sink_consumer* consumer) {
+    const size_t free_space = fanout->buffer_size - consumer->buffer_count;
+    if (sink->spec.encoding == ENCODING_RAW) {
+        return free_space;
+    }
+    return free_space > ENCODER_TAIL_SIZE ? get_encodable_count(sink->spec.encoding, free_space - ENCODER_TAIL_SIZE)
+                                          : 0;
+}
+
+/*
+ * Delivers a batch of bytes to every connected consumer of a sink, encoding it for each of them if the sink has an
+ * encoding
+ */
+static void deliver_to_sink(const struct byte_fanout* fanout, struct fanout_sink* sink, const u_int8_t* batch,
+                            const size_t count) {
+    char encoded[FANOUT_ENCODED_BATCH_SIZE];
+    for (int i = 0; i < sink->consumer_slots; i++) {
+        struct sink_consumer* consumer = &sink->consumers[i];
+        if (consumer->file_descriptor < 0) {
+            continue;
+        }
+        if (sink->spec.encoding == ENCODING_RAW) {
+            deliver_to_sink_consumer(fanout, sink, consumer, batch, count);
+        } else {
+            const size_t length = encode_bytes(&consumer->encoder, batch, count, encoded);
+            deliver_to_sink_consumer(fanout, sink, consumer, (const u_int8_t*) encoded, length);
+        }
+    }
+}
+
+/*
+ * Moves the queued bytes to every connected consumer, a batch at a time, for as long as every consumer of a blocking
+ * sink has room for them
+ */
+static void deliver_queued_bytes(struct byte_fanout* fanout) {
+    u_int8_t batch[FANOUT_BATCH_SIZE];
+    while (true) {
+        size_t room = sizeof(batch);
+        for (int i = 0; i < fanout->sink_count; i++) {
+            const struct fanout_sink* sink = &fanout->sinks[i];
+            for (int j = 0; j < sink->consumer_slots && sink->spec.policy == SINK_BLOCK; j++) {
+                const struct sink_consumer* consumer = &sink->consumers[j];
+                if (consumer->file_descriptor >= 0 && get_sink_consumer_room(fanout, sink, consumer) < room) {
+                    room = get_sink_consumer_room(fanout, sink, consumer);
+                }
+            }
+        }
+
+        size_t count = 0;
+        while (count < room && pop_from_spsc_queue(&fanout->queue, &batch[count])) {
+            count++;
+        }
+        if (count == 0) {
+            return;
+        }
+
+        for (int i = 0; i < fanout->sink_count; i++) {
+            deliver_to_sink(fanout, &fanout->sinks[i], batch, count);
+        }
+    }
+}
+
+/*
+ * Delivers what ends the encoded stream of every connected consumer of a sink with an encoding
+ */
+static void finish_sink_encoders(struct byte_fanout* fanout) {
+    for (int i = 0; i < fanout->sink_count; i++) {
+        struct fanout_sink* sink = &fanout->sinks[i];
+        for (int j = 0; j < sink->consumer_slots && sink->spec.encoding != ENCODING_RAW; j++) {
+            struct sink_consumer* consumer = &sink->consumers[j];
+            if (consumer->file_descriptor >= 0) {
+                char tail[ENCODER_TAIL_SIZE];
+                const size_t length = finish_byte_encoder(&consumer->encoder, tail);
+                deliver_to_sink_consumer(fanout, sink, consumer, (const u_int8_t*) tail, length);
+            }
+        }
+    }
+}
+
+/*
+ * Accepts every pending subscriber of a socket sink. Subscribers only receive the bytes committed after they connect.
+ */
+static void accept_sink_subscribers(struct byte_fanout* fanout, const int sink_index) {
+    const struct fanout_sink* sink = &fanout->sinks[sink_index];
+    int subscriber_file_descriptor;
+    while ((subscriber_file_descriptor = accept(sink->listen_file_descriptor, nullptr, nullptr)) >= 0) {
+        fcntl(subscriber_file_descriptor, F_SETFD, FD_CLOEXEC);
+
+        int slot = -1;
+        for (int i = 0; i < sink->consumer_slots && slot < 0; i++) {
+            if (sink->consumers[i].file_descriptor < 0) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            close(subscriber_file_descriptor);  // Too many subscribers at once
+            continue;
+        }
+        connect_sink_consumer(fanout, sink_index, slot, subscriber_file_descriptor, false);
+    }
+}
+
+/*
+ * Handles an event reported by epoll for the listening socket of a sink or one of its consumers
+ */
+static void handle_fanout_event(struct byte_fanout* fanout, const struct epoll_event* event) {
+    struct fanout_sink* sink = &fanout->sinks[event->data.u64 >> 8];
+    const int slot = (int) (event->data.u64 & 0xFF);
+    if (slot == FANOUT_LISTENER_SLOT) {
+        accept_sink_subscribers(fanout, (int) (event->data.u64 >> 8));
+        return;
+    }
+
+    struct sink_consumer* consumer = &sink->consumers[slot];
+    if (consumer->file_descriptor < 0) {
+        return;
+    }
+    if (event->events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        disconnect_sink_consumer(fanout, sink, consumer);
+        return;
+    }
+    if (event->events & EPOLLIN) {
+        // Subscribers have nothing to send, so anything they do send is discarded
+        u_int8_t discarded[256];
+        while (read(consumer->file_descriptor, discarded, sizeof(discarded)) > 0) {
+        }
+    }
+    if (event->events & EPOLLOUT) {
+        write_to_sink_consumer(fanout, sink, consumer);
+    }
+}
+
+/*
+ * Checks whether any consumer has bytes it has not taken yet
+ */
+static bool has_undelivered_bytes(const struct byte_fanout* fanout) {
+    for (int i = 0; i < fanout->sink_count; i++) {
+        for (int j = 0; j < fanout->sinks[i].consumer_slots; j++) {
+            if (fanout->sinks[i].consumers[j].file_descriptor >= 0 &&
+                fanout->sinks[i].consumers[j].buffer_count > 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Opens the named pipes that have no reader, in case one has arrived
+ *
+ * Returns true if a named pipe still has no reader
+ */
+static bool open_waiting_fifos(struct byte_fanout* fanout) {
+    bool waiting = false;
+    for (int i = 0; i < fanout->sink_count; i++) {
+        const struct fanout_sink* sink = &fanout->sinks[i];
+        if (sink->spec.kind == SINK_FIFO && !sink->closed && sink->consumers[0].file_descriptor < 0) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%.*s", (int) sink->spec.path_length, sink->spec.path);
+            open_sink_fifo(fanout, i, path);
+            waiting = waiting || sink->consumers[0].file_descriptor < 0;
+        }
+    }
+    return waiting;
+}
+
+/*
+ * Fan-out Thread: sleeps in epoll_wait() until it is woken for a batch of bytes, a consumer can take more, or a
+ * subscriber connects, then delivers what it can without blocking. Once the session has ended, it finishes the encoded
+ * streams and keeps delivering the buffered bytes for up to FANOUT_LINGER_MS.
+ */
+static void* run_fanout_thread(void* argument) {
+    struct byte_fanout* fanout = argument;
+    struct epoll_event ready_events[FANOUT_MAX_EVENTS];
+    struct timespec linger_start_time;
+    bool lingering = false;
+    bool encoders_finished = false;
+
+    while (true) {
+        // Reads producer_finished first, so that no byte pushed before it was set can be missed
+        const bool producer_finished = atomic_load(&fanout->producer_finished);
+        const bool fifo_waiting = open_waiting_fifos(fanout);
+        deliver_queued_bytes(fanout);
+
+        int timeout_ms = fifo_waiting ? FANOUT_REOPEN_INTERVAL_MS : -1;
+        if (producer_finished && is_spsc_queue_empty(&fanout->queue)) {
+            if (!encoders_finished) {
+                finish_sink_encoders(fanout);
+                encoders_finished = true;
+            }
+            if (!has_undelivered_bytes(fanout)) {
+                break;
+            }
+            if (!lingering) {
+                clock_gettime(CLOCK_MONOTONIC, &linger_start_time);
+                lingering = true;
+            }
+            const long long remaining_ms = FANOUT_LINGER_MS - milliseconds_since(&linger_start_time);
+            if (remaining_ms <= 0) {
+                break;
+            }
+            timeout_ms = (int) remaining_ms;
+        }
+
+        const int ready_count = epoll_wait(fanout->epoll_file_descriptor, ready_events, FANOUT_MAX_EVENTS, timeout_ms);
+        for (int i = 0; i < ready_count; i++) {
+            if (ready_events[i].data.u64 == FANOUT_WAKE_TAG) {
+                eventfd_t wake_count;
+                eventfd_read(fanout->wake_file_descriptor, &wake_count);
+            } else {
+                handle_fanout_event(fanout, &ready_events[i]);
+            }
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Opens every sink and starts the fan-out thread. Each consumer gets a buffer of buffer_size bytes.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_byte_fanout(struct byte_fanout* fanout, const struct sink_spec* specs, const int spec_count,
+                      const size_t buffer_size) {
+    fanout->sink_count = 0;
+    fanout->buffer_size = buffer_size > 0 ? buffer_size : DEFAULT_SINK_BUFFER_SIZE;
+    fanout->wake_pending = false;
+    fanout->wake_file_descriptor = -1;
+    fanout->started = false;
+    fanout->queue.slots = nullptr;
+    atomic_init(&fanout->producer_finished, false);
+    fanout->epoll_file_descriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (fanout->epoll_file_descriptor < 0) {
+        perror("Failed to create fan-out epoll instance");
+        return 1;
+    }
+
+    fanout->wake_file_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fanout->wake_file_descriptor < 0) {
+        perror("Failed to create fan-out eventfd");
+        return 1;
+    }
+    if (watch_fanout_file(fanout, fanout->wake_file_descriptor, EPOLLIN, FANOUT_WAKE_TAG) != 0 ||
+        setup_spsc_queue(&fanout->queue, FANOUT_QUEUE_SIZE, sizeof(u_int8_t)) != 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < spec_count; i++) {
+        if (specs[i].encoding != ENCODING_RAW && fanout->buffer_size < MIN_ENCODED_SINK_BUFFER_SIZE) {
+            fprintf(stderr, "Sink buffer must be at least %d bytes for a sink with an encoding: %s\n",
+                    MIN_ENCODED_SINK_BUFFER_SIZE, specs[i].name);
+            return 1;
+        }
+        struct fanout_sink* sink = &fanout->sinks[fanout->sink_count++];
+        *sink = (struct fanout_sink) {
+            .spec = specs[i], .listen_file_descriptor = -1,
+            .consumer_slots = specs[i].kind == SINK_SOCKET ? MAX_SINK_SUBSCRIBERS : 1
+        };
+        for (int j = 0; j < MAX_SINK_SUBSCRIBERS; j++) {
+            sink->consumers[j].file_descriptor = -1;
+        }
+        if (open_fanout_sink(fanout, i) != 0) {
+            return 1;
+        }
+    }
+
+    // A consumer that goes away makes write() fail with EPIPE on the fan-out thread instead of ending the process
+    sigset_t pipe_signal;
+    sigset_t previous_signals;
+    sigemptyset(&pipe_signal);
+    sigaddset(&pipe_signal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_signal, &previous_signals);
+    const int error = pthread_create(&fanout->thread, nullptr, run_fanout_thread, fanout);
+    pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+    if (error != 0) {
+        errno = error;
+        perror("Failed to start fan-out thread");
+        return 1;
+    }
+    fanout->started = true;
+    return 0;
+}
+
+/*
+ * Queues a committed byte for the sinks. Called by the thread writing the output, which wakes the fan-out thread with
+ * wake_byte_fanout() once the batch is complete. The queue is only ever full while a blocking sink holds up the
+ * fan-out thread, in which case the writing thread waits for room; each wait counts as one stall.
+ */
+void push_byte_to_fanout(struct byte_fanout* fanout, const u_int8_t byte) {
+    if (!push_to_spsc_queue(&fanout->queue, &byte)) {
+        fanout->queue.stalls++;
+        const struct timespec backoff = {.tv_sec = 0, .tv_nsec = FANOUT_BACKOFF_NS};
+        do {
+            eventfd_write(fanout->wake_file_descriptor, 1);
+            nanosleep(&backoff, nullptr);
+        } while (!push_to_spsc_queue(&fanout->queue, &byte));
+    }
+    fanout->wake_pending = true;
+}
+
+/*
+ * Wakes the fan-out thread if bytes were queued since it was last woken
+ */
+void wake_byte_fanout(struct byte_fanout* fanout) {
+    if (fanout->started && fanout->wake_pending) {
+        eventfd_write(fanout->wake_file_descriptor, 1);
+        fanout->wake_pending = false;
+    }
+}
+
+/*
+ * Prints the counters of every sink
+ */
+void print_fanout_counters(const struct byte_fanout* fanout) {
+    if (fanout->sink_count == 0) {
+        return;
+    }
+
+    printf("%-32s %10s %10s %12s\n", "Sink", "Delivered", "Dropped", "Disconnects");
+    for (int i = 0; i < fanout->sink_count; i++) {
+        const struct fanout_sink* sink = &fanout->sinks[i];
+        printf("%-32s %10llu %10llu %12llu\n", sink->spec.name, (unsigned long long) sink->bytes_delivered,
+               (unsigned long long) sink->bytes_dropped, (unsigned long long) sink->disconnects);
+    }
+    if (fanout->queue.stalls > 0) {
+        printf("Fan-out queue stalls: %llu\n", (unsigned long long) fanout->queue.stalls);
+    }
+}
+
+/*
+ * Waits for the fan-out thread to deliver the queued bytes (or give up on them after FANOUT_LINGER_MS), then closes
+ * every sink and removes the sockets' files. Named pipes are left in place for the next session.
+ */
+void end_byte_fanout(struct byte_fanout* fanout) {
+    if (fanout->epoll_file_descriptor < 0) {
+        return;
+    }
+
+    if (fanout->started) {
+        atomic_store(&fanout->producer_finished, true);
+        eventfd_write(fanout->wake_file_descriptor, 1);
+        pthread_join(fanout->thread, nullptr);
+        fanout->started = false;
+    }
+
+    for (int i = 0; i < fanout->sink_count; i++) {
+        struct fanout_sink* sink = &fanout->sinks[i];
+        for (int j = 0; j < sink->consumer_slots; j++) {
+            disconnect_sink_consumer(fanout, sink, &sink->consumers[j]);
+            free(sink->consumers[j].buffer);
+            sink->consumers[j].buffer = nullptr;
+        }
+        if (sink->listen_file_descriptor >= 0) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%.*s", (int) sink->spec.path_length, sink->spec.path);
+            close(sink->listen_file_descriptor);
+            sink->listen_file_descriptor = -1;
+            unlink(path);
+        }
+    }
+
+    end_spsc_queue(&fanout->queue);
+    if (fanout->wake_file_descriptor >= 0) {
+        close(fanout->wake_file_descriptor);
+        fanout->wake_file_descriptor = -1;
+    }
+    close(fanout->epoll_file_descriptor);
+    fanout->epoll_file_descriptor = -1;
+}
@@ -0,0 +1,129 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Fanout.h is the header file for defining the Fan-out, which delivers every committed byte to extra
+    destinations besides the output file (a file, stdout, a named pipe, or the subscribers of a Unix socket), each with
+    a bounded buffer and a policy for when its consumer falls behind.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_FANOUT_H
+#define STENOBYTE_FANOUT_H
+
+#include "StenoByte_Encoder.h"
+#include "StenoByte_Queue.h"
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Number of times --sink may be given
+#define MAX_FANOUT_SINKS 8
+
+// Number of subscribers a socket sink serves at once; more connections are closed straight away
+#define MAX_SINK_SUBSCRIBERS 8
+
+// Default number of bytes each consumer may fall behind by before its sink's policy applies
+#define DEFAULT_SINK_BUFFER_SIZE 65536
+
+// Smallest --sink-buffer that a sink with an encoding can be given, so that a blocking one always has room for what a
+// byte encodes to
+#define MIN_ENCODED_SINK_BUFFER_SIZE 1024
+
+// Number of bytes the queue from the writing thread to the fan-out thread holds (a power of 2)
+#define FANOUT_QUEUE_SIZE 65536
+
+// How often a named pipe without a reader is opened again
+#define FANOUT_REOPEN_INTERVAL_MS 100
+
+// Longest time the fan-out thread keeps delivering buffered bytes once the session has ended
+#define FANOUT_LINGER_MS 1000
+
+enum sink_kind {
+    SINK_FILE = 0,  // file:PATH, created or truncated
+    SINK_STDOUT,    // stdout
+    SINK_FIFO,      // fifo:PATH, a named pipe (created if needed) that readers may open and close at any time
+    SINK_SOCKET     // socket:PATH, a Unix stream socket that every connected subscriber is sent the bytes on
+};
+
+// What happens to a consumer whose buffer has no room for the next bytes
+enum sink_policy {
+    SINK_DROP = 0,      // The bytes that do not fit are dropped for that consumer
+    SINK_BLOCK,         // Delivery to every sink waits for room; capture waits too once the fan-out queue is full
+    SINK_DISCONNECT     // The consumer is disconnected
+};
+
+// A sink as given with --sink=KIND[:PATH][,POLICY][,ENCODING]
+struct sink_spec {
+    const char* name;   // The option's value, for reporting
+    enum sink_kind kind;
+    enum sink_policy policy;
+    enum byte_encoding encoding;
+    const char* path;   // Points into name; path_length chars long
+    size_t path_length;
+};
+
+// A consumer of a sink: the file or pipe the sink writes to, or one subscriber of a socket sink
+struct sink_consumer {
+    int file_descriptor;    // -1 when not connected
+    int send_flags;         // MSG_DONTWAIT for a socket given as stdout, which is written with sendmsg() because its
+                            // file description is shared and so is never made non-blocking; 0 otherwise
+    u_int8_t* buffer;       // Ring of the bytes the consumer has not taken yet (encoded, if the sink has an encoding)
+    size_t buffer_head;
+    size_t buffer_count;
+    struct byte_encoder encoder;    // Started afresh whenever the consumer connects
+};
+
+struct fanout_sink {
+    struct sink_spec spec;
+    int listen_file_descriptor; // SINK_SOCKET: the listening socket, -1 otherwise
+    bool closed;    // Whether the sink was closed for the rest of the session; a socket sink never is
+    struct sink_consumer consumers[MAX_SINK_SUBSCRIBERS];   // Only SINK_SOCKET uses more than the first
+    int consumer_slots;
+
+    // Written by the fan-out thread, read once it has finished
+    u_int64_t bytes_delivered;  // Counter of bytes taken by the consumers
+    u_int64_t bytes_dropped;    // Counter of bytes dropped for consumers that were behind
+    u_int64_t disconnects;      // Counter of consumers disconnected for being behind
+};
+
+struct byte_fanout {
+    struct fanout_sink sinks[MAX_FANOUT_SINKS];
+    int sink_count;
+    size_t buffer_size;
+
+    struct spsc_queue queue;    // Writing thread -> Fan-out thread
+    bool wake_pending;  // Whether bytes were pushed since the fan-out thread was last woken (writing thread only)
+
+    int epoll_file_descriptor;  // -1 when no Fan-out is set up
+    int wake_file_descriptor;
+    pthread_t thread;
+    bool started;
+    atomic_bool producer_finished;  // Set once no more bytes will be pushed
+};
+
+// Methods & Functions
+int parse_sink_spec(struct sink_spec* spec, const char* value);
+bool has_stdout_sink(const struct sink_spec* specs, int spec_count);
+int reserve_stdout_for_sink();
+int setup_byte_fanout(struct byte_fanout* fanout, const struct sink_spec* specs, int spec_count, size_t buffer_size);
+void push_byte_to_fanout(struct byte_fanout* fanout, u_int8_t byte);
+void wake_byte_fanout(struct byte_fanout* fanout);
+void print_fanout_counters(const struct byte_fanout* fanout);
+void end_byte_fanout(struct byte_fanout* fanout);
+
+#endif //STENOBYTE_FANOUT_H
@@ -26,7 +26,17 @@
 
 #include <linux/input.h>
 #include <libevdev/libevdev.h>
+#include "StenoByte_Chord.h"
+#include "StenoByte_Devices.h"
+#include "StenoByte_Input.h"
+#include "StenoByte_Keymap.h"
+#include "StenoByte_Metrics.h"
+#include "StenoByte_Options.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <termios.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -39,29 +49,55 @@
 #define EV_KEY_PRESSED 1
 #define EV_KEY_REPEATED 2
 
-// Externally Declared Structs and Variables (expected to be declared and implemented in dependencies)
-extern struct libevdev *keyboard_device; // Struct to store the evdev device
-extern struct termios original_terminal_settings;    // Termios Struct to store original terminal settings
-extern const int event_file_device;
+// Outcome of reading the pending events of an Input Source
+enum drain_result {
+    DRAIN_CONTINUE = 0,
+    DRAIN_EXIT,
+    DRAIN_SOURCE_ENDED
+};
+
+// Maximum number of ready file descriptors handled per wake-up of the event loop
+#define MAX_EPOLL_EVENTS 8
+
+// Number of replayed events handled between checks for timed actions and stop requests
+#define REPLAY_BATCH_EVENTS 4096
+
+struct stenobyte_session;
 
 
 // Externally Declared Methods & Functions
 // (expected to be declared & defined in dependent libraries or in StenoByte_Core files)
-extern void setup_subvalues_array();    // StenoByte_Core.h/c
-extern void compute_byte();
-extern void print_bit_arr_summary();
-extern void update_bit_arr(int key_code, bool new_state);
+extern int setup_stenobyte_keymap(const char* keymap_file_path);  // StenoByte_Core.h/c
+extern void compute_byte(struct chord_state* chord);
+extern void write_byte_to_sink(struct stenobyte_session* session);
+extern void write_stroke_to_sink(struct stenobyte_session* session, const struct byte_sink* sink, u_int64_t time_us);
+extern void flush_stenobyte_strokes(struct stenobyte_session* session, const struct byte_sink* sink);
+extern int setup_stenobyte_session(struct stenobyte_session* session, enum stenobyte_mode mode,
+                                   const struct stenobyte_options* options);
+extern int get_stenobyte_timeout_ms(const struct stenobyte_session* session);
+extern void process_stenobyte_timeouts(struct stenobyte_session* session);
 
 
 // Methods & Functions
-int setup_stenobyte();
-void update_bit_arr(int key_code, bool new_state);
-void run_stenobyte();
-void end_stenobyte();
-void process_key_presses(const struct input_event* current_event);
+int setup_stenobyte(struct stenobyte_session* session);
+int setup_stenobyte_cli_session(struct stenobyte_session* session, enum stenobyte_mode mode,
+                                const struct stenobyte_options* options);
+int set_stenobyte_event_source(struct stenobyte_session* session, int file_descriptor,
+                               input_event_callback next_event, void* context);
+void update_bit_arr(struct chord_state* chord, int key_code, bool new_state);
+enum chord_stroke_result update_chord_stroke(struct chord_state* chord, int key_code, bool pressed,
+                                             u_int64_t time_us);
+bool process_stenobyte_events(struct stenobyte_session* session, int timeout_ms);
+void run_stenobyte(struct stenobyte_session* session);
+void stop_stenobyte(struct stenobyte_session* session);
+void end_stenobyte(struct stenobyte_session* session);
+int setup_event_loop(struct stenobyte_session* session);
+void count_committed_chord(struct stenobyte_session* session, const struct input_event* commit_event);
+bool handle_key_event(struct stenobyte_session* session, const struct input_event* current_event);
+bool process_key_presses(struct stenobyte_session* session, const struct input_event* current_event);
 bool is_valid_key(int key_code);
 void print_event_summary(const struct input_event* current_event);
-void disable_echo();
-void restore_terminal();
+void disable_echo(struct stenobyte_session* session);
+void restore_terminal(struct stenobyte_session* session);
 
 #endif //STENOBYTE_HELPER_H
@@ -23,153 +23,565 @@
 #include "StenoByte_Helper.h"
 #include "StenoByte_Core.h"
 
-// Struct to store the evdev device
-struct libevdev *keyboard_device = nullptr;
-struct termios original_terminal_settings;    // Termios Struct to store original terminal settings
-const int event_file_device;
+// The session that SIGINT & SIGTERM stop, set by setup_stenobyte_cli_session()
+static struct stenobyte_session* signal_session = nullptr;
 
+/*
+ * Signal handler for SIGINT & SIGTERM so that the app exits through the normal clean-up path
+ */
+static void handle_stop_signal(const int signal_number) {
+    (void) signal_number;
+    if (signal_session != nullptr) {
+        stop_stenobyte(signal_session);
+    }
+}
 
 /*
- * Sets up the application and configures the devices to read from
+ * Sets up the application and configures the devices to read from, according to the session's options
  *
  * Returns 0 if there were no errors, 1 if there were errors
  */
-int setup_stenobyte() {
-    setup_subvalues_array();
+int setup_stenobyte(struct stenobyte_session* session) {
+    const struct stenobyte_options* options = &session->options;
 
-    const int event_file_device = open("/dev/input/event3", O_RDONLY | O_NONBLOCK); // Change to the correct device
+    // Sets up the epoll instance that the event loop blocks on
+    if (setup_event_loop(session) != 0) {
+        return 1;
+    }
+    session->keyboards.epoll_file_descriptor = session->epoll_file_descriptor;
 
-    // Opens the keyboard event file (usually event3) in Read-Only and Non-Blocking Modes
-    // Reports an error if something went wrong
+    if (options->replay_file_path != nullptr) {
+        // Replays a capture file instead of reading a keyboard, so no device or elevated privileges are needed
+        if (setup_replay_input_source(&session->event_source, options->replay_file_path) != 0) {
+            return 1;
+        }
+        session->using_event_source = true;
+        printf("Replaying capture file: %s\n", options->replay_file_path);
+    } else {
+        // Attaches the keyboard given with --device, or every keyboard that has the keys of the Keymap, then watches
+        // for keyboards being plugged in
+        if (discover_keyboards(&session->keyboards) == 0) {
+            printf("No keyboard found yet; waiting for one to be plugged in...\n");
+        }
+        if (setup_hotplug(&session->keyboards) != 0) {
+            printf("Keyboards plugged in later will not be detected\n");
+        }
+    }
 
-    if (event_file_device < 0) {
-        perror("Failed to open device");
+    // Serves the Metrics if requested
+    setup_metrics(&session->metrics);
+    if (options->metrics_socket_path != nullptr &&
+        setup_metrics_server(&session->metrics_server, session, options->metrics_socket_path,
+                             session->epoll_file_descriptor) != 0) {
         return 1;
     }
 
-    // Disables printing inputs to the terminal
-    disable_echo();
+    // Records the key events of the session if requested
+    if (options->record_file_path != nullptr &&
+        start_capture_recording(&session->capture_recorder, options->record_file_path) != 0) {
+        return 1;
+    }
+    return 0;
+}
 
-    // Initialises the evdev device (stored in libevdev struct named "keyboard_device")
-    // Reports an error if evdev initialisation failed
-    if (libevdev_new_from_fd(event_file_device, &keyboard_device) < 0) {
-        perror("Failed to init libevdev");
+/*
+ * Sets up a session for one of the command line apps, which also owns the Keymap, the terminal and the process's
+ * signals: --keymap replaces the default layout, SIGINT & SIGTERM stop the session, and typed keys are not echoed while
+ * keyboards are read.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_stenobyte_cli_session(struct stenobyte_session* session, const enum stenobyte_mode mode,
+                                const struct stenobyte_options* options) {
+    // The only session of the app loads the Keymap for the whole process
+    struct stenobyte_options session_options = *options;
+    session_options.keymap_file_path = nullptr;
+    if (setup_stenobyte_keymap(options->keymap_file_path) != 0 ||
+        setup_stenobyte_session(session, mode, &session_options) != 0) {
         return 1;
     }
 
-    // Prints evdev device name
-    printf("Input device name: %s\n", libevdev_get_name(keyboard_device));
+    // Ctrl+C or a kill request wakes the loop rather than terminating without restoring the terminal
+    signal_session = session;
+    struct sigaction stop_action = {.sa_handler = handle_stop_signal};
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT, &stop_action, nullptr);
+    sigaction(SIGTERM, &stop_action, nullptr);
+
+    // Disables printing inputs to the terminal
+    if (!session->using_event_source) {
+        disable_echo(session);
+    }
     printf("Press ESC to exit\n");
     return 0;
 }
 
+/*
+ * Reads the key events of a session from a callback instead of its keyboards or capture file. If file_descriptor is
+ * not -1, the event loop waits on it and calls next_event until it returns -EAGAIN; otherwise next_event is called
+ * continuously, as for a capture file, until it returns INPUT_END_OF_STREAM. Must be called before run_stenobyte().
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int set_stenobyte_event_source(struct stenobyte_session* session, const int file_descriptor,
+                               const input_event_callback next_event, void* context) {
+    end_keyboards(&session->keyboards);
+    end_input_source(&session->event_source);
+    if (setup_callback_input_source(&session->event_source, file_descriptor, next_event, context) != 0) {
+        return 1;
+    }
+    session->using_event_source = true;
+
+    if (file_descriptor >= 0) {
+        struct epoll_event source_event = {.events = EPOLLIN, .data.fd = file_descriptor};
+        if (epoll_ctl(session->epoll_file_descriptor, EPOLL_CTL_ADD, file_descriptor, &source_event) < 0) {
+            perror("Failed to register event source with epoll");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Creates the epoll instance and registers the wake-up eventfd with it. Keyboards are registered as they are attached
+ * and stay in Non-Blocking Mode so that they can be drained until EAGAIN after each wake-up, while the event loop
+ * itself blocks in epoll_wait() and uses no CPU time while idle.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_event_loop(struct stenobyte_session* session) {
+    session->epoll_file_descriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (session->epoll_file_descriptor < 0) {
+        perror("Failed to create epoll instance");
+        return 1;
+    }
+
+    session->wake_file_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (session->wake_file_descriptor < 0) {
+        perror("Failed to create wake-up eventfd");
+        return 1;
+    }
+
+    struct epoll_event wake_event = {.events = EPOLLIN, .data.fd = session->wake_file_descriptor};
+    if (epoll_ctl(session->epoll_file_descriptor, EPOLL_CTL_ADD, session->wake_file_descriptor, &wake_event) < 0) {
+        perror("Failed to register wake-up eventfd with epoll");
+        return 1;
+    }
+    return 0;
+}
+
 /*
  * Updates the current bits in the array and whether the array is ready to be computed into a byte (which is when
- * the space bar is pressed)
- */
-void update_bit_arr(const int key_code, const bool new_state) {
-    switch (key_code) {
-        case KEY_A:
-            bit_arr[7] = new_state;
-            return;
-        case KEY_S:
-            bit_arr[6] = new_state;
-            return;
-        case KEY_D:
-            bit_arr[5] = new_state;
-            return;
-        case KEY_F:
-            bit_arr[4] = new_state;
-            return;
-        case KEY_J:
-            bit_arr[3] = new_state;
-            return;
-        case KEY_K:
-            bit_arr[2] = new_state;
-            return;
-        case KEY_L:
-            bit_arr[1] = new_state;
-            return;
-        case KEY_SEMICOLON:
-            bit_arr[0] = new_state;
-            return;
-        case KEY_SPACE:
-            // sets ready_to_compute_byte to true if new_state is true, else leaves it as it is
-            // ready_to_compute_byte should to be set to false after it computing the byte
-            ready_to_compute_byte = new_state ? true : ready_to_compute_byte;
-        default: ;
-    }
-}
-
-/*
- * Runs the loop that constantly checks the keyboard events and performs the associated actions
- */
-void run_stenobyte() {
+ * the commit key, the space bar by default, or an edit key is pressed)
+ */
+void update_bit_arr(struct chord_state* chord, const int key_code, const bool new_state) {
+    const struct keymap_entry entry = get_keymap_entry((unsigned int) key_code);
+
+    if (entry.action == KEY_ACTION_BIT) {
+        // Sets or clears the key's bit in the packed Bit Array
+        chord->bit_arr_mask = new_state ? chord->bit_arr_mask | entry.bit_mask : chord->bit_arr_mask & ~entry.bit_mask;
+    } else if (entry.action == KEY_ACTION_COMMIT) {
+        // sets ready_to_compute_byte to true if new_state is true, else leaves it as it is
+        // ready_to_compute_byte should to be set to false after it computing the byte
+        chord->ready_to_compute_byte = new_state ? true : chord->ready_to_compute_byte;
+        chord->edit = new_state ? CHORD_EDIT_NONE : chord->edit;
+    } else if (entry.action == KEY_ACTION_EDIT && new_state) {
+        // The chord becomes the repeat count of the key's edit instead of being written out
+        chord->ready_to_compute_byte = true;
+        chord->edit = entry.edit;
+    }
+}
+
+/*
+ * Updates the chord in COMMIT_ON_RELEASE mode from a key being pressed or released at time_us (its kernel timestamp
+ * in microseconds). The first press starts a new chord; every bit key pressed until the last key is released is added
+ * to it, and that last release makes it ready to be computed. A change that comes within the debounce time of the key's
+ * last accepted change is ignored, as is a chord whose keys were all released within the minimum chord window.
+ *
+ * Returns what the event did to the chord
+ */
+enum chord_stroke_result update_chord_stroke(struct chord_state* chord, const int key_code, const bool pressed,
+                                             const u_int64_t time_us) {
+    const struct keymap_entry entry = get_keymap_entry((unsigned int) key_code);
+    // An edit key commits the chord like the commit key does, as the repeat count of its edit
+    const bool commit_key = entry.action == KEY_ACTION_COMMIT || entry.action == KEY_ACTION_EDIT;
+    const int key_index = commit_key ? BITS_ARR_SIZE : entry.bit_index;
+    const bool was_held = commit_key ? chord->commit_key_held : (chord->held_bit_mask & entry.bit_mask) != 0;
+
+    // Ignores a press of a key already held, or a release of a key that was never seen being pressed
+    if (pressed == was_held) {
+        return CHORD_STROKE_UPDATED;
+    }
+    if (time_us - chord->last_change_us[key_index] < chord->debounce_us) {
+        return CHORD_STROKE_BOUNCE;
+    }
+    chord->last_change_us[key_index] = time_us;
+
+    const bool chord_in_progress = chord->held_bit_mask != 0 || chord->commit_key_held;
+    if (pressed) {
+        if (!chord_in_progress) {
+            chord->bit_arr_mask = 0x00;
+            chord->chord_start_us = time_us;
+            chord->edit = CHORD_EDIT_NONE;
+        }
+        if (commit_key) {
+            chord->commit_key_held = true;
+            chord->edit = entry.edit;
+        } else {
+            chord->held_bit_mask |= entry.bit_mask;
+            chord->bit_arr_mask |= entry.bit_mask;
+        }
+        return CHORD_STROKE_UPDATED;
+    }
+
+    if (commit_key) {
+        chord->commit_key_held = false;
+    } else {
+        chord->held_bit_mask &= (chord_word) ~entry.bit_mask;
+    }
+    if (chord->held_bit_mask != 0 || chord->commit_key_held) {
+        return CHORD_STROKE_UPDATED;
+    }
+    if (time_us - chord->chord_start_us < chord->minimum_chord_us) {
+        chord->bit_arr_mask = 0x00;
+        return CHORD_STROKE_REJECTED;
+    }
+    chord->ready_to_compute_byte = true;
+    return CHORD_STROKE_COMMITTED;
+}
+
+/*
+ * Counts a byte computed from the Bit Array, and how long after the commit key's kernel timestamp it was computed.
+ * The latency is only recorded for keyboards, as the timestamps of replayed events are from when they were recorded.
+ */
+void count_committed_chord(struct stenobyte_session* session, const struct input_event* commit_event) {
+    add_to_metric(&session->metrics.chords_committed, 1);
+    if (!session->using_event_source) {
+        record_latency(&session->metrics.commit_latency, &commit_event->time);
+    }
+}
+
+/*
+ * Handles a single event read from the keyboard device and performs the associated actions
+ *
+ * Returns false if the app should exit (when ESC is pressed), true otherwise
+ */
+bool handle_key_event(struct stenobyte_session* session, const struct input_event* current_event) {
+    // Ensures a Key Event Type Occurred, ignores otherwise
+    if (current_event->type != EV_KEY) {
+        add_to_metric(&session->metrics.events_filtered, 1);
+        return true;
+    }
+
+    // If the exit key (ESC by default) is pushed, then exit the app
+    if (get_keymap_entry(current_event->code).action == KEY_ACTION_EXIT) {
+        if (session->ignore_exit_key) {
+            add_to_metric(&session->metrics.events_filtered, 1);
+            return true;
+        }
+        // Draws any pending changes first so that the message is printed below the final summary
+        if (session->renderer.dirty) {
+            render_frame(&session->renderer, &session->chord);
+        }
+        printf("ESC pressed\nExiting...\n");
+        return false;
+    }
+
+    // An event that leaves the chord as it was, such as a press of a key already held, needs no work downstream
+    if (!process_key_presses(session, current_event)) {
+        return true;
+    }
+
+    if (session->chord.ready_to_compute_byte) {
+        compute_byte(&session->chord);
+        count_committed_chord(session, current_event);
+        if (session->mode == WRITER) {
+            write_stroke_to_sink(session, &session->byte_sink, get_event_time_us(current_event));
+        }
+    }
+
+    // The summary is redrawn once the pending events have been drained, rather than for every event
+    mark_renderer_dirty(&session->renderer);
+    return true;
+}
+
+/*
+ * Reads and handles the pending events of an Input Source. A keyboard is drained until it reports EAGAIN; a replayed
+ * capture file, which is always ready, is read in batches of REPLAY_BATCH_EVENTS so that timed actions still run.
+ *
+ * Returns DRAIN_EXIT if the exit key was pressed, DRAIN_SOURCE_ENDED if the Input Source can no longer be read from
+ * (a keyboard was unplugged or a capture file has been fully replayed), DRAIN_CONTINUE otherwise
+ */
+static enum drain_result drain_input_source(struct stenobyte_session* session, struct input_source* source) {
     struct input_event current_event;  // The current event struct
+    const bool always_ready = source->file_descriptor < 0;
 
-    print_bit_arr_summary();    // Initial Print Summary
+    for (int events_handled = 0; !always_ready || events_handled < REPLAY_BATCH_EVENTS; events_handled++) {
+        const int next_event_result_code = next_input_event(source, &current_event);
+        if (next_event_result_code == -EAGAIN) {
+            return DRAIN_CONTINUE;
+        }
 
-    // Infinitely loops by default
-    while (1) {
-        // Gets the next event
-        const int next_event_result_code = libevdev_next_event(keyboard_device,
-            LIBEVDEV_READ_FLAG_NORMAL, &current_event);
+        // Stops once a capture file has been fully replayed or the keyboard has been unplugged
+        if (next_event_result_code == INPUT_END_OF_STREAM || next_event_result_code == -ENODEV) {
+            return DRAIN_SOURCE_ENDED;
+        }
+        if (next_event_result_code < 0) {
+            errno = -next_event_result_code;
+            perror("Failed to read from device");
+            return DRAIN_SOURCE_ENDED;
+        }
 
-        // Ignores Non-Success Read Events
-        if (next_event_result_code != LIBEVDEV_READ_STATUS_SUCCESS) {
+        // Rebuilds the Bit Array from the keys really held after the kernel dropped events, instead of letting it go
+        // stale. A commit key press that was dropped cannot be recovered.
+        add_to_metric(&session->metrics.events_received, 1);
+        if (next_event_result_code == LIBEVDEV_READ_STATUS_SYNC) {
+            add_to_metric(&session->metrics.resyncs, 1);
+            const chord_word held_bit_mask = (chord_word) get_held_bit_mask(&session->keyboards);
+            if (session->pipelined) {
+                push_state_to_pipeline(&session->pipeline, true, held_bit_mask, false);
+            } else {
+                resync_chord(&session->chord, held_bit_mask);
+                mark_renderer_dirty(&session->renderer);
+            }
             continue;
         }
 
-        // Ensures a Key Event Type Occurred, ignores otherwise
-        if (current_event.type != EV_KEY) {
+        // Autorepeat only says that a key is still held, which can never change the chord, so it is recorded but goes
+        // no further: a held chord costs nothing until one of its keys changes
+        record_input_event(&session->capture_recorder, &current_event);
+        if (current_event.type == EV_KEY && current_event.value == EV_KEY_REPEATED) {
+            add_to_metric(&session->metrics.repeats_absorbed, 1);
             continue;
         }
 
-        // If the ESC Key is pushed, then exit the app
-        if (current_event.code == KEY_ESC) {
-            printf("ESC pressed\nExiting...\n");
-            break;
+        if (source->type == INPUT_SOURCE_DEVICE) {
+            record_latency(&session->metrics.capture_latency, &current_event.time);
+        }
+        if (session->pipelined) {
+            // The commit thread handles the event; a capture file is only read as fast as it can be committed
+            push_key_event_to_pipeline(&session->pipeline, &current_event, always_ready);
+        } else if (!handle_key_event(session, &current_event)) {
+            return DRAIN_EXIT;
         }
+    }
+    return DRAIN_CONTINUE;
+}
 
-        process_key_presses(&current_event);
-        print_bit_arr_summary();
+/*
+ * Handles a file descriptor reported as ready by epoll that belongs to the Event Source, a keyboard or the hotplug
+ * watch. A keyboard is detached if it can no longer be read from or epoll reports that it has hung up.
+ *
+ * Returns false if the app should exit, true otherwise
+ */
+static bool handle_ready_device(struct stenobyte_session* session, const int file_descriptor,
+                                const u_int32_t ready_flags) {
+    if (session->using_event_source) {
+        return file_descriptor != session->event_source.file_descriptor ||
+               drain_input_source(session, &session->event_source) == DRAIN_CONTINUE;
+    }
 
-        if (ready_to_compute_byte) {
-            compute_byte();
-            if (mode == WRITER) {
-                write_byte_to_file();
+    if (file_descriptor == session->keyboards.hotplug_file_descriptor) {
+        if (process_hotplug_events(&session->keyboards) > 0) {
+            if (session->pipelined) {
+                push_state_to_pipeline(&session->pipeline, false, 0x00, true);
+            } else {
+                invalidate_renderer(&session->renderer);
             }
         }
+        return true;
+    }
 
-        usleep(1000); // Small delay
+    struct keyboard* keyboard = find_keyboard(&session->keyboards, file_descriptor);
+    if (keyboard == nullptr) {
+        return true;
     }
+
+    const u_int64_t raw_reads = keyboard->source.raw_reads;
+    const enum drain_result result = drain_input_source(session, &keyboard->source);
+    add_to_metric(&session->metrics.raw_reads, keyboard->source.raw_reads - raw_reads);
+    if (result == DRAIN_SOURCE_ENDED || (result == DRAIN_CONTINUE && ready_flags & (EPOLLHUP | EPOLLERR))) {
+        // Releases the keys held on the unplugged keyboard so that they cannot stay stuck as 1, keeping the bits still
+        // held on the other keyboards
+        detach_keyboard(&session->keyboards, keyboard);
+        const chord_word held_bit_mask = (chord_word) get_held_bit_mask(&session->keyboards);
+        if (session->pipelined) {
+            push_state_to_pipeline(&session->pipeline, true, held_bit_mask, true);
+        } else {
+            resync_chord(&session->chord, held_bit_mask);
+            invalidate_renderer(&session->renderer);
+        }
+    }
+    return result != DRAIN_EXIT;
+}
+
+/*
+ * Prints how many events were replayed and how quickly
+ */
+static void print_replay_summary(const struct input_source* replay_source, const struct timespec* start_time) {
+    struct timespec end_time;
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    const double elapsed_seconds = (double) (end_time.tv_sec - start_time->tv_sec) +
+                                   (double) (end_time.tv_nsec - start_time->tv_nsec) / 1e9;
+    printf("Replayed %llu events in %.3f s (%.0f events/s)\n", (unsigned long long) replay_source->events_read,
+           elapsed_seconds, elapsed_seconds > 0 ? (double) replay_source->events_read / elapsed_seconds : 0.0);
 }
 
-void end_stenobyte() {
+/*
+ * Waits up to timeout_ms (-1 for no limit) for the events of a session, handles every one that is ready, then performs
+ * the timed actions that are due. This is a single pass of the event loop, for programs that wait on many sessions.
+ * When running as the Pipeline, the commit thread is woken instead of performing the timed actions.
+ *
+ * Returns false once the session should stop (the exit key was pressed, stop_stenobyte() was called or its Event
+ * Source has ended), true otherwise
+ */
+bool process_stenobyte_events(struct stenobyte_session* session, const int timeout_ms) {
+    struct epoll_event ready_events[MAX_EPOLL_EVENTS];
+    bool running = true;
+
+    const int ready_count = epoll_wait(session->epoll_file_descriptor, ready_events, MAX_EPOLL_EVENTS, timeout_ms);
+    if (ready_count < 0) {
+        if (errno == EINTR) {
+            return true;    // Interrupted by a signal; the wake-up eventfd reports whether to stop
+        }
+        perror("Failed to wait for events");
+        return false;
+    }
+
+    for (int i = 0; i < ready_count && running; i++) {
+        const int file_descriptor = ready_events[i].data.fd;
+        if (file_descriptor == session->wake_file_descriptor) {
+            // Wake-up eventfd: stop_stenobyte() was called
+            eventfd_t wake_count;
+            eventfd_read(session->wake_file_descriptor, &wake_count);
+            running = false;
+        } else if (!handle_metrics_event(&session->metrics_server, file_descriptor,
+                                         session->epoll_file_descriptor)) {
+            running = handle_ready_device(session, file_descriptor, ready_events[i].events);
+        }
+    }
+
+    if (running && session->using_event_source && session->event_source.file_descriptor < 0) {
+        running = drain_input_source(session, &session->event_source) == DRAIN_CONTINUE;
+    }
+
+    // The commit thread is woken once per batch of events rather than for every event
+    if (session->pipelined) {
+        wake_pipeline(&session->pipeline);
+    } else {
+        process_stenobyte_timeouts(session);
+    }
+    return running;
+}
+
+/*
+ * Runs the loop that waits for the key events of a session and performs the associated actions.
+ * The loop sleeps in epoll_wait() until a keyboard has events, a keyboard is plugged in, a timed action is due or
+ * stop_stenobyte() is called, then drains every pending event from the keyboards that are ready before sleeping
+ * again. A replayed capture file (or any Event Source without a file descriptor) never sleeps.
+ * When running as the Pipeline, this loop is the capture thread: it only reads events and hands them to the commit
+ * thread, while drawing and writing happen on their own threads (see StenoByte_Pipeline.c).
+ */
+void run_stenobyte(struct stenobyte_session* session) {
+    bool running = true;
+    struct timespec start_time;
+    const bool always_ready = session->using_event_source && session->event_source.file_descriptor < 0;
+
+    // Initial Print Summary (drawn by the render thread when running as the Pipeline)
+    setup_renderer(&session->renderer, !session->options.headless, session->mode);
+    if (session->pipelined) {
+        running = start_pipeline(&session->pipeline, session->renderer.enabled, session->mode == WRITER) == 0;
+    } else {
+        render_frame(&session->renderer, &session->chord);
+    }
+
+    // Only this thread runs in real time: the Pipeline's threads were started before it, so they keep the scheduling
+    // they were started with
+    const bool realtime = session->options.realtime_priority > 0;
+    if (running && realtime) {
+        running = enter_realtime_mode(&session->realtime, session->options.realtime_priority,
+                                      session->options.realtime_cpu) == 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    while (running) {
+        // Sleeps until the next event, or until a timed action (such as flushing the output) is due
+        const int timeout_ms = always_ready ? 0 : session->pipelined ? -1 : get_stenobyte_timeout_ms(session);
+        running = process_stenobyte_events(session, timeout_ms);
+    }
+    if (realtime) {
+        leave_realtime_mode(&session->realtime);
+    }
+
+    if (session->pipelined) {
+        // Waits for every captured event to be committed, drawn and written
+        stop_pipeline(&session->pipeline);
+        if (is_pipeline_exit_requested(&session->pipeline)) {
+            printf("ESC pressed\nExiting...\n");
+        }
+        print_pipeline_counters(&session->pipeline);
+    }
+
+    // Strokes held back by the Dictionary are written out before the output is closed
+    if (!session->pipelined && session->mode == WRITER) {
+        flush_stenobyte_strokes(session, &session->byte_sink);
+    }
+
+    if (session->using_event_source) {
+        if (!session->pipelined && session->renderer.dirty) {
+            render_frame(&session->renderer, &session->chord);
+        }
+        if (session->event_source.type == INPUT_SOURCE_REPLAY) {
+            print_replay_summary(&session->event_source, &start_time);
+        }
+    }
+    if (session->options.latency_report) {
+        print_latency_report(&session->metrics);
+    }
+}
+
+/*
+ * Wakes the event loop of a session and makes run_stenobyte() return. Safe to call from a signal handler or another
+ * thread.
+ */
+void stop_stenobyte(struct stenobyte_session* session) {
+    if (session->wake_file_descriptor >= 0) {
+        eventfd_write(session->wake_file_descriptor, 1);
+    }
+}
+
+void end_stenobyte(struct stenobyte_session* session) {
     // Frees up resources before application ends
-    libevdev_free(keyboard_device);
-    restore_terminal(); // Restores printing inputs to the terminal
-    close(event_file_device);
+    end_capture_recording(&session->capture_recorder);
+    end_input_source(&session->event_source);
+    end_keyboards(&session->keyboards);
+    end_metrics_server(&session->metrics_server, session->epoll_file_descriptor);
+
+    // The translator is left without the Dictionary, so that it never reads the freed trie
+    setup_stroke_translator(&session->translator, nullptr, session->options.dictionary_timeout_ms,
+                            session->options.byte_order);
+    end_dictionary(&session->dictionary);
+    restore_terminal(session);  // Restores printing inputs to the terminal
+    if (signal_session == session) {
+        signal_session = nullptr;
+    }
+
+    if (session->wake_file_descriptor >= 0) {
+        close(session->wake_file_descriptor);
+        session->wake_file_descriptor = -1;
+    }
+    if (session->epoll_file_descriptor >= 0) {
+        close(session->epoll_file_descriptor);
+        session->epoll_file_descriptor = -1;
+    }
 }
 
 /*
- * Checks whether a valid key is pressed
+ * Checks whether a valid key is pressed: one that sets a bit, computes the byte or applies an edit
  */
 bool is_valid_key(const int key_code) {
-    switch (key_code) {
-        case KEY_A:
-        case KEY_S:
-        case KEY_D:
-        case KEY_F:
-        case KEY_J:
-        case KEY_K:
-        case KEY_L:
-        case KEY_SEMICOLON:
-        case KEY_SPACE:
-            return true;
-        default:
-            return false;
-    }
+    const u_int8_t action = get_keymap_entry((unsigned int) key_code).action;
+    return action == KEY_ACTION_BIT || action == KEY_ACTION_COMMIT || action == KEY_ACTION_EDIT;
 }
 
 /*
@@ -191,47 +603,65 @@ void print_event_summary(const struct input_event* current_event) {
 }
 
 /*
- * Processes the key events, such as key presses, key releases, and key repeats (when the key is held down)
+ * Processes the key events, such as key presses and key releases. Each key only changes state when it is pressed or
+ * released; a key repeat (when the key is held down) changes nothing, so holding the commit key commits a single byte.
+ *
+ * Returns true if the event changed the Bit Array or made the chord ready to be computed, false otherwise
  */
-void process_key_presses(const struct input_event* current_event) {
+bool process_key_presses(struct stenobyte_session* session, const struct input_event* current_event) {
     // Exits method if event is null
     if (current_event == NULL) {
-        return;
+        return false;
     }
 
     // Exits method if the event_type variable is not related to a key event
     if (current_event->type != EV_KEY) {
-        return;
+        return false;
     }
 
-    // Exits method if event is for an irrelevant key
-    if (!is_valid_key(current_event->code)) {
-        return;
+    // Exits method if event is for an irrelevant key, or for an edit key when the Byte Sink takes no edits
+    if (!is_valid_key(current_event->code) ||
+        (get_keymap_entry(current_event->code).action == KEY_ACTION_EDIT &&
+         session->byte_sink.apply_edit == nullptr)) {
+        add_to_metric(&session->metrics.events_filtered, 1);
+        return false;
     }
 
-    // Sets the bit value in the array to zero if the associated key is released
-    // Then exits the method
-    if (current_event->value == EV_KEY_RELEASED) {
-        update_bit_arr(current_event->code, false);
-        return;
+    // Exits method if key event is not a key press or key release
+    if (current_event->value != EV_KEY_PRESSED && current_event->value != EV_KEY_RELEASED) {
+        return false;
     }
 
-    // Exits method if key event is not a key press or key repeat
-    if (current_event->value != EV_KEY_PRESSED && current_event->value != EV_KEY_REPEATED) {
-        return;
+    const chord_word previous_bit_mask = session->chord.bit_arr_mask;
+
+    // Times the chord from the kernel timestamps instead
+    if (session->chord.commit_mode == COMMIT_ON_RELEASE) {
+        const enum chord_stroke_result result = update_chord_stroke(&session->chord, current_event->code,
+                                                                    current_event->value == EV_KEY_PRESSED,
+                                                                    get_event_time_us(current_event));
+        if (result == CHORD_STROKE_REJECTED) {
+            add_to_metric(&session->metrics.chords_rejected, 1);
+        } else if (result == CHORD_STROKE_BOUNCE) {
+            add_to_metric(&session->metrics.bounces_filtered, 1);
+        }
+    } else {
+        // Sets or clears the bit value in the array as the associated key is pressed or released
+        update_bit_arr(&session->chord, current_event->code, current_event->value == EV_KEY_PRESSED);
     }
 
-    // Updates Bit Value in Array
-    update_bit_arr(current_event->code, true);
+    return session->chord.bit_arr_mask != previous_bit_mask || session->chord.ready_to_compute_byte;
 }
 
 /*
  * Disables echoing/printing key presses in terminal
  */
-void disable_echo() {
+void disable_echo(struct stenobyte_session* session) {
     struct termios temporary_terminal_settings;
-    tcgetattr(STDIN_FILENO, &original_terminal_settings); // Get current terminal settings
-    temporary_terminal_settings = original_terminal_settings;   // Copy original settings to temporary settings
+    if (tcgetattr(STDIN_FILENO, &session->original_terminal_settings) != 0) { // Get current terminal settings
+        return;
+    }
+    session->terminal_settings_saved = true;
+    temporary_terminal_settings = session->original_terminal_settings;   // Copy original settings to temporary settings
     temporary_terminal_settings.c_lflag &= ~ECHO; // Disable ECHO flag
     tcsetattr(STDIN_FILENO, TCSANOW, &temporary_terminal_settings);   // Apply temporary settings
 }
@@ -239,6 +669,10 @@ void disable_echo() {
 /*
  * Restores original terminal settings before this program running
  */
-void restore_terminal() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_terminal_settings); // restore settings
+void restore_terminal(struct stenobyte_session* session) {
+    if (!session->terminal_settings_saved) {
+        return;
+    }
+    tcsetattr(STDIN_FILENO, TCSANOW, &session->original_terminal_settings); // restore settings
+    session->terminal_settings_saved = false;
 }
@@ -0,0 +1,395 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Input.c is the source file for implementing Input Sources. The Device Backend reads key events from a
+    keyboard with libevdev, and the Replay Backend reads them from a capture file so that the rest of the app can be
+    run without a keyboard or elevated privileges. The Capture Recorder writes events to a capture file.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Input.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Resets every field of the Input Source so that end_input_source() only releases what was set up
+ */
+static void reset_input_source(struct input_source* source, const enum input_source_type type) {
+    memset(source, 0, sizeof(*source));
+    source->type = type;
+    source->file_descriptor = -1;
+    source->replay_file_descriptor = -1;
+}
+
+/*
+ * Device Backend: reads the next event queued by libevdev.
+ * When the kernel's buffer overflowed (SYN_DROPPED), libevdev's resync events are consumed here, which brings
+ * libevdev's key state back in line with the device, and LIBEVDEV_READ_STATUS_SYNC is returned so that the caller can
+ * rebuild its own state from libevdev_get_event_value().
+ */
+static int next_device_event(struct input_source* source, struct input_event* event) {
+    const int result = libevdev_next_event(source->device, LIBEVDEV_READ_FLAG_NORMAL, event);
+    if (result != LIBEVDEV_READ_STATUS_SYNC) {
+        return result;
+    }
+
+    int sync_result;
+    do {
+        sync_result = libevdev_next_event(source->device, LIBEVDEV_READ_FLAG_SYNC, event);
+    } while (sync_result == LIBEVDEV_READ_STATUS_SYNC);
+
+    source->resync_count++;
+    return LIBEVDEV_READ_STATUS_SYNC;
+}
+
+/*
+ * Raw Device Backend: hands out the events of the last read() from the device, and reads the next batch with a single
+ * read() once they run out. When that read() came back short, the device had nothing more to give, so -EAGAIN is
+ * returned without another read(): epoll is level-triggered, so the event loop is woken again by any event that
+ * arrived in between. After SYN_DROPPED, the events up to the next SYN_REPORT are incomplete and are discarded, then
+ * LIBEVDEV_READ_STATUS_SYNC is returned so that the caller can rebuild its state from the keys the kernel reports as
+ * held (see get_held_bit_mask()).
+ */
+static int next_raw_device_event(struct input_source* source, struct input_event* event) {
+    while (true) {
+        if (source->raw_position == source->raw_event_count) {
+            if (source->raw_drained) {
+                source->raw_drained = false;
+                return -EAGAIN;
+            }
+            const ssize_t bytes_read = read(source->file_descriptor, source->raw_buffer,
+                                            DEVICE_READ_EVENTS * sizeof(struct input_event));
+            if (bytes_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_read < 0) {
+                return -errno;
+            }
+            source->raw_reads++;
+            if (bytes_read == 0) {
+                return -ENODEV; // Only a device that has gone away has nothing to read without EAGAIN
+            }
+            source->raw_event_count = (size_t) bytes_read / sizeof(struct input_event);
+            source->raw_position = 0;
+            source->raw_drained = source->raw_event_count < DEVICE_READ_EVENTS;
+        }
+
+        *event = source->raw_buffer[source->raw_position++];
+        if (event->type == EV_SYN && event->code == SYN_DROPPED) {
+            source->raw_discarding = true;
+        } else if (!source->raw_discarding) {
+            return LIBEVDEV_READ_STATUS_SUCCESS;
+        } else if (event->type == EV_SYN && event->code == SYN_REPORT) {
+            source->raw_discarding = false;
+            source->resync_count++;
+            return LIBEVDEV_READ_STATUS_SYNC;
+        }
+    }
+}
+
+/*
+ * Replay Backend for memory-mapped capture files: copies the next record out of the mapping
+ */
+static int next_mapped_replay_event(struct input_source* source, struct input_event* event) {
+    if (source->replay_position == source->replay_event_count) {
+        return INPUT_END_OF_STREAM;
+    }
+    *event = source->replay_events[source->replay_position++];
+    return LIBEVDEV_READ_STATUS_SUCCESS;
+}
+
+/*
+ * Callback Backend: asks the embedding program for the next event
+ */
+static int next_callback_event(struct input_source* source, struct input_event* event) {
+    return source->callback(source->callback_context, event);
+}
+
+/*
+ * Reads from a file until the buffer is full or the end of the file is reached
+ *
+ * Returns the number of bytes read, or -1 if there was an error
+ */
+static ssize_t read_fully(const int file_descriptor, void* buffer, const size_t length) {
+    size_t total = 0;
+    while (total < length) {
+        const ssize_t result = read(file_descriptor, (char*) buffer + total, length - total);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            return -1;
+        }
+        if (result == 0) {
+            break;
+        }
+        total += (size_t) result;
+    }
+    return (ssize_t) total;
+}
+
+/*
+ * Replay Backend for streamed capture files: refills a buffer of records with one read when it runs out
+ */
+static int next_streamed_replay_event(struct input_source* source, struct input_event* event) {
+    if (source->replay_position == source->replay_event_count) {
+        const ssize_t bytes_read = read_fully(source->replay_file_descriptor, source->replay_stream_buffer,
+                                              CAPTURE_BUFFER_EVENTS * sizeof(struct input_event));
+        if (bytes_read < 0) {
+            return -errno;
+        }
+
+        // A truncated final record is ignored
+        source->replay_event_count = (size_t) bytes_read / sizeof(struct input_event);
+        source->replay_position = 0;
+        if (source->replay_event_count == 0) {
+            return INPUT_END_OF_STREAM;
+        }
+    }
+    *event = source->replay_stream_buffer[source->replay_position++];
+    return LIBEVDEV_READ_STATUS_SUCCESS;
+}
+
+/*
+ * Checks that a capture file header was written by this format on a machine with the same event layout
+ *
+ * Returns true if the header is valid
+ */
+static bool is_valid_capture_header(const struct capture_file_header* header) {
+    return memcmp(header->magic, CAPTURE_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == CAPTURE_FILE_VERSION &&
+           header->event_size == sizeof(struct input_event);
+}
+
+/*
+ * Sets up an Input Source that reads from a keyboard device that has been initialised with libevdev. With raw_reads,
+ * the events are read straight from the device in batches instead, and libevdev is only used to set the device up.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_device_input_source(struct input_source* source, struct libevdev* device, const bool raw_reads) {
+    reset_input_source(source, INPUT_SOURCE_DEVICE);
+    source->device = device;
+    source->file_descriptor = libevdev_get_fd(device);
+    source->next_event = next_device_event;
+    if (raw_reads) {
+        source->raw_buffer = malloc(DEVICE_READ_EVENTS * sizeof(struct input_event));
+        if (source->raw_buffer == nullptr) {
+            perror("Failed to allocate device buffer");
+            return 1;
+        }
+        source->next_event = next_raw_device_event;
+    }
+    return 0;
+}
+
+/*
+ * Sets up an Input Source that replays a capture file. Regular files are memory-mapped; anything else (such as a
+ * pipe or "-" for stdin) is streamed.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_replay_input_source(struct input_source* source, const char* capture_file_path) {
+    reset_input_source(source, INPUT_SOURCE_REPLAY);
+
+    source->replay_file_descriptor = strcmp(capture_file_path, "-") == 0
+                                         ? STDIN_FILENO
+                                         : open(capture_file_path, O_RDONLY | O_CLOEXEC);
+    if (source->replay_file_descriptor < 0) {
+        perror("Failed to open capture file");
+        return 1;
+    }
+
+    struct stat file_status;
+    if (fstat(source->replay_file_descriptor, &file_status) == 0 && S_ISREG(file_status.st_mode) &&
+        (size_t) file_status.st_size >= sizeof(struct capture_file_header)) {
+        source->replay_mapping_length = (size_t) file_status.st_size;
+        source->replay_mapping = mmap(nullptr, source->replay_mapping_length, PROT_READ, MAP_PRIVATE,
+                                      source->replay_file_descriptor, 0);
+        if (source->replay_mapping == MAP_FAILED) {
+            source->replay_mapping = nullptr;
+        }
+    }
+
+    if (source->replay_mapping != nullptr) {
+        if (!is_valid_capture_header(source->replay_mapping)) {
+            fprintf(stderr, "Not a StenoByte capture file (or recorded on another architecture): %s\n",
+                    capture_file_path);
+            return 1;
+        }
+        madvise(source->replay_mapping, source->replay_mapping_length, MADV_SEQUENTIAL);
+        source->replay_events = (const struct input_event*) ((const char*) source->replay_mapping +
+                                                             sizeof(struct capture_file_header));
+        source->replay_event_count = (source->replay_mapping_length - sizeof(struct capture_file_header)) /
+                                     sizeof(struct input_event);
+        source->next_event = next_mapped_replay_event;
+        return 0;
+    }
+
+    struct capture_file_header header;
+    if (read_fully(source->replay_file_descriptor, &header, sizeof(header)) != sizeof(header) ||
+        !is_valid_capture_header(&header)) {
+        fprintf(stderr, "Not a StenoByte capture file (or recorded on another architecture): %s\n",
+                capture_file_path);
+        return 1;
+    }
+    source->replay_stream_buffer = malloc(CAPTURE_BUFFER_EVENTS * sizeof(struct input_event));
+    if (source->replay_stream_buffer == nullptr) {
+        perror("Failed to allocate replay buffer");
+        return 1;
+    }
+    source->next_event = next_streamed_replay_event;
+    return 0;
+}
+
+/*
+ * Sets up an Input Source whose events are supplied by a callback, such as a program that embeds a session and
+ * receives key events from elsewhere. If file_descriptor is not -1, the event loop waits on it and calls the callback
+ * until it returns -EAGAIN; otherwise the source is always ready and is read like a capture file.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_callback_input_source(struct input_source* source, const int file_descriptor,
+                                const input_event_callback callback, void* context) {
+    reset_input_source(source, INPUT_SOURCE_CALLBACK);
+    if (callback == nullptr) {
+        fprintf(stderr, "A Callback Input Source needs a callback\n");
+        return 1;
+    }
+    source->file_descriptor = file_descriptor;
+    source->callback = callback;
+    source->callback_context = context;
+    source->next_event = next_callback_event;
+    return 0;
+}
+
+/*
+ * Reads the next event from the Input Source
+ *
+ * Returns LIBEVDEV_READ_STATUS_SUCCESS when an event was read, LIBEVDEV_READ_STATUS_SYNC when a device had to be
+ * resynchronised after the kernel dropped events, -EAGAIN if no event is available yet, INPUT_END_OF_STREAM once a
+ * capture file has been fully replayed, or another negative errno value
+ */
+int next_input_event(struct input_source* source, struct input_event* event) {
+    const int result = source->next_event(source, event);
+    if (result == LIBEVDEV_READ_STATUS_SUCCESS) {
+        source->events_read++;
+    }
+    return result;
+}
+
+/*
+ * Releases the resources of the Input Source. The libevdev device of a Device Input Source is left to its owner.
+ */
+void end_input_source(struct input_source* source) {
+    if (source->replay_mapping != nullptr) {
+        munmap(source->replay_mapping, source->replay_mapping_length);
+        source->replay_mapping = nullptr;
+    }
+    free(source->replay_stream_buffer);
+    source->replay_stream_buffer = nullptr;
+    free(source->raw_buffer);
+    source->raw_buffer = nullptr;
+    if (source->replay_file_descriptor > STDIN_FILENO) {
+        close(source->replay_file_descriptor);
+    }
+    source->replay_file_descriptor = -1;
+}
+
+/*
+ * Writes the buffered recorded events to the capture file
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int flush_capture_recording(struct capture_recorder* recorder) {
+    const size_t length = recorder->count * sizeof(struct input_event);
+    size_t total = 0;
+    while (total < length) {
+        const ssize_t written = write(recorder->file_descriptor, (char*) recorder->buffer + total, length - total);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            perror("Failed to write to capture file");
+            return 1;
+        }
+        total += (size_t) written;
+    }
+    recorder->count = 0;
+    return 0;
+}
+
+/*
+ * Starts recording events to a new capture file
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int start_capture_recording(struct capture_recorder* recorder, const char* capture_file_path) {
+    recorder->count = 0;
+    recorder->file_descriptor = open(capture_file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (recorder->file_descriptor < 0) {
+        perror("Failed to open capture file for recording");
+        return 1;
+    }
+
+    recorder->buffer = malloc(CAPTURE_BUFFER_EVENTS * sizeof(struct input_event));
+    if (recorder->buffer == nullptr) {
+        perror("Failed to allocate recording buffer");
+        return 1;
+    }
+
+    struct capture_file_header header = {.version = CAPTURE_FILE_VERSION, .event_size = sizeof(struct input_event)};
+    memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic));
+    if (write(recorder->file_descriptor, &header, sizeof(header)) != sizeof(header)) {
+        perror("Failed to write capture file header");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Appends an event to the capture file if recording has been started, writing the events in batches
+ */
+void record_input_event(struct capture_recorder* recorder, const struct input_event* event) {
+    if (recorder->file_descriptor < 0) {
+        return;
+    }
+
+    recorder->buffer[recorder->count++] = *event;
+    if (recorder->count == CAPTURE_BUFFER_EVENTS) {
+        flush_capture_recording(recorder);
+    }
+}
+
+/*
+ * Writes any buffered events and closes the capture file
+ */
+void end_capture_recording(struct capture_recorder* recorder) {
+    if (recorder->file_descriptor >= 0) {
+        flush_capture_recording(recorder);
+        close(recorder->file_descriptor);
+        recorder->file_descriptor = -1;
+    }
+    free(recorder->buffer);
+    recorder->buffer = nullptr;
+}
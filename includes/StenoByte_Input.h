@@ -0,0 +1,114 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Input.h is the header file for defining Input Sources, which supply key events to the event loop either
+    from a keyboard device or from a capture file, and for recording the events of a session to a capture file.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_INPUT_H
+#define STENOBYTE_INPUT_H
+
+#include <linux/input.h>
+#include <libevdev/libevdev.h>
+#include <sys/types.h>
+#include <stdbool.h>
+
+// Capture File Format: a header followed by struct input_event records exactly as read from the device
+#define CAPTURE_FILE_MAGIC "STBYCAP1"
+#define CAPTURE_FILE_VERSION 1
+
+// Returned by next_input_event() when a capture file has been fully replayed
+#define INPUT_END_OF_STREAM (-ENODATA)
+
+// Number of events read or written per system call when streaming or recording a capture file
+#define CAPTURE_BUFFER_EVENTS 512
+
+// Largest number of events read from a keyboard with a single read() when reading it raw
+#define DEVICE_READ_EVENTS 64
+
+struct capture_file_header {
+    char magic[8];
+    u_int32_t version;
+    u_int32_t event_size;   // sizeof(struct input_event) on the machine that recorded the capture
+};
+
+enum input_source_type {
+    INPUT_SOURCE_DEVICE = 0,    // A keyboard device read with libevdev, or raw with read() once set up
+    INPUT_SOURCE_REPLAY,        // A capture file replayed as fast as possible
+    INPUT_SOURCE_CALLBACK       // Events supplied by a function of the embedding program
+};
+
+// Supplies the next event of a Callback Input Source, with the same return values as next_input_event()
+typedef int (*input_event_callback)(void* context, struct input_event* event);
+
+struct input_source {
+    enum input_source_type type;
+    int file_descriptor;    // Can be waited on with epoll, -1 for sources that are always ready (replay sources)
+    int (*next_event)(struct input_source* source, struct input_event* event);  // Backend that reads the next event
+    u_int64_t events_read;  // Counter of events returned by next_input_event()
+    u_int64_t resync_count; // Counter of resynchronisations after the kernel dropped events (SYN_DROPPED)
+    u_int64_t raw_reads;    // Counter of read() calls made by the Raw Device Backend
+
+    // Device Backend
+    struct libevdev* device;
+
+    // Raw Device Backend: the events of the last read() from the device, which bypasses libevdev's queue
+    struct input_event* raw_buffer; // nullptr when the device is read with libevdev
+    size_t raw_event_count;
+    size_t raw_position;
+    bool raw_drained;       // The last read() did not fill the buffer, so the device had no more events at the time
+    bool raw_discarding;    // Events are being discarded after SYN_DROPPED, up to the next SYN_REPORT
+
+    // Replay Backend: a memory-mapped capture file, or a stream when the file cannot be mapped (e.g. a pipe)
+    int replay_file_descriptor;
+    void* replay_mapping;
+    size_t replay_mapping_length;
+    const struct input_event* replay_events;
+    size_t replay_event_count;
+    size_t replay_position;
+    struct input_event* replay_stream_buffer;
+
+    // Callback Backend
+    input_event_callback callback;
+    void* callback_context;
+};
+
+struct capture_recorder {
+    int file_descriptor;    // -1 when not recording
+    struct input_event* buffer;
+    size_t count;
+};
+
+/*
+ * Gets the kernel timestamp of an event in microseconds
+ */
+static inline u_int64_t get_event_time_us(const struct input_event* event) {
+    return (u_int64_t) event->time.tv_sec * 1000000u + (u_int64_t) event->time.tv_usec;
+}
+
+// Methods & Functions
+int setup_device_input_source(struct input_source* source, struct libevdev* device, bool raw_reads);
+int setup_replay_input_source(struct input_source* source, const char* capture_file_path);
+int setup_callback_input_source(struct input_source* source, int file_descriptor, input_event_callback callback,
+                                void* context);
+int next_input_event(struct input_source* source, struct input_event* event);
+void end_input_source(struct input_source* source);
+int start_capture_recording(struct capture_recorder* recorder, const char* capture_file_path);
+void record_input_event(struct capture_recorder* recorder, const struct input_event* event);
+void end_capture_recording(struct capture_recorder* recorder);
+
+#endif //STENOBYTE_INPUT_H
@@ -0,0 +1,337 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Journal.c is the source file for implementing the Journal, which appends a record of every committed byte
+    to a journal file in group commits, and recovers the bytes of a session that did not end cleanly.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Journal.h"
+#include "StenoByte_Time.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Returns the checksum of a record: the inverted Fletcher-16 of every field before the checksum
+ */
+static u_int16_t get_journal_record_checksum(const struct journal_record* record) {
+    const u_int8_t* bytes = (const u_int8_t*) record;
+    unsigned int sum1 = 0;
+    unsigned int sum2 = 0;
+    for (size_t i = 0; i < offsetof(struct journal_record, checksum); i++) {
+        sum1 = (sum1 + bytes[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (u_int16_t) ~(sum2 << 8 | sum1);
+}
+
+/*
+ * Reads up to size bytes from the journal file, retrying on interrupted and partial reads
+ *
+ * Returns the number of bytes read, which is less than size only at the end of the file, or -1 if there were errors
+ */
+static ssize_t read_journal_file(const int file_descriptor, void* buffer, const size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t bytes_read = read(file_descriptor, (u_int8_t*) buffer + total, size - total);
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        total += (size_t) bytes_read;
+    }
+    return (ssize_t) total;
+}
+
+/*
+ * Writes size bytes to the journal file at offset, retrying on interrupted and partial writes
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int write_journal_file(const int file_descriptor, const void* buffer, const size_t size, const off_t offset) {
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t written = pwrite(file_descriptor, (const u_int8_t*) buffer + total, size - total,
+                                       offset + (off_t) total);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        total += (size_t) written;
+    }
+    return 0;
+}
+
+/*
+ * Syncs the directory holding the journal file, so that a journal file that was just created survives a crash
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int sync_journal_directory(const char* journal_file_path) {
+    char directory_path[PATH_MAX];
+    snprintf(directory_path, sizeof(directory_path), "%s", journal_file_path);
+    char* last_slash = strrchr(directory_path, '/');
+    if (last_slash == nullptr) {
+        strcpy(directory_path, ".");
+    } else {
+        last_slash[last_slash == directory_path ? 1 : 0] = '\0';
+    }
+
+    const int directory_file_descriptor = open(directory_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory_file_descriptor < 0 || fsync(directory_file_descriptor) != 0) {
+        perror("Failed to sync journal directory");
+        if (directory_file_descriptor >= 0) {
+            close(directory_file_descriptor);
+        }
+        return 1;
+    }
+    close(directory_file_descriptor);
+    return 0;
+}
+
+/*
+ * Reads the records after the header for as long as each one follows on from the one before, and collects their bytes
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int recover_journal_records(struct byte_journal* journal, u_int8_t** recovered_bytes,
+                                   size_t* recovered_count) {
+    size_t capacity = 0;
+    while (true) {
+        // Reads a group's worth of records at a time into the group, which is empty until the Journal is open
+        const ssize_t bytes_read = read_journal_file(journal->file_descriptor, journal->group, sizeof(journal->group));
+        if (bytes_read < 0) {
+            perror("Failed to read journal file");
+            return 1;
+        }
+
+        const size_t record_count = (size_t) bytes_read / sizeof(struct journal_record);
+        for (size_t i = 0; i < record_count; i++) {
+            const struct journal_record* record = &journal->group[i];
+            if (record->sequence != (u_int32_t) journal->next_sequence ||
+                record->checksum != get_journal_record_checksum(record)) {
+                return 0;
+            }
+
+            if (*recovered_count == capacity) {
+                capacity = capacity > 0 ? capacity * 2 : JOURNAL_GROUP_RECORDS;
+                u_int8_t* grown = realloc(*recovered_bytes, capacity);
+                if (grown == nullptr) {
+                    perror("Failed to allocate recovered bytes");
+                    return 1;
+                }
+                *recovered_bytes = grown;
+            }
+            (*recovered_bytes)[(*recovered_count)++] = record->byte;
+            journal->next_sequence++;
+        }
+        if (record_count < JOURNAL_GROUP_RECORDS) {
+            return 0;
+        }
+    }
+}
+
+/*
+ * Opens (or creates) the journal file. If it holds records, because the session that wrote it did not end cleanly,
+ * their bytes are recovered up to the first record that is missing, torn or out of sequence; anything after that is
+ * cut off, and new records follow on from the recovered ones.
+ * recovered_bytes must be freed by the caller, and is nullptr if nothing was recovered.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int open_byte_journal(struct byte_journal* journal, const char* journal_file_path, const int interval_ms,
+                      u_int8_t** recovered_bytes, size_t* recovered_count) {
+    *recovered_bytes = nullptr;
+    *recovered_count = 0;
+    journal->interval_ms = interval_ms > 0 ? interval_ms : DEFAULT_JOURNAL_INTERVAL_MS;
+    journal->next_sequence = 0;
+    journal->group_count = 0;
+    journal->file_size = sizeof(struct journal_header);
+    atomic_init(&journal->group_commits, 0);
+
+    journal->file_descriptor = open(journal_file_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (journal->file_descriptor < 0) {
+        perror("Failed to open journal file");
+        return 1;
+    }
+
+    struct journal_header expected_header = {
+        .version = JOURNAL_FORMAT_VERSION, .record_size = sizeof(struct journal_record)
+    };
+    memcpy(expected_header.magic, JOURNAL_MAGIC, sizeof(expected_header.magic));
+
+    struct journal_header header;
+    const ssize_t header_size = read_journal_file(journal->file_descriptor, &header, sizeof(header));
+    int result = 0;
+    if (header_size < 0) {
+        perror("Failed to read journal file");
+        result = 1;
+    } else if (header_size < (ssize_t) sizeof(header) && memcmp(&header, &expected_header, (size_t) header_size) == 0) {
+        // A new journal file, or one whose header never reached the disk
+        if (ftruncate(journal->file_descriptor, 0) != 0 ||
+            write_journal_file(journal->file_descriptor, &expected_header, sizeof(expected_header), 0) != 0 ||
+            fdatasync(journal->file_descriptor) != 0) {
+            perror("Failed to write journal file");
+            result = 1;
+        } else {
+            result = sync_journal_directory(journal_file_path);
+        }
+    } else if (header_size < (ssize_t) sizeof(header) || memcmp(&header, &expected_header, sizeof(header)) != 0) {
+        fprintf(stderr, "Not a StenoByte journal file, or written by an incompatible version: %s\n",
+                journal_file_path);
+        result = 1;
+    } else if (recover_journal_records(journal, recovered_bytes, recovered_count) != 0) {
+        result = 1;
+    } else {
+        journal->file_size += (off_t) (journal->next_sequence * sizeof(struct journal_record));
+        if (ftruncate(journal->file_descriptor, journal->file_size) != 0) {
+            perror("Failed to truncate journal file");
+            result = 1;
+        }
+    }
+
+    if (result != 0) {
+        free(*recovered_bytes);
+        *recovered_bytes = nullptr;
+        *recovered_count = 0;
+        close(journal->file_descriptor);
+        journal->file_descriptor = -1;
+    }
+    return result;
+}
+
+/*
+ * Adds the record of a committed byte to the current group, and commits the group once it is full or its first record
+ * has waited for the interval. A group left full by a failed commit is committed again first, and the byte is not
+ * recorded if that fails too.
+ *
+ * Returns 0 if the byte was recorded, 1 if it was not
+ */
+int append_to_journal(struct byte_journal* journal, const u_int8_t byte) {
+    if (journal->group_count == JOURNAL_GROUP_RECORDS && commit_journal_group(journal) != 0) {
+        return 1;
+    }
+    if (journal->group_count == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &journal->group_start_time);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    struct journal_record* record = &journal->group[journal->group_count++];
+    *record = (struct journal_record) {
+        .time_ns = (u_int64_t) now.tv_sec * 1000000000ULL + (u_int64_t) now.tv_nsec,
+        .sequence = (u_int32_t) journal->next_sequence++,
+        .byte = byte
+    };
+    record->checksum = get_journal_record_checksum(record);
+
+    // A failed commit keeps the group, which is committed again on the next timeout, or before the next record if full
+    if (journal->group_count == JOURNAL_GROUP_RECORDS ||
+        milliseconds_since(&journal->group_start_time) >= journal->interval_ms) {
+        commit_journal_group(journal);
+    }
+    return 0;
+}
+
+/*
+ * Appends the current group to the journal file with a single write and syncs it. The group is written at the same
+ * offset again if the write fails, so a failed commit can be retried without leaving a gap in the sequence.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int commit_journal_group(struct byte_journal* journal) {
+    if (journal->file_descriptor < 0 || journal->group_count == 0) {
+        return 0;
+    }
+
+    const size_t group_size = journal->group_count * sizeof(struct journal_record);
+    if (write_journal_file(journal->file_descriptor, journal->group, group_size, journal->file_size) != 0 ||
+        fdatasync(journal->file_descriptor) != 0) {
+        perror("Failed to commit journal group");
+        return 1;
+    }
+    journal->file_size += (off_t) group_size;
+    journal->group_count = 0;
+    add_to_metric(&journal->group_commits, 1);
+    return 0;
+}
+
+/*
+ * Gets how long the event loop may sleep before the current group is due to be committed
+ *
+ * Returns the timeout in milliseconds, or -1 if no commit is due
+ */
+int get_journal_commit_timeout_ms(const struct byte_journal* journal) {
+    if (journal->file_descriptor < 0 || journal->group_count == 0) {
+        return -1;
+    }
+
+    const long long remaining_ms = journal->interval_ms - milliseconds_since(&journal->group_start_time);
+    return remaining_ms > 0 ? (int) remaining_ms : 0;
+}
+
+/*
+ * Commits the current group if its first record has waited for the interval. Called by the event loop on timeouts.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int process_journal_timeout(struct byte_journal* journal) {
+    if (get_journal_commit_timeout_ms(journal) != 0) {
+        return 0;
+    }
+    return commit_journal_group(journal);
+}
+
+/*
+ * Commits the current group and closes the journal file. Once every byte is synced to the output file, the records
+ * are no longer needed and the journal file is cut back to its header, which marks the session as having ended
+ * cleanly; otherwise they are kept, to be recovered on the next start.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int close_byte_journal(struct byte_journal* journal, const bool output_synced) {
+    if (journal->file_descriptor < 0) {
+        return 0;
+    }
+
+    int result = commit_journal_group(journal);
+    if (result == 0 && output_synced &&
+        (ftruncate(journal->file_descriptor, sizeof(struct journal_header)) != 0 ||
+         fdatasync(journal->file_descriptor) != 0)) {
+        perror("Failed to empty journal file");
+        result = 1;
+    }
+    if (close(journal->file_descriptor) != 0) {
+        perror("Failed to close journal file");
+        result = 1;
+    }
+    journal->file_descriptor = -1;
+    return result;
+}
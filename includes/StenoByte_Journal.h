@@ -0,0 +1,83 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Journal.h is the header file for defining the Journal: an append-only record of every committed byte,
+    synced in group commits, from which the output file is rebuilt after a crash.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_JOURNAL_H
+#define STENOBYTE_JOURNAL_H
+
+#include "StenoByte_Metrics.h"
+
+#include <sys/types.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Journal File
+#define JOURNAL_MAGIC "STBYJRN1"
+#define JOURNAL_FORMAT_VERSION 1
+
+// Number of records a group commit holds at most (4 KiB of records)
+#define JOURNAL_GROUP_RECORDS 256
+
+// Default time a record may wait before its group is committed, which is the most typing a crash can lose
+#define DEFAULT_JOURNAL_INTERVAL_MS 50
+
+struct journal_header {
+    char magic[8];  // JOURNAL_MAGIC, without its terminating '\0'
+    u_int32_t version;  // JOURNAL_FORMAT_VERSION
+    u_int32_t record_size;  // sizeof(struct journal_record)
+};
+
+/*
+ * The record of a committed byte, in native byte order. Records are only recovered while their sequence numbers follow
+ * on from each other and their checksums match, so a group torn by a crash ends the recovery.
+ */
+struct journal_record {
+    u_int64_t time_ns;  // CLOCK_REALTIME when the byte was committed
+    u_int32_t sequence; // Position of the byte in the output file, modulo 2^32
+    u_int8_t byte;
+    u_int8_t reserved;
+    u_int16_t checksum; // Inverted Fletcher-16 of the fields above, so that a record of zeros never matches
+};
+
+static_assert(sizeof(struct journal_record) == 16, "Journal records must be 16 bytes");
+
+struct byte_journal {
+    int file_descriptor;    // -1 when no Journal is kept
+    int interval_ms;
+    off_t file_size;    // Where the next group is written: the end of the last committed group
+    u_int64_t next_sequence;    // Sequence number of the next byte
+    struct journal_record group[JOURNAL_GROUP_RECORDS]; // Records not committed yet
+    size_t group_count;
+    struct timespec group_start_time;   // When the first record of the group was appended
+
+    metric_counter group_commits;   // Counter of groups written & synced
+};
+
+// Methods & Functions
+int open_byte_journal(struct byte_journal* journal, const char* journal_file_path, int interval_ms,
+                      u_int8_t** recovered_bytes, size_t* recovered_count);
+int append_to_journal(struct byte_journal* journal, u_int8_t byte);
+int commit_journal_group(struct byte_journal* journal);
+int get_journal_commit_timeout_ms(const struct byte_journal* journal);
+int process_journal_timeout(struct byte_journal* journal);
+int close_byte_journal(struct byte_journal* journal, bool output_synced);
+
+#endif //STENOBYTE_JOURNAL_H
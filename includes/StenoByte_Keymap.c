@@ -0,0 +1,204 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Keymap.c is the source file for implementing the Keymap. The default layout is built at compile time;
+    alternative layouts can be loaded from a keymap file at startup.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Keymap.h"
+#include "StenoByte_Chord.h"
+
+#include <libevdev/libevdev.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Keymap entry for a key that sets a bit
+#define BIT_KEY(index, key_label) \
+    {.action = KEY_ACTION_BIT, .bit_index = (index), .bit_mask = 1u << (index), .label = (key_label)}
+
+// Keymap entry for a key that applies an edit
+#define EDIT_KEY(chord_edit) {.action = KEY_ACTION_EDIT, .edit = (chord_edit)}
+
+// Names of the edits in keymap files, indexed by enum chord_edit
+static const char* const edit_names[] = {
+    [CHORD_EDIT_BACKSPACE] = "backspace",
+    [CHORD_EDIT_UNDO] = "undo",
+    [CHORD_EDIT_LEFT] = "left",
+    [CHORD_EDIT_RIGHT] = "right",
+    [CHORD_EDIT_END] = "end"
+};
+
+// Arrays & Variables
+// Default Layout: 'A' = b7, 'S' = b6, ... ';' = b0, SPACE computes the byte, ESC exits
+// BACKSPACE, 'Z' (undo), LEFT, RIGHT & END commit the chord held with them as the repeat count of an edit instead
+// Wider chords add the thumbs ('N' = b8, 'V' = b9), then the top row above the index, middle & ring fingers ('U' = b10,
+// 'R' = b11, ... 'W' = b15), with the right hand's key on the lower bit of each pair
+struct keymap_entry keymap[KEYMAP_SIZE] = {
+    [KEY_A] = BIT_KEY(7, 'A'),
+    [KEY_S] = BIT_KEY(6, 'S'),
+    [KEY_D] = BIT_KEY(5, 'D'),
+    [KEY_F] = BIT_KEY(4, 'F'),
+    [KEY_J] = BIT_KEY(3, 'J'),
+    [KEY_K] = BIT_KEY(2, 'K'),
+    [KEY_L] = BIT_KEY(1, 'L'),
+    [KEY_SEMICOLON] = BIT_KEY(0, ';'),
+#if BITS_ARR_SIZE >= 10
+    [KEY_N] = BIT_KEY(8, 'N'),
+    [KEY_V] = BIT_KEY(9, 'V'),
+#endif
+#if BITS_ARR_SIZE >= 12
+    [KEY_U] = BIT_KEY(10, 'U'),
+    [KEY_R] = BIT_KEY(11, 'R'),
+#endif
+#if BITS_ARR_SIZE >= 16
+    [KEY_I] = BIT_KEY(12, 'I'),
+    [KEY_E] = BIT_KEY(13, 'E'),
+    [KEY_O] = BIT_KEY(14, 'O'),
+    [KEY_W] = BIT_KEY(15, 'W'),
+#endif
+    [KEY_SPACE] = {.action = KEY_ACTION_COMMIT},
+    [KEY_BACKSPACE] = EDIT_KEY(CHORD_EDIT_BACKSPACE),
+    [KEY_Z] = EDIT_KEY(CHORD_EDIT_UNDO),
+    [KEY_LEFT] = EDIT_KEY(CHORD_EDIT_LEFT),
+    [KEY_RIGHT] = EDIT_KEY(CHORD_EDIT_RIGHT),
+    [KEY_END] = EDIT_KEY(CHORD_EDIT_END),
+    [KEY_ESC] = {.action = KEY_ACTION_EXIT}
+};
+
+/*
+ * Parses a key given either as a libevdev name (e.g. "KEY_A") or as a numeric key code
+ *
+ * Returns the key code, or -1 if the key is not valid
+ */
+static int parse_key_code(const char* key) {
+    if (isdigit((unsigned char) key[0])) {
+        char* end;
+        const long key_code = strtol(key, &end, 10);
+        return *end == '\0' && key_code < KEYMAP_SIZE ? (int) key_code : -1;
+    }
+    return libevdev_event_code_from_name(EV_KEY, key);
+}
+
+/*
+ * Parses the name of an edit (e.g. "undo")
+ *
+ * Returns the enum chord_edit, or CHORD_EDIT_NONE if the name is not valid
+ */
+static enum chord_edit parse_edit_name(const char* name) {
+    for (int edit = CHORD_EDIT_BACKSPACE; edit <= CHORD_EDIT_END; edit++) {
+        if (strcmp(name, edit_names[edit]) == 0) {
+            return (enum chord_edit) edit;
+        }
+    }
+    return CHORD_EDIT_NONE;
+}
+
+/*
+ * Gets the label shown in the summary for a key: the character of names like "KEY_A", otherwise '?'
+ */
+static char get_default_key_label(const int key_code) {
+    if (key_code == KEY_SEMICOLON) {
+        return ';';
+    }
+    const char* name = libevdev_event_code_get_name(EV_KEY, (unsigned int) key_code);
+    if (name != nullptr && strncmp(name, "KEY_", 4) == 0 && strlen(name) == 5) {
+        return name[4];
+    }
+    return '?';
+}
+
+/*
+ * Replaces the Keymap with the layout in a keymap file. Each line of the file is one of the following, where KEY is a
+ * name such as KEY_A or a numeric key code, and LABEL is the character shown for the key in the summary:
+ *     KEY bit INDEX [LABEL]
+ *     KEY commit
+ *     KEY exit
+ *     KEY edit EDIT
+ * where EDIT is one of backspace, undo, left, right or end. Blank lines and lines starting with '#' are ignored.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int load_keymap_file(const char* keymap_file_path, const int bit_count) {
+    FILE* keymap_file = fopen(keymap_file_path, "r");
+    if (keymap_file == nullptr) {
+        perror("Failed to open keymap file");
+        return 1;
+    }
+
+    struct keymap_entry loaded_keymap[KEYMAP_SIZE] = {0};
+    unsigned int assigned_bits = 0;
+    char line[KEYMAP_LINE_SIZE];
+    int line_number = 0;
+    int result = 0;
+
+    while (result == 0 && fgets(line, sizeof(line), keymap_file) != nullptr) {
+        line_number++;
+        char key[64], action[16], label[8] = "", edit_name[16] = "";
+        int bit_index = -1;
+
+        const int fields = sscanf(line, " %63s %15s %d %7s", key, action, &bit_index, label);
+        if (fields <= 0 || key[0] == '#') {
+            continue;
+        }
+
+        const int key_code = parse_key_code(key);
+        if (key_code < 0 || fields < 2) {
+            fprintf(stderr, "%s:%d: Expected a key followed by an action\n", keymap_file_path, line_number);
+            result = 1;
+        } else if (strcmp(action, "bit") == 0 && bit_index >= 0 && bit_index < bit_count) {
+            loaded_keymap[key_code] = (struct keymap_entry) BIT_KEY(bit_index, label[0] != '\0'
+                                                                              ? label[0]
+                                                                              : get_default_key_label(key_code));
+            assigned_bits |= 1u << bit_index;
+        } else if (strcmp(action, "commit") == 0) {
+            loaded_keymap[key_code] = (struct keymap_entry) {.action = KEY_ACTION_COMMIT};
+        } else if (strcmp(action, "exit") == 0) {
+            loaded_keymap[key_code] = (struct keymap_entry) {.action = KEY_ACTION_EXIT};
+        } else if (strcmp(action, "edit") == 0 && sscanf(line, " %*s %*s %15s", edit_name) == 1 &&
+                   parse_edit_name(edit_name) != CHORD_EDIT_NONE) {
+            loaded_keymap[key_code] = (struct keymap_entry) EDIT_KEY(parse_edit_name(edit_name));
+        } else {
+            fprintf(stderr, "%s:%d: Unknown action or bit index out of range: %s\n", keymap_file_path, line_number,
+                    action);
+            result = 1;
+        }
+    }
+    fclose(keymap_file);
+
+    if (result != 0) {
+        return result;
+    }
+    if (assigned_bits != (1u << bit_count) - 1) {
+        fprintf(stderr, "Warning: %s does not assign a key to every bit\n", keymap_file_path);
+    }
+    memcpy(keymap, loaded_keymap, sizeof(keymap));
+    return 0;
+}
+
+/*
+ * Gets the labels of the keys assigned to each bit, ordered from b0 ('?' for bits without a key)
+ */
+void get_keymap_labels(char* key_labels, const int bit_count) {
+    memset(key_labels, '?', (size_t) bit_count);
+    for (int key_code = 0; key_code < KEYMAP_SIZE; key_code++) {
+        if (keymap[key_code].action == KEY_ACTION_BIT && keymap[key_code].bit_index < bit_count) {
+            key_labels[keymap[key_code].bit_index] = keymap[key_code].label;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Keymap.h is the header file for defining the Keymap, a table indexed by key code that says what each key
+    does: set a bit in the Bit Array, compute the byte, or exit.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_KEYMAP_H
+#define STENOBYTE_KEYMAP_H
+
+#include <linux/input.h>
+#include <sys/types.h>
+
+// Number of entries in the Keymap (one for every possible key code)
+#define KEYMAP_SIZE KEY_CNT
+
+// Longest line read from a keymap file
+#define KEYMAP_LINE_SIZE 256
+
+
+enum key_action {
+    KEY_ACTION_NONE = 0,    // The key is ignored
+    KEY_ACTION_BIT,         // The key sets the bit at bit_index while it is held
+    KEY_ACTION_COMMIT,      // The key computes the byte from the Bit Array
+    KEY_ACTION_EXIT,        // The key exits the app
+    KEY_ACTION_EDIT         // The key commits the Bit Array as the repeat count of an edit (with --edit)
+};
+
+struct keymap_entry {
+    u_int8_t action;    // enum key_action
+    u_int8_t bit_index; // For KEY_ACTION_BIT: the index of the bit in the Bit Array
+    u_int16_t bit_mask; // For KEY_ACTION_BIT: 1 << bit_index
+    char label;         // For KEY_ACTION_BIT: the character shown for the key in the summary
+    u_int8_t edit;      // For KEY_ACTION_EDIT: the enum chord_edit the key applies
+};
+
+// Arrays & Variables
+extern struct keymap_entry keymap[KEYMAP_SIZE];
+
+/*
+ * Gets the Keymap entry of a key code with a single indexed load (key codes outside the table are ignored)
+ */
+static inline struct keymap_entry get_keymap_entry(const unsigned int key_code) {
+    return key_code < KEYMAP_SIZE ? keymap[key_code] : (struct keymap_entry) {0};
+}
+
+// Methods & Functions
+int load_keymap_file(const char* keymap_file_path, int bit_count);
+void get_keymap_labels(char* key_labels, int bit_count);
+
+#endif //STENOBYTE_KEYMAP_H
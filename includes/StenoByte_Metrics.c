@@ -0,0 +1,361 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Metrics.c is the source file for implementing the Metrics and the Unix domain socket they are served on.
+    Each counter and histogram is only written by one thread, so updating them takes no locks; the socket is served by
+    the event loop and only reads them.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Metrics.h"
+#include "StenoByte_Session.h"
+#include "StenoByte_Time.h"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Resets every counter and starts the uptime clock
+ */
+void setup_metrics(struct stenobyte_metrics* metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+    clock_gettime(CLOCK_MONOTONIC, &metrics->start_time);
+}
+
+/*
+ * Gets the histogram bucket of a latency: the bucket's power of 2, then its sub-bucket within that power
+ */
+static size_t get_latency_bucket(const u_int64_t latency_ns) {
+    if (latency_ns < LATENCY_SUB_BUCKET_COUNT) {
+        return (size_t) latency_ns;
+    }
+    const int highest_bit = 63 - __builtin_clzll(latency_ns);
+    const int shift = highest_bit - LATENCY_SUB_BUCKET_BITS;
+    const size_t sub_bucket = (size_t) (latency_ns >> shift) & (LATENCY_SUB_BUCKET_COUNT - 1);
+    return (size_t) (shift + 1) * LATENCY_SUB_BUCKET_COUNT + sub_bucket;
+}
+
+/*
+ * Gets the highest latency that falls into a bucket
+ */
+static u_int64_t get_latency_bucket_limit(const size_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const int shift = (int) (bucket / LATENCY_SUB_BUCKET_COUNT) - 1;
+    const u_int64_t sub_bucket = bucket % LATENCY_SUB_BUCKET_COUNT;
+    return ((LATENCY_SUB_BUCKET_COUNT + sub_bucket + 1) << shift) - 1;
+}
+
+/*
+ * Records the time from an event's kernel timestamp until now. Keyboards are switched to CLOCK_MONOTONIC timestamps
+ * when they are attached, so events with timestamps from another clock (such as replayed ones) are not recorded.
+ * Must only be called by the thread that owns the histogram.
+ */
+void record_latency(struct latency_histogram* histogram, const struct timeval* event_time) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const long long latency_ns = (now.tv_sec - event_time->tv_sec) * 1000000000LL +
+                                 (now.tv_nsec - event_time->tv_usec * 1000LL);
+    if (latency_ns < 0 || latency_ns > 60 * 1000000000LL) {
+        return;
+    }
+
+    add_to_metric(&histogram->buckets[get_latency_bucket((u_int64_t) latency_ns)], 1);
+    add_to_metric(&histogram->count, 1);
+    if ((u_int64_t) latency_ns > atomic_load_explicit(&histogram->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max_ns, (u_int64_t) latency_ns, memory_order_relaxed);
+    }
+}
+
+/*
+ * Gets the latency below which the given percentage of the recorded latencies fall
+ *
+ * Returns the latency in nanoseconds, or 0 if nothing was recorded
+ */
+u_int64_t get_latency_percentile(const struct latency_histogram* histogram, const double percentile) {
+    const u_int64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+
+    const u_int64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    u_int64_t target = (u_int64_t) (percentile / 100.0 * (double) count + 0.5);
+    target = target > 0 ? target : 1;
+
+    u_int64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++) {
+        seen += atomic_load_explicit(&histogram->buckets[bucket], memory_order_relaxed);
+        if (seen >= target) {
+            const u_int64_t limit = get_latency_bucket_limit(bucket);
+            return limit < max_ns ? limit : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+/*
+ * Writes a histogram as a line of text or as a JSON object
+ *
+ * Returns the number of chars written
+ */
+static int format_latency(char* response, const size_t response_size, const char* name,
+                          const struct latency_histogram* histogram, const bool json) {
+    const char* format = json
+        ? "\"%s\": {\"count\": %llu, \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f}"
+        : "%s count=%llu p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n";
+    return snprintf(response, response_size, format, name,
+                    (unsigned long long) atomic_load_explicit(&histogram->count, memory_order_relaxed),
+                    (double) get_latency_percentile(histogram, 50.0) / 1000.0,
+                    (double) get_latency_percentile(histogram, 99.0) / 1000.0,
+                    (double) get_latency_percentile(histogram, 99.9) / 1000.0,
+                    (double) atomic_load_explicit(&histogram->max_ns, memory_order_relaxed) / 1000.0);
+}
+
+/*
+ * Prints the percentiles of the latencies measured from the kernel timestamps of key events, and their jitter (how much
+ * further the slowest 1% of events took than the median), to compare runs with and without --realtime
+ */
+void print_latency_report(const struct stenobyte_metrics* metrics) {
+    const struct {
+        const char* name;
+        const struct latency_histogram* histogram;
+    } histograms[] = {
+        {"Capture latency", &metrics->capture_latency},
+        {"Commit latency", &metrics->commit_latency}
+    };
+
+    printf("Latency from the kernel timestamps of key events (us):\n");
+    for (size_t i = 0; i < sizeof(histograms) / sizeof(histograms[0]); i++) {
+        const struct latency_histogram* histogram = histograms[i].histogram;
+        const u_int64_t p50_ns = get_latency_percentile(histogram, 50.0);
+        const u_int64_t p99_ns = get_latency_percentile(histogram, 99.0);
+        printf("%s: count %llu\tp50 %.1f\tp90 %.1f\tp99 %.1f\tp999 %.1f\tmax %.1f\tjitter (p99 - p50) %.1f\n",
+               histograms[i].name,
+               (unsigned long long) atomic_load_explicit(&histogram->count, memory_order_relaxed),
+               (double) p50_ns / 1000.0, (double) get_latency_percentile(histogram, 90.0) / 1000.0,
+               (double) p99_ns / 1000.0, (double) get_latency_percentile(histogram, 99.9) / 1000.0,
+               (double) atomic_load_explicit(&histogram->max_ns, memory_order_relaxed) / 1000.0,
+               (double) (p99_ns - p50_ns) / 1000.0);
+    }
+}
+
+/*
+ * Writes a snapshot of a session's Metrics, and the counters of its Output Engine, as "name value" lines of text or
+ * as a single JSON object
+ *
+ * Returns the number of chars written
+ */
+int format_metrics(const struct stenobyte_session* session, char* response, const size_t response_size,
+                   const bool json) {
+    const struct stenobyte_metrics* metrics = &session->metrics;
+    const struct {
+        const char* name;
+        const metric_counter* counter;
+    } counters[] = {
+        {"events_received", &metrics->events_received},
+        {"raw_reads", &metrics->raw_reads},
+        {"events_filtered", &metrics->events_filtered},
+        {"repeats_absorbed", &metrics->repeats_absorbed},
+        {"resyncs", &metrics->resyncs},
+        {"chords_committed", &metrics->chords_committed},
+        {"bytes_committed", &metrics->bytes_committed},
+        {"chords_rejected", &metrics->chords_rejected},
+        {"bounces_filtered", &metrics->bounces_filtered},
+        {"bytes_written", &session->output_engine.bytes_written},
+        {"flushes", &session->output_engine.flushes_issued},
+        {"journal_commits", &session->output_engine.journal.group_commits}
+    };
+
+    int length = snprintf(response, response_size, json ? "{\"uptime_ms\": %lld" : "uptime_ms %lld\n",
+                          milliseconds_since(&metrics->start_time));
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        length += snprintf(response + length, response_size - (size_t) length, json ? ", \"%s\": %llu" : "%s %llu\n",
+                           counters[i].name,
+                           (unsigned long long) atomic_load_explicit(counters[i].counter, memory_order_relaxed));
+    }
+
+    if (json) {
+        length += snprintf(response + length, response_size - (size_t) length, ", \"latency\": {");
+    }
+    length += format_latency(response + length, response_size - (size_t) length, "capture_latency",
+                             &metrics->capture_latency, json);
+    if (json) {
+        length += snprintf(response + length, response_size - (size_t) length, ", ");
+    }
+    length += format_latency(response + length, response_size - (size_t) length, "commit_latency",
+                             &metrics->commit_latency, json);
+    if (json) {
+        length += snprintf(response + length, response_size - (size_t) length, "}}\n");
+    }
+    return length;
+}
+
+/*
+ * Creates the metrics socket and registers it with the event loop's epoll instance. A stale socket file left by a
+ * previous session is replaced.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_metrics_server(struct metrics_server* server, const struct stenobyte_session* session,
+                         const char* socket_path, const int epoll_fd) {
+    server->session = session;
+    for (int i = 0; i < MAX_METRICS_CLIENTS; i++) {
+        server->clients[i].file_descriptor = -1;
+    }
+
+    server->address = (struct sockaddr_un) {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(server->address.sun_path)) {
+        fprintf(stderr, "Metrics socket path is too long: %s\n", socket_path);
+        return 1;
+    }
+    strcpy(server->address.sun_path, socket_path);
+
+    server->file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->file_descriptor < 0) {
+        perror("Failed to create metrics socket");
+        return 1;
+    }
+
+    unlink(socket_path);
+    if (bind(server->file_descriptor, (const struct sockaddr*) &server->address, sizeof(server->address)) < 0 ||
+        listen(server->file_descriptor, MAX_METRICS_CLIENTS) < 0) {
+        perror("Failed to listen on metrics socket");
+        close(server->file_descriptor);
+        server->file_descriptor = -1;
+        return 1;
+    }
+
+    struct epoll_event metrics_event = {.events = EPOLLIN, .data.fd = server->file_descriptor};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server->file_descriptor, &metrics_event) < 0) {
+        perror("Failed to register metrics socket with epoll");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Stops waiting on a client and closes its connection
+ */
+static void close_metrics_client(struct metrics_client* client, const int epoll_fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->file_descriptor, nullptr);
+    close(client->file_descriptor);
+    client->file_descriptor = -1;
+}
+
+/*
+ * Accepts every pending connection and waits for its request line
+ */
+static void accept_metrics_clients(struct metrics_server* server, const int epoll_fd) {
+    int client_file_descriptor;
+    while ((client_file_descriptor = accept(server->file_descriptor, nullptr, nullptr)) >= 0) {
+        fcntl(client_file_descriptor, F_SETFL, O_NONBLOCK);
+        fcntl(client_file_descriptor, F_SETFD, FD_CLOEXEC);
+
+        struct metrics_client* client = nullptr;
+        for (int i = 0; i < MAX_METRICS_CLIENTS && client == nullptr; i++) {
+            if (server->clients[i].file_descriptor < 0) {
+                client = &server->clients[i];
+            }
+        }
+
+        struct epoll_event client_event = {.events = EPOLLIN | EPOLLRDHUP, .data.fd = client_file_descriptor};
+        if (client == nullptr || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_file_descriptor, &client_event) < 0) {
+            close(client_file_descriptor);  // Too many clients at once
+            continue;
+        }
+        client->file_descriptor = client_file_descriptor;
+        client->request_length = 0;
+    }
+}
+
+/*
+ * Reads a client's request and answers it once the request line is complete (or the client has stopped sending):
+ * "json" for a JSON object, anything else for text. The connection is closed after the answer.
+ */
+static void serve_metrics_client(const struct metrics_server* server, struct metrics_client* client,
+                                 const int epoll_fd) {
+    const ssize_t received = read(client->file_descriptor, client->request + client->request_length,
+                                  sizeof(client->request) - 1 - client->request_length);
+    if (received < 0 && errno == EAGAIN) {
+        return;
+    }
+    if (received > 0) {
+        client->request_length += (size_t) received;
+    }
+    client->request[client->request_length] = '\0';
+    if (received > 0 && strchr(client->request, '\n') == nullptr &&
+        client->request_length < sizeof(client->request) - 1) {
+        return;     // Waits for the rest of the request line
+    }
+
+    char response[METRICS_RESPONSE_SIZE];
+    const bool json = strncmp(client->request, "json", 4) == 0;
+    const int length = format_metrics(server->session, response, sizeof(response), json);
+
+    // The answer fits in the socket's buffer, so a client that does not read it is simply dropped
+    if (send(client->file_descriptor, response, (size_t) length, MSG_NOSIGNAL) < 0 && errno != EPIPE) {
+        perror("Failed to answer metrics client");
+    }
+    close_metrics_client(client, epoll_fd);
+}
+
+/*
+ * Handles a file descriptor reported as ready by epoll if it belongs to the metrics socket or one of its clients
+ *
+ * Returns true if the file descriptor was handled, false if it does not belong to the Metrics
+ */
+bool handle_metrics_event(struct metrics_server* server, const int file_descriptor, const int epoll_fd) {
+    if (server->file_descriptor < 0) {
+        return false;
+    }
+    if (file_descriptor == server->file_descriptor) {
+        accept_metrics_clients(server, epoll_fd);
+        return true;
+    }
+
+    for (int i = 0; i < MAX_METRICS_CLIENTS; i++) {
+        if (server->clients[i].file_descriptor == file_descriptor) {
+            serve_metrics_client(server, &server->clients[i], epoll_fd);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Closes the metrics socket and its clients, and removes the socket file
+ */
+void end_metrics_server(struct metrics_server* server, const int epoll_fd) {
+    if (server->file_descriptor < 0) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_METRICS_CLIENTS; i++) {
+        if (server->clients[i].file_descriptor >= 0) {
+            close_metrics_client(&server->clients[i], epoll_fd);
+        }
+    }
+    close(server->file_descriptor);
+    server->file_descriptor = -1;
+    unlink(server->address.sun_path);
+}
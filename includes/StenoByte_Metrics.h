@@ -0,0 +1,106 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Metrics.h is the header file for defining the Metrics: counters and latency histograms of a running
+    session, which can be read at any time through a Unix domain socket.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_METRICS_H
+#define STENOBYTE_METRICS_H
+
+#include <linux/input.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Latency Histogram: every power of 2 of nanoseconds is split into 8 linear sub-buckets, so a percentile is reported
+// within 12.5% of the real value
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKET_COUNT (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKET_COUNT ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKET_COUNT)
+
+// Metrics Socket
+#define MAX_METRICS_CLIENTS 8
+#define METRICS_REQUEST_SIZE 16
+#define METRICS_RESPONSE_SIZE 2048
+
+/*
+ * A counter that only one thread ever adds to, so it is updated with a plain load & store rather than a locked
+ * read-modify-write. Being atomic only guarantees that the metrics socket never reads a torn value.
+ */
+typedef atomic_uint_fast64_t metric_counter;
+
+struct latency_histogram {
+    metric_counter buckets[LATENCY_BUCKET_COUNT];
+    metric_counter count;
+    metric_counter max_ns;
+};
+
+struct stenobyte_metrics {
+    struct timespec start_time;
+    metric_counter events_received;     // Events read from keyboards or a capture file
+    metric_counter raw_reads;           // read() calls that keyboards were read raw with (--raw-input)
+    metric_counter events_filtered;     // Events that were not for a key in the Keymap
+    metric_counter repeats_absorbed;    // Autorepeats of held keys, dropped as soon as they were read
+    metric_counter resyncs;             // Resynchronisations after the kernel dropped events
+    metric_counter chords_committed;    // Bytes computed from the Bit Array
+    metric_counter bytes_committed;     // Bytes handed to the Byte Sink, more than one per chord with a Dictionary
+    metric_counter chords_rejected;     // Chords released before the minimum chord window (--commit=release)
+    metric_counter bounces_filtered;    // Key changes ignored by the debounce time (--commit=release)
+    struct latency_histogram capture_latency;   // From the kernel timestamp of an event until it was read
+    struct latency_histogram commit_latency;    // From the kernel timestamp of the commit key until the byte was computed
+};
+
+// A client of the metrics socket, waiting for its request line
+struct metrics_client {
+    int file_descriptor;    // -1 when the slot is free
+    char request[METRICS_REQUEST_SIZE];
+    size_t request_length;
+};
+
+// The metrics socket of a session
+struct metrics_server {
+    int file_descriptor;    // Listening socket, -1 when the metrics are not served
+    struct sockaddr_un address;
+    struct metrics_client clients[MAX_METRICS_CLIENTS];
+    const struct stenobyte_session* session;    // The session whose Metrics are served
+};
+
+struct stenobyte_session;
+
+/*
+ * Adds to a counter. Must only be called by the thread that owns the counter.
+ */
+static inline void add_to_metric(metric_counter* counter, const u_int64_t amount) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount,
+                          memory_order_relaxed);
+}
+
+// Methods & Functions
+void setup_metrics(struct stenobyte_metrics* metrics);
+void record_latency(struct latency_histogram* histogram, const struct timeval* event_time);
+u_int64_t get_latency_percentile(const struct latency_histogram* histogram, double percentile);
+void print_latency_report(const struct stenobyte_metrics* metrics);
+int format_metrics(const struct stenobyte_session* session, char* response, size_t response_size, bool json);
+int setup_metrics_server(struct metrics_server* server, const struct stenobyte_session* session,
+                         const char* socket_path, int epoll_fd);
+bool handle_metrics_event(struct metrics_server* server, int file_descriptor, int epoll_fd);
+void end_metrics_server(struct metrics_server* server, int epoll_fd);
+
+#endif //STENOBYTE_METRICS_H
@@ -0,0 +1,283 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Options.c is the source file for implementing the parsing of the command line options shared by the
+    StenoByte apps.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Options.h"
+#include "StenoByte_Realtime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Arrays & Variables
+const struct stenobyte_options default_stenobyte_options = {
+    .output_file_path = "./output.txt",
+    .output_mode = OUTPUT_MODE_WRITE,
+    .output_encoding = ENCODING_RAW,
+    .edit = false,
+    .flush_policy = FLUSH_ON_INTERVAL,
+    .flush_interval_ms = DEFAULT_FLUSH_INTERVAL_MS,
+    .durability = DURABILITY_NONE,
+    .journal_file_path = nullptr,
+    .journal_interval_ms = DEFAULT_JOURNAL_INTERVAL_MS,
+    .sink_count = 0,
+    .sink_buffer_size = DEFAULT_SINK_BUFFER_SIZE,
+    .replay_file_path = nullptr,
+    .record_file_path = nullptr,
+    .device_path = nullptr,
+    .grab = false,
+    .raw_input = false,
+    .keymap_file_path = nullptr,
+    .headless = false,
+    .pipeline = false,
+    .metrics_socket_path = nullptr,
+    .commit_mode = COMMIT_ON_KEY,
+    .chord_window_ms = DEFAULT_CHORD_WINDOW_MS,
+    .debounce_ms = DEFAULT_DEBOUNCE_MS,
+    .dictionary_file_path = nullptr,
+    .dictionary_timeout_ms = DEFAULT_DICTIONARY_TIMEOUT_MS,
+    .byte_order = CHORD_LITTLE_ENDIAN,
+    .realtime_priority = 0,
+    .realtime_cpu = -1,
+    .latency_report = false
+};
+
+/*
+ * Returns the value of an option in the form "--name=value" if argument matches the name, nullptr otherwise
+ */
+static const char* get_option_value(const char* argument, const char* name) {
+    const size_t name_length = strlen(name);
+    if (strncmp(argument, name, name_length) != 0 || argument[name_length] != '=') {
+        return nullptr;
+    }
+    return argument + name_length + 1;
+}
+
+/*
+ * Parses the command line arguments into options, starting from default_stenobyte_options
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int parse_stenobyte_options(struct stenobyte_options* options, const int argc, const char* argv[]) {
+    *options = default_stenobyte_options;
+    for (int i = 1; i < argc; i++) {
+        const char* argument = argv[i];
+        const char* value;
+
+        if (strncmp(argument, "--", 2) != 0) {
+            // File Path Provided by Command Line Arguments
+            options->output_file_path = argument;
+        } else if (strcmp(argument, "--mmap") == 0) {
+            options->output_mode = OUTPUT_MODE_MMAP;
+        } else if ((value = get_option_value(argument, "--encode"))) {
+            if (parse_byte_encoding(value, &options->output_encoding) != 0) {
+                fprintf(stderr, "Unknown encoding: %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(argument, "--edit") == 0) {
+            options->edit = true;
+        } else if ((value = get_option_value(argument, "--flush"))) {
+            if (strcmp(value, "size") == 0) {
+                options->flush_policy = FLUSH_ON_SIZE;
+            } else if (strcmp(value, "interval") == 0) {
+                options->flush_policy = FLUSH_ON_INTERVAL;
+            } else if (strcmp(value, "byte") == 0) {
+                options->flush_policy = FLUSH_EVERY_BYTE;
+            } else {
+                fprintf(stderr, "Unknown flush policy: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--flush-interval"))) {
+            options->flush_interval_ms = atoi(value);
+            if (options->flush_interval_ms <= 0) {
+                fprintf(stderr, "Flush interval must be a positive number of milliseconds: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--sync"))) {
+            if (strcmp(value, "none") == 0) {
+                options->durability = DURABILITY_NONE;
+            } else if (strcmp(value, "batch") == 0) {
+                options->durability = DURABILITY_SYNC_BATCH;
+            } else if (strcmp(value, "byte") == 0) {
+                options->durability = DURABILITY_SYNC_BYTE;
+            } else {
+                fprintf(stderr, "Unknown sync mode: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--journal"))) {
+            options->journal_file_path = value;
+        } else if ((value = get_option_value(argument, "--journal-interval"))) {
+            options->journal_interval_ms = atoi(value);
+            if (options->journal_interval_ms <= 0) {
+                fprintf(stderr, "Journal interval must be a positive number of milliseconds: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--sink"))) {
+            if (options->sink_count == MAX_FANOUT_SINKS) {
+                fprintf(stderr, "At most %d sinks can be given\n", MAX_FANOUT_SINKS);
+                return 1;
+            }
+            if (parse_sink_spec(&options->sinks[options->sink_count], value) != 0) {
+                fprintf(stderr, "Unknown sink: %s\n", value);
+                return 1;
+            }
+            options->sink_count++;
+        } else if ((value = get_option_value(argument, "--sink-buffer"))) {
+            const long long buffer_size = atoll(value);
+            if (buffer_size <= 0) {
+                fprintf(stderr, "Sink buffer must be a positive number of bytes: %s\n", value);
+                return 1;
+            }
+            options->sink_buffer_size = (size_t) buffer_size;
+        } else if ((value = get_option_value(argument, "--replay"))) {
+            options->replay_file_path = value;
+        } else if ((value = get_option_value(argument, "--record"))) {
+            options->record_file_path = value;
+        } else if ((value = get_option_value(argument, "--device"))) {
+            options->device_path = value;
+        } else if (strcmp(argument, "--grab") == 0) {
+            options->grab = true;
+        } else if (strcmp(argument, "--raw-input") == 0) {
+            options->raw_input = true;
+        } else if ((value = get_option_value(argument, "--keymap"))) {
+            options->keymap_file_path = value;
+        } else if (strcmp(argument, "--headless") == 0) {
+            options->headless = true;
+        } else if (strcmp(argument, "--pipeline") == 0) {
+            options->pipeline = true;
+        } else if ((value = get_option_value(argument, "--metrics"))) {
+            options->metrics_socket_path = value;
+        } else if ((value = get_option_value(argument, "--commit"))) {
+            if (strcmp(value, "key") == 0) {
+                options->commit_mode = COMMIT_ON_KEY;
+            } else if (strcmp(value, "release") == 0) {
+                options->commit_mode = COMMIT_ON_RELEASE;
+            } else {
+                fprintf(stderr, "Unknown commit mode: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--chord-window"))) {
+            options->chord_window_ms = atoi(value);
+            if (options->chord_window_ms < 0) {
+                fprintf(stderr, "Chord window must be a number of milliseconds: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--dictionary"))) {
+            options->dictionary_file_path = value;
+        } else if ((value = get_option_value(argument, "--dictionary-timeout"))) {
+            options->dictionary_timeout_ms = atoi(value);
+            if (options->dictionary_timeout_ms <= 0) {
+                fprintf(stderr, "Dictionary timeout must be a positive number of milliseconds: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--debounce"))) {
+            options->debounce_ms = atoi(value);
+            if (options->debounce_ms < 0) {
+                fprintf(stderr, "Debounce time must be a number of milliseconds: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--byte-order"))) {
+            if (strcmp(value, "little") == 0) {
+                options->byte_order = CHORD_LITTLE_ENDIAN;
+            } else if (strcmp(value, "big") == 0) {
+                options->byte_order = CHORD_BIG_ENDIAN;
+            } else {
+                fprintf(stderr, "Unknown byte order: %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(argument, "--realtime") == 0) {
+            options->realtime_priority = DEFAULT_REALTIME_PRIORITY;
+        } else if ((value = get_option_value(argument, "--realtime"))) {
+            options->realtime_priority = atoi(value);
+            if (options->realtime_priority < 1 || options->realtime_priority > 99) {
+                fprintf(stderr, "Real-time priority must be between 1 and 99: %s\n", value);
+                return 1;
+            }
+        } else if ((value = get_option_value(argument, "--cpu"))) {
+            char* end;
+            options->realtime_cpu = (int) strtol(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || options->realtime_cpu < 0) {
+                fprintf(stderr, "CPU must be a CPU number: %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(argument, "--latency-report") == 0) {
+            options->latency_report = true;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argument);
+            print_stenobyte_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Edits change bytes already written, which a mapped, encoded or journaled output file cannot take back
+    if (options->edit && (options->output_mode == OUTPUT_MODE_MMAP || options->output_encoding != ENCODING_RAW ||
+                          options->journal_file_path != nullptr)) {
+        fprintf(stderr, "--edit cannot be combined with --mmap, --encode or --journal\n");
+        return 1;
+    }
+
+    // Only the real-time setup pins the event loop, so a CPU on its own would be ignored
+    if (options->realtime_cpu >= 0 && options->realtime_priority == 0) {
+        fprintf(stderr, "--cpu can only be used with --realtime\n");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Prints the command line usage
+ */
+void print_stenobyte_usage(const char* program_name) {
+    printf("Usage: %s [OUTPUT_FILE] [OPTIONS]\n"
+           "  --mmap                      Store bytes into a preallocated, memory-mapped output file\n"
+           "  --encode=FORMAT             Write the output file as hex, hexdump, base64 or c (a C array)\n"
+           "  --edit                      Keep the output in memory so that the edit keys can delete, undo & move\n"
+           "  --flush=size|interval|byte  When buffered bytes are written to the file (default: interval)\n"
+           "  --flush-interval=MS         Longest time a byte waits before being written (default: %d)\n"
+           "  --sync=none|batch|byte      fdatasync() never, after every write, or after every byte (default: none)\n"
+           "  --journal=FILE              Record every byte in a journal file to rebuild the output after a crash\n"
+           "  --journal-interval=MS       Longest time a byte waits before it is synced to the journal (default: %d)\n"
+           "  --sink=KIND[:PATH][,POLICY][,ENCODING]\n"
+           "                              Also send every byte to file:PATH, stdout, fifo:PATH or socket:PATH, up to\n"
+           "                              %d times. POLICY when a consumer falls behind: drop, block or disconnect.\n"
+           "                              ENCODING as for --encode\n"
+           "  --sink-buffer=BYTES         How far each consumer of a sink may fall behind (default: %d)\n"
+           "  --replay=FILE               Read key events from a capture file (\"-\" for stdin) instead of a keyboard\n"
+           "  --record=FILE               Record the key events of the session to a capture file\n"
+           "  --device=PATH               Read only this keyboard instead of every keyboard that is found\n"
+           "  --grab                      Stop the key events of the keyboards from reaching other apps\n"
+           "  --raw-input                 Read each keyboard's pending events with one read() instead of via libevdev\n"
+           "  --keymap=FILE               Load the layout of the keys from a keymap file\n"
+           "  --headless                  Do not draw the Bit Array Summary\n"
+           "  --pipeline                  Read the keyboards on their own thread, apart from drawing and writing\n"
+           "  --metrics=PATH              Serve counters & latencies on a Unix socket (send \"json\" for JSON)\n"
+           "  --commit=key|release        Commit on the commit key, or on releasing a chord's last key (default: key)\n"
+           "  --chord-window=MS           With --commit=release, reject chords released sooner (default: %d)\n"
+           "  --debounce=MS               With --commit=release, ignore a key changing again sooner (default: %d)\n"
+           "  --dictionary=FILE           Write out chords & chord sequences as the strings of a dictionary file\n"
+           "  --dictionary-timeout=MS     Longest time a stroke waits for the next one of an entry (default: %d)\n"
+           "  --byte-order=little|big     Order of the bytes each %d-bit chord is written out in (default: little)\n"
+           "  --realtime[=PRIORITY]       Run the event loop under SCHED_FIFO with memory locked (default: %d)\n"
+           "  --cpu=N                     With --realtime, pin the event loop to CPU N\n"
+           "  --latency-report            Print the percentiles of the key event latencies on exit\n",
+           program_name, DEFAULT_FLUSH_INTERVAL_MS, DEFAULT_JOURNAL_INTERVAL_MS, MAX_FANOUT_SINKS,
+           DEFAULT_SINK_BUFFER_SIZE, DEFAULT_CHORD_WINDOW_MS, DEFAULT_DEBOUNCE_MS, DEFAULT_DICTIONARY_TIMEOUT_MS,
+           BITS_ARR_SIZE, DEFAULT_REALTIME_PRIORITY);
+}
@@ -0,0 +1,70 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Options.h is the header file for defining the command line options shared by the StenoByte apps.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_OPTIONS_H
+#define STENOBYTE_OPTIONS_H
+
+#include "StenoByte_Chord.h"
+#include "StenoByte_Dictionary.h"
+#include "StenoByte_Output.h"
+
+#include <stdbool.h>
+
+struct stenobyte_options {
+    const char* output_file_path;   // First positional argument, "./output.txt" by default
+    enum output_mode output_mode;   // --mmap stores bytes into a memory-mapped output file instead of writing them
+    enum byte_encoding output_encoding; // --encode=hex|hexdump|base64|c writes the output file encoded
+    bool edit;  // --edit keeps the output in memory so that the edit keys can change it
+    enum output_flush_policy flush_policy;  // --flush=size|interval|byte
+    int flush_interval_ms;  // --flush-interval=MS
+    enum output_durability durability;  // --sync=none|batch|byte
+    const char* journal_file_path;  // --journal=FILE records every byte in a journal file to recover it after a crash
+    int journal_interval_ms;    // --journal-interval=MS
+    struct sink_spec sinks[MAX_FANOUT_SINKS];   // --sink=KIND[:PATH][,POLICY][,ENCODING] also feeds a sink
+    int sink_count;
+    size_t sink_buffer_size;    // --sink-buffer=BYTES
+    const char* replay_file_path;   // --replay=FILE reads key events from a capture file instead of a keyboard
+    const char* record_file_path;   // --record=FILE records the key events of the session to a capture file
+    const char* device_path;    // --device=PATH reads only this keyboard instead of every keyboard found
+    bool grab;  // --grab stops the key events of the keyboards from reaching other apps while StenoByte runs
+    bool raw_input; // --raw-input reads the keyboards in batches with read() instead of one event at a time via libevdev
+    const char* keymap_file_path;   // --keymap=FILE loads an alternative layout instead of the default one
+    bool headless;  // --headless does not draw the Bit Array Summary
+    bool pipeline;  // --pipeline runs capture, commit, rendering and output on separate threads
+    const char* metrics_socket_path;    // --metrics=PATH serves the Metrics on a Unix domain socket
+    enum chord_commit_mode commit_mode; // --commit=key|release
+    int chord_window_ms;    // --chord-window=MS rejects chords released sooner after their first press
+    int debounce_ms;    // --debounce=MS ignores a key changing state again sooner than this
+    const char* dictionary_file_path;   // --dictionary=FILE writes strokes out through a Dictionary
+    int dictionary_timeout_ms;  // --dictionary-timeout=MS
+    enum chord_byte_order byte_order;   // --byte-order=little|big for chords wider than 8 bits
+    int realtime_priority;  // --realtime[=PRIORITY] runs the event loop at this SCHED_FIFO priority, 0 when off
+    int realtime_cpu;   // --cpu=N pins the event loop to a CPU in real-time mode, -1 to leave it unpinned
+    bool latency_report;    // --latency-report prints the percentiles of the key event latencies on exit
+};
+
+// Arrays & Variables
+extern const struct stenobyte_options default_stenobyte_options;
+
+// Methods & Functions
+int parse_stenobyte_options(struct stenobyte_options* options, int argc, const char* argv[]);
+void print_stenobyte_usage(const char* program_name);
+
+#endif //STENOBYTE_OPTIONS_H
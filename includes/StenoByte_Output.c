@@ -0,0 +1,529 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Output.c is the source file for implementing the Output Engine, which buffers committed bytes in a
+    fixed-size ring and flushes them to the output file in batches with writev(), or stores them straight into
+    preallocated, memory-mapped chunks of the output file, records them in the Journal if one is kept, and queues them
+    for the Fan-out if there are sinks.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Output.h"
+#include "StenoByte_Time.h"
+
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Opens (or creates and truncates) the output file and prepares an empty ring. In OUTPUT_MODE_MMAP the first chunk
+ * is only mapped when the first byte is stored.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_output_engine(struct output_engine* engine, const char* file_path, const enum output_mode output_mode,
+                        const enum output_flush_policy flush_policy, const enum output_durability durability,
+                        const int flush_interval_ms) {
+    // A shared mapping of the file can only be written to if the file is also open for reading
+    const int access_mode = output_mode == OUTPUT_MODE_MMAP ? O_RDWR : O_WRONLY;
+    engine->file_descriptor = open(file_path, access_mode | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (engine->file_descriptor < 0) {
+        perror("Failed to open output file");
+        return 1;
+    }
+
+    engine->mode = output_mode;
+    engine->mapping = nullptr;
+    engine->mapping_offset = 0;
+    engine->mapping_position = 0;
+    engine->synced_position = 0;
+    engine->flush_policy = flush_policy;
+    engine->durability = durability;
+    engine->flush_interval_ms = flush_interval_ms > 0 ? flush_interval_ms : DEFAULT_FLUSH_INTERVAL_MS;
+    engine->ring_head = 0;
+    engine->ring_count = 0;
+    engine->journal.file_descriptor = -1;
+    engine->journal_failed = false;
+    engine->fanout = (struct byte_fanout) {.epoll_file_descriptor = -1};
+    setup_byte_encoder(&engine->encoder, ENCODING_RAW);
+    engine->editor = (struct output_editor) {.text = nullptr};
+    atomic_init(&engine->bytes_written, 0);
+    atomic_init(&engine->flushes_issued, 0);
+    return 0;
+}
+
+/*
+ * Syncs the bytes of the mapped chunk that have been stored since the last sync, from the start of their first page
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int sync_output_mapping(struct output_engine* engine) {
+    const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t sync_start = engine->synced_position / page_size * page_size;
+
+    if (msync(engine->mapping + sync_start, engine->mapping_position - sync_start, MS_SYNC) != 0) {
+        perror("Failed to sync output file");
+        return 1;
+    }
+    engine->synced_position = engine->mapping_position;
+    return 0;
+}
+
+/*
+ * Unmaps the current chunk (syncing it first if required), then preallocates the next chunk of the file and maps it
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int map_next_output_chunk(struct output_engine* engine) {
+    if (engine->mapping != nullptr) {
+        if (flush_output_engine(engine) != 0) {
+            return 1;
+        }
+        munmap(engine->mapping, OUTPUT_MAPPING_CHUNK_SIZE);
+        engine->mapping = nullptr;
+        engine->mapping_offset += OUTPUT_MAPPING_CHUNK_SIZE;
+    }
+
+    // Reserves the blocks up front so that storing a byte can never fail for lack of disk space (SIGBUS)
+    const int error = posix_fallocate(engine->file_descriptor, engine->mapping_offset, OUTPUT_MAPPING_CHUNK_SIZE);
+    if (error != 0) {
+        errno = error;
+        perror("Failed to preallocate output file");
+        return 1;
+    }
+
+    void* mapping = mmap(nullptr, OUTPUT_MAPPING_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         engine->file_descriptor, engine->mapping_offset);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map output file");
+        return 1;
+    }
+    madvise(mapping, OUTPUT_MAPPING_CHUNK_SIZE, MADV_SEQUENTIAL);
+
+    engine->mapping = mapping;
+    engine->mapping_position = 0;
+    engine->synced_position = 0;
+    return 0;
+}
+
+/*
+ * Stores a byte at the end of the mapped chunk, mapping the next chunk first when the current one is full
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int store_byte_in_mapping(struct output_engine* engine, const u_int8_t byte) {
+    if ((engine->mapping == nullptr || engine->mapping_position == OUTPUT_MAPPING_CHUNK_SIZE) &&
+        map_next_output_chunk(engine) != 0) {
+        return 1;
+    }
+
+    engine->mapping[engine->mapping_position++] = byte;
+    add_to_metric(&engine->bytes_written, 1);
+    return 0;
+}
+
+/*
+ * Flushes the pending bytes if the flush policy or the durability says that they are due
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int apply_flush_policy(struct output_engine* engine) {
+    if (engine->ring_count == 0) {
+        return 0;
+    }
+
+    if (engine->flush_policy == FLUSH_EVERY_BYTE || engine->durability == DURABILITY_SYNC_BYTE) {
+        return flush_output_engine(engine);
+    }
+    if (engine->flush_policy == FLUSH_ON_INTERVAL &&
+        milliseconds_since(&engine->oldest_pending_time) >= engine->flush_interval_ms) {
+        return flush_output_engine(engine);
+    }
+    return 0;
+}
+
+/*
+ * Adds bytes to the ring, flushing whenever it is full, then flushes according to the flush policy and durability
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int push_bytes_to_ring(struct output_engine* engine, const u_int8_t* bytes, const size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        // Makes room if the ring is full
+        if (engine->ring_count == OUTPUT_RING_SIZE && flush_output_engine(engine) != 0) {
+            return 1;
+        }
+
+        if (engine->mode == OUTPUT_MODE_MMAP) {
+            if (store_byte_in_mapping(engine, bytes[i]) != 0) {
+                return 1;
+            }
+            // The byte is already in the page cache, so it only stays pending if it has to be synced
+            if (engine->durability == DURABILITY_NONE) {
+                continue;
+            }
+        }
+
+        if (engine->ring_count == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &engine->oldest_pending_time);
+        }
+        if (engine->mode == OUTPUT_MODE_WRITE) {
+            engine->ring[(engine->ring_head + engine->ring_count) % OUTPUT_RING_SIZE] = bytes[i];
+        }
+        engine->ring_count++;
+    }
+    return apply_flush_policy(engine);
+}
+
+/*
+ * Counts the bytes of the Editor that differ from the file as pending after a change, flushing them once there are
+ * OUTPUT_RING_SIZE of them (as when the ring is full) or when the flush policy says that they are due
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int update_editor_pending(struct output_engine* engine) {
+    const size_t pending_count = get_editor_pending_count(&engine->editor);
+    if (engine->ring_count == 0 && pending_count > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &engine->oldest_pending_time);
+    }
+    engine->ring_count = pending_count;
+    if (engine->ring_count >= OUTPUT_RING_SIZE) {
+        return flush_output_engine(engine);
+    }
+    return apply_flush_policy(engine);
+}
+
+/*
+ * Adds a committed byte to the ring, encoded first if the output file has an encoding. All of the chars one byte
+ * encodes to are flushed together.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int push_byte_to_ring(struct output_engine* engine, const u_int8_t byte) {
+    if (engine->encoder.encoding == ENCODING_RAW) {
+        return push_bytes_to_ring(engine, &byte, 1);
+    }
+    char encoded[ENCODER_TAIL_SIZE];
+    const size_t length = encode_bytes(&engine->encoder, &byte, 1, encoded);
+    return push_bytes_to_ring(engine, (const u_int8_t*) encoded, length);
+}
+
+/*
+ * Writes the output file in an encoding instead of as the bytes themselves. Must be called before any byte is pushed.
+ */
+void attach_output_encoder(struct output_engine* engine, const enum byte_encoding encoding) {
+    setup_byte_encoder(&engine->encoder, encoding);
+}
+
+/*
+ * Keeps the output in an Editor, so that it can be changed with apply_output_edit(), instead of the ring. Only the part
+ * of the file from the first byte that changed is written when it is flushed. Must be called before any byte is
+ * pushed, and not in OUTPUT_MODE_MMAP, with an encoding or with a Journal.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int attach_output_editor(struct output_engine* engine) {
+    return setup_output_editor(&engine->editor);
+}
+
+/*
+ * Starts keeping a Journal of the bytes pushed to the engine, in group commits of their own that are independent of
+ * the flush policy. If the Journal still holds the bytes of a session that did not end cleanly, they are pushed to the
+ * (just truncated) output file first, so that the output file is rebuilt and the new session carries on after them.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int attach_output_journal(struct output_engine* engine, const char* journal_file_path, const int interval_ms) {
+    u_int8_t* recovered_bytes;
+    size_t recovered_count;
+    if (open_byte_journal(&engine->journal, journal_file_path, interval_ms, &recovered_bytes, &recovered_count) != 0) {
+        return 1;
+    }
+
+    // The recovered bytes are already in the Journal, so they go straight to the ring
+    int result = 0;
+    for (size_t i = 0; i < recovered_count && result == 0; i++) {
+        result = push_byte_to_ring(engine, recovered_bytes[i]);
+    }
+    free(recovered_bytes);
+    if (result == 0 && recovered_count > 0) {
+        result = flush_output_engine(engine);
+        printf("Recovered %zu bytes from journal file: %s\n", recovered_count, journal_file_path);
+    }
+    return result;
+}
+
+/*
+ * Starts delivering the bytes pushed to the engine to extra sinks as well as the output file. The Fan-out is woken once
+ * per batch, from process_output_timeout(), so it never waits for the flush policy.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int attach_output_fanout(struct output_engine* engine, const struct sink_spec* specs, const int spec_count,
+                         const size_t buffer_size) {
+    return setup_byte_fanout(&engine->fanout, specs, spec_count, buffer_size);
+}
+
+/*
+ * Records a byte in the Journal, if one is kept, and queues it for the Fan-out, if there are sinks, then adds it to
+ * the ring (or inserts it at the Editor's cursor). Once the Journal could not record a byte, every later byte is
+ * refused too, as the Journal could no longer recover them in order.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int push_byte_to_output(struct output_engine* engine, const u_int8_t byte) {
+    if (engine->journal_failed) {
+        return 1;
+    }
+    if (engine->journal.file_descriptor >= 0 && append_to_journal(&engine->journal, byte) != 0) {
+        fprintf(stderr, "The journal could not record a byte, so no more bytes are written\n");
+        engine->journal_failed = true;
+        return 1;
+    }
+    if (engine->fanout.started) {
+        push_byte_to_fanout(&engine->fanout, byte);
+    }
+    if (engine->editor.text != nullptr) {
+        return insert_into_editor(&engine->editor, &byte, 1) != 0 ? 1 : update_editor_pending(engine);
+    }
+    return push_byte_to_ring(engine, byte);
+}
+
+/*
+ * Applies an edit to the Editor count times: deletes the bytes before the cursor, undoes the last strokes & edits, or
+ * moves the cursor. CHORD_EDIT_NONE starts a new stroke, so that its bytes are undone on their own. The sinks only
+ * ever receive the committed bytes, as the edits cannot be taken back from them.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int apply_output_edit(struct output_engine* engine, const enum chord_edit edit, const unsigned int count) {
+    struct output_editor* editor = &engine->editor;
+    if (editor->text == nullptr) {
+        return 0;
+    }
+
+    int result = 0;
+    switch (edit) {
+        case CHORD_EDIT_NONE:
+            mark_editor_step(editor);
+            return 0;
+        case CHORD_EDIT_BACKSPACE:
+            result = delete_before_cursor(editor, count);
+            break;
+        case CHORD_EDIT_UNDO:
+            result = undo_editor_changes(editor, count);
+            break;
+        case CHORD_EDIT_LEFT:
+            move_editor_cursor(editor, editor->gap_start > count ? editor->gap_start - count : 0);
+            mark_editor_step(editor);
+            break;
+        case CHORD_EDIT_RIGHT:
+            move_editor_cursor(editor, editor->gap_start + count);
+            mark_editor_step(editor);
+            break;
+        case CHORD_EDIT_END:
+            move_editor_cursor(editor, get_editor_length(editor));
+            mark_editor_step(editor);
+            break;
+    }
+    editor->edits_applied++;
+    return result != 0 ? 1 : update_editor_pending(engine);
+}
+
+/*
+ * Writes every pending byte to the file with a single writev() call (two buffers when the ring has wrapped),
+ * retrying on partial writes, then syncs the data if the durability requires it.
+ * In OUTPUT_MODE_MMAP the bytes are already in the file's pages, so only the sync is needed.
+ * With an Editor, the bytes from the first one that changed are written over the file instead.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int flush_output_engine(struct output_engine* engine) {
+    if (engine->ring_count == 0) {
+        return 0;
+    }
+
+    if (engine->mode == OUTPUT_MODE_MMAP) {
+        engine->ring_count = 0;
+        add_to_metric(&engine->flushes_issued, 1);
+        return sync_output_mapping(engine);
+    }
+
+    if (engine->editor.text != nullptr) {
+        u_int64_t bytes_written = 0;
+        const int result = flush_output_editor(&engine->editor, engine->file_descriptor, &bytes_written);
+        add_to_metric(&engine->bytes_written, bytes_written);
+        if (result != 0) {
+            return 1;
+        }
+        engine->ring_count = 0;
+        add_to_metric(&engine->flushes_issued, 1);
+        if (engine->durability != DURABILITY_NONE && fdatasync(engine->file_descriptor) != 0) {
+            perror("Failed to sync output file");
+            return 1;
+        }
+        return 0;
+    }
+
+    while (engine->ring_count > 0) {
+        const size_t first_length = engine->ring_head + engine->ring_count <= OUTPUT_RING_SIZE
+                                        ? engine->ring_count
+                                        : OUTPUT_RING_SIZE - engine->ring_head;
+        const struct iovec buffers[2] = {
+            {.iov_base = engine->ring + engine->ring_head, .iov_len = first_length},
+            {.iov_base = engine->ring, .iov_len = engine->ring_count - first_length}
+        };
+
+        const ssize_t written = writev(engine->file_descriptor, buffers, buffers[1].iov_len > 0 ? 2 : 1);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write to output file");
+            return 1;
+        }
+
+        engine->ring_head = (engine->ring_head + (size_t) written) % OUTPUT_RING_SIZE;
+        engine->ring_count -= (size_t) written;
+        add_to_metric(&engine->bytes_written, (u_int64_t) written);
+    }
+    engine->ring_head = 0;
+    add_to_metric(&engine->flushes_issued, 1);
+
+    if (engine->durability != DURABILITY_NONE && fdatasync(engine->file_descriptor) != 0) {
+        perror("Failed to sync output file");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Gets how long the pending bytes may wait before they are due to be flushed
+ *
+ * Returns the timeout in milliseconds, or -1 if no flush is due
+ */
+static int get_ring_flush_timeout_ms(const struct output_engine* engine) {
+    if (engine->flush_policy != FLUSH_ON_INTERVAL || engine->ring_count == 0) {
+        return -1;
+    }
+
+    const long long remaining_ms = engine->flush_interval_ms - milliseconds_since(&engine->oldest_pending_time);
+    return remaining_ms > 0 ? (int) remaining_ms : 0;
+}
+
+/*
+ * Gets how long the event loop may sleep before the pending bytes are due to be flushed, or the Journal's current
+ * group is due to be committed
+ *
+ * Returns the timeout in milliseconds, or -1 if neither is due
+ */
+int get_output_flush_timeout_ms(const struct output_engine* engine) {
+    const int flush_timeout_ms = get_ring_flush_timeout_ms(engine);
+    const int commit_timeout_ms = get_journal_commit_timeout_ms(&engine->journal);
+    if (commit_timeout_ms >= 0 && (flush_timeout_ms < 0 || commit_timeout_ms < flush_timeout_ms)) {
+        return commit_timeout_ms;
+    }
+    return flush_timeout_ms;
+}
+
+/*
+ * Wakes the Fan-out for the bytes pushed since the last call, commits the Journal's current group and flushes the
+ * pending bytes if they have waited long enough. Called by the event loop after every wake-up.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int process_output_timeout(struct output_engine* engine) {
+    wake_byte_fanout(&engine->fanout);
+    if (process_journal_timeout(&engine->journal) != 0) {
+        return 1;
+    }
+    if (get_ring_flush_timeout_ms(engine) != 0) {
+        return 0;
+    }
+    return flush_output_engine(engine);
+}
+
+/*
+ * Prints the counters of the Output Engine
+ */
+void print_output_counters(const struct output_engine* engine) {
+    printf("Bytes written: %llu\nFlushes issued: %llu\n",
+           (unsigned long long) engine->bytes_written, (unsigned long long) engine->flushes_issued);
+    if (engine->journal.group_commits > 0) {
+        printf("Journal groups committed: %llu\n", (unsigned long long) engine->journal.group_commits);
+    }
+    if (engine->editor.edits_applied > 0) {
+        printf("Edits applied: %llu\n", (unsigned long long) engine->editor.edits_applied);
+    }
+    print_fanout_counters(&engine->fanout);
+}
+
+/*
+ * Finishes the encoding of the output file, if it has one, flushes any pending bytes, syncs them if required and
+ * closes the file.
+ * In OUTPUT_MODE_MMAP the preallocated space after the last byte is cut off first.
+ * With an Editor, its buffer & undo history are freed once the file holds what it does.
+ * With a Journal, the file is always synced, so that the Journal can be emptied.
+ * With sinks, the Fan-out is given up to FANOUT_LINGER_MS to deliver the bytes it still holds.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int end_output_engine(struct output_engine* engine) {
+    if (engine->file_descriptor < 0) {
+        return 0;
+    }
+
+    end_byte_fanout(&engine->fanout);
+
+    int result = 0;
+    if (engine->encoder.encoding != ENCODING_RAW) {
+        char tail[ENCODER_TAIL_SIZE];
+        const size_t length = finish_byte_encoder(&engine->encoder, tail);
+        result = push_bytes_to_ring(engine, (const u_int8_t*) tail, length);
+    }
+    if (flush_output_engine(engine) != 0) {
+        result = 1;
+    }
+    if (engine->editor.text != nullptr) {
+        end_output_editor(&engine->editor);
+    }
+    if (engine->mode == OUTPUT_MODE_MMAP && engine->mapping != nullptr) {
+        munmap(engine->mapping, OUTPUT_MAPPING_CHUNK_SIZE);
+        engine->mapping = nullptr;
+        if (ftruncate(engine->file_descriptor, engine->mapping_offset + (off_t) engine->mapping_position) != 0) {
+            perror("Failed to truncate output file");
+            result = 1;
+        } else if (engine->durability != DURABILITY_NONE && fdatasync(engine->file_descriptor) != 0) {
+            perror("Failed to sync output file");
+            result = 1;
+        }
+    }
+    if (engine->journal.file_descriptor >= 0) {
+        const bool output_synced = result == 0 && fdatasync(engine->file_descriptor) == 0;
+        if (close_byte_journal(&engine->journal, output_synced) != 0) {
+            result = 1;
+        }
+    }
+    if (close(engine->file_descriptor) != 0) {
+        perror("Failed to close output file");
+        result = 1;
+    }
+    engine->file_descriptor = -1;
+    return result;
+}
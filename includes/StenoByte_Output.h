@@ -0,0 +1,128 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Output.h is the header file for defining the Output Engine, which buffers committed bytes in a fixed-size
+    ring and flushes them to the output file in batches, or stores them straight into a memory-mapped output file,
+    optionally keeping a Journal of them and handing them to the Fan-out.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_OUTPUT_H
+#define STENOBYTE_OUTPUT_H
+
+#include "StenoByte_Chord.h"
+#include "StenoByte_Editor.h"
+#include "StenoByte_Encoder.h"
+#include "StenoByte_Fanout.h"
+#include "StenoByte_Journal.h"
+#include "StenoByte_Metrics.h"
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Number of bytes the ring can hold before it must be flushed
+#define OUTPUT_RING_SIZE 4096
+
+// Default time a byte may wait in the ring when flushing on an interval
+#define DEFAULT_FLUSH_INTERVAL_MS 1000
+
+// Size of each chunk of the output file that is preallocated & mapped at once in OUTPUT_MODE_MMAP (a multiple of the
+// page size)
+#define OUTPUT_MAPPING_CHUNK_SIZE (1 << 20)
+
+// How committed bytes reach the output file
+enum output_mode {
+    OUTPUT_MODE_WRITE = 0,  // Buffered in the ring and written with writev()
+    OUTPUT_MODE_MMAP        // Stored into a preallocated, memory-mapped chunk of the file; written back by the kernel
+};
+
+// When the ring is written out to the file (in OUTPUT_MODE_MMAP: when the stored bytes are synced, if they need to be)
+enum output_flush_policy {
+    FLUSH_ON_SIZE = 0,  // Only when the ring is full (and when the engine ends)
+    FLUSH_ON_INTERVAL,  // When the oldest pending byte has waited for the flush interval, or the ring is full
+    FLUSH_EVERY_BYTE    // After every byte
+};
+
+// How far written bytes are pushed towards the disk
+enum output_durability {
+    DURABILITY_NONE = 0,    // Left to the kernel's page cache writeback
+    DURABILITY_SYNC_BATCH,  // fdatasync() after every flush
+    DURABILITY_SYNC_BYTE    // Flush and fdatasync() after every byte
+};
+
+// Receives every committed byte. Returns 0 if there were no errors, 1 if there were errors.
+typedef int (*byte_sink_callback)(void* context, u_int8_t byte);
+
+// Receives every edit, with its repeat count, and CHORD_EDIT_NONE (with a count of 0) before the bytes of each stroke.
+// Returns 0 if there were no errors, 1 if there were errors.
+typedef int (*edit_sink_callback)(void* context, enum chord_edit edit, unsigned int count);
+
+struct byte_sink {
+    byte_sink_callback write_byte;
+    edit_sink_callback apply_edit;  // nullptr if the sink takes no edits, in which case the edit keys are ignored
+    void* context;
+};
+
+struct output_engine {
+    int file_descriptor;
+    enum output_mode mode;
+    enum output_flush_policy flush_policy;
+    enum output_durability durability;
+    int flush_interval_ms;
+
+    u_int8_t ring[OUTPUT_RING_SIZE];
+    size_t ring_head;   // Index of the oldest pending byte
+    size_t ring_count;  // Number of pending bytes (in OUTPUT_MODE_MMAP: bytes stored but not synced yet; with an
+                        // Editor: bytes that differ from the file)
+    struct timespec oldest_pending_time;    // When the oldest pending byte was pushed
+
+    // OUTPUT_MODE_MMAP
+    u_int8_t* mapping;      // The mapped chunk of the file, or nullptr before the first byte
+    off_t mapping_offset;   // Offset of the mapped chunk in the file
+    size_t mapping_position;    // Number of bytes stored in the mapped chunk
+    size_t synced_position;     // Number of bytes of the mapped chunk that have been synced
+
+    struct byte_journal journal;    // Records every pushed byte if attach_output_journal() was called
+    struct byte_fanout fanout;  // Delivers every pushed byte to the sinks if attach_output_fanout() was called
+    struct byte_encoder encoder;    // Encodes the bytes on their way to the ring if attach_output_encoder() was called
+    struct output_editor editor;    // Holds the output in place of the ring if attach_output_editor() was called
+
+    bool journal_failed;    // Set once the Journal could not record a byte; no more bytes are taken after that
+
+    metric_counter bytes_written;   // Counter of bytes handed to the kernel
+    metric_counter flushes_issued;  // Counter of flushes that wrote at least one byte
+};
+
+// Methods & Functions
+int setup_output_engine(struct output_engine* engine, const char* file_path, enum output_mode output_mode,
+                        enum output_flush_policy flush_policy, enum output_durability durability,
+                        int flush_interval_ms);
+void attach_output_encoder(struct output_engine* engine, enum byte_encoding encoding);
+int attach_output_editor(struct output_engine* engine);
+int attach_output_journal(struct output_engine* engine, const char* journal_file_path, int interval_ms);
+int attach_output_fanout(struct output_engine* engine, const struct sink_spec* specs, int spec_count,
+                         size_t buffer_size);
+int push_byte_to_output(struct output_engine* engine, u_int8_t byte);
+int apply_output_edit(struct output_engine* engine, enum chord_edit edit, unsigned int count);
+int flush_output_engine(struct output_engine* engine);
+int get_output_flush_timeout_ms(const struct output_engine* engine);
+int process_output_timeout(struct output_engine* engine);
+void print_output_counters(const struct output_engine* engine);
+int end_output_engine(struct output_engine* engine);
+
+#endif //STENOBYTE_OUTPUT_H
@@ -0,0 +1,463 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Pipeline.c is the source file for implementing the Pipeline. The thread running the event loop only
+    captures key events and pushes them to the event queue, so that a slow terminal or a blocked disk cannot delay
+    reading the keyboards. The commit thread turns the events into bytes, which the output thread writes to the file,
+    and into summary updates, which the render thread draws.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Pipeline.h"
+#include "StenoByte_Core.h"
+#include "StenoByte_Session.h"
+
+#include <poll.h>
+
+/*
+ * Sets up a Pipeline that is not running yet for a session
+ */
+void setup_pipeline(struct pipeline* pipeline, struct stenobyte_session* session) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->session = session;
+    pipeline->commit_stage.wake_file_descriptor = -1;
+    pipeline->render_stage.wake_file_descriptor = -1;
+    pipeline->output_stage.wake_file_descriptor = -1;
+    atomic_init(&pipeline->exit_requested, false);
+}
+
+/*
+ * Wakes the thread of a stage so that it pops its queue
+ */
+static void wake_stage(const struct pipeline_stage* stage) {
+    if (stage->started) {
+        eventfd_write(stage->wake_file_descriptor, 1);
+    }
+}
+
+/*
+ * Sleeps until the thread of a stage is woken or the timeout (in milliseconds, -1 for none) has passed
+ */
+static void wait_for_wake(const struct pipeline_stage* stage, const int timeout_ms) {
+    struct pollfd wake_poll = {.fd = stage->wake_file_descriptor, .events = POLLIN};
+    if (poll(&wake_poll, 1, timeout_ms) > 0) {
+        eventfd_t wake_count;
+        eventfd_read(stage->wake_file_descriptor, &wake_count);
+    }
+}
+
+/*
+ * Pushes an element, waiting for the consumer to make room if the queue is full. Each wait counts as one stall.
+ */
+static void push_waiting_for_room(struct spsc_queue* queue, const void* element, const struct pipeline_stage* consumer) {
+    if (push_to_spsc_queue(queue, element)) {
+        return;
+    }
+
+    queue->stalls++;
+    const struct timespec backoff = {.tv_sec = 0, .tv_nsec = PIPELINE_BACKOFF_NS};
+    do {
+        wake_stage(consumer);
+        nanosleep(&backoff, nullptr);
+    } while (!push_to_spsc_queue(queue, element));
+}
+
+/*
+ * Pushes a key event to the commit thread. Called by the capture thread.
+ * A replayed capture file waits for room, since it can be read again later. A keyboard never waits: the event is
+ * dropped instead, and the commit thread is sent the keys that are really held once there is room again.
+ */
+void push_key_event_to_pipeline(struct pipeline* pipeline, const struct input_event* event, const bool wait_for_room) {
+    if (pipeline->resync_pending) {
+        const struct pipeline_event resync = {
+            .kind = PIPELINE_STATE_EVENT, .set_bits = true,
+            .bit_mask = (chord_word) get_held_bit_mask(&pipeline->session->keyboards)
+        };
+        pipeline->resync_pending = !push_to_spsc_queue(&pipeline->event_queue, &resync);
+    }
+
+    const struct pipeline_event key_event = {.event = *event, .kind = PIPELINE_KEY_EVENT};
+    if (wait_for_room) {
+        push_waiting_for_room(&pipeline->event_queue, &key_event, &pipeline->commit_stage);
+    } else if (pipeline->resync_pending || !push_to_spsc_queue(&pipeline->event_queue, &key_event)) {
+        pipeline->event_queue.drops++;
+        pipeline->resync_pending = true;
+    }
+}
+
+/*
+ * Pushes a change made by the capture thread, such as a resync after SYN_DROPPED or a keyboard being detached, to the
+ * commit thread. These are never dropped.
+ */
+void push_state_to_pipeline(struct pipeline* pipeline, const bool set_bits, const chord_word bit_mask,
+                            const bool redraw) {
+    const struct pipeline_event state_event = {
+        .kind = PIPELINE_STATE_EVENT, .set_bits = set_bits, .bit_mask = bit_mask, .redraw = redraw
+    };
+    push_waiting_for_room(&pipeline->event_queue, &state_event, &pipeline->commit_stage);
+}
+
+/*
+ * Wakes the commit thread once a batch of events has been pushed
+ */
+void wake_pipeline(const struct pipeline* pipeline) {
+    wake_stage(&pipeline->commit_stage);
+}
+
+/*
+ * Checks whether the exit key has been pressed
+ */
+bool is_pipeline_exit_requested(const struct pipeline* pipeline) {
+    return atomic_load(&pipeline->exit_requested);
+}
+
+/*
+ * Byte Sink of the commit thread: hands each byte of a stroke's output to the output thread
+ */
+static int push_committed_byte(void* context, const u_int8_t byte) {
+    struct pipeline* pipeline = context;
+    const struct output_item item = {.byte = byte};
+    push_waiting_for_room(&pipeline->output_queue, &item, &pipeline->output_stage);
+    return 0;
+}
+
+/*
+ * Edit Sink of the commit thread: hands each edit, and the start of each stroke, to the output thread
+ */
+static int push_committed_edit(void* context, const enum chord_edit edit, const unsigned int count) {
+    struct pipeline* pipeline = context;
+    const struct output_item item = {.edit = (u_int8_t) edit, .is_edit = true, .count = count};
+    push_waiting_for_room(&pipeline->output_queue, &item, &pipeline->output_stage);
+    return 0;
+}
+
+/*
+ * Gets the sink that the commit thread writes strokes to, which only takes edits if the session's Byte Sink does
+ */
+static struct byte_sink get_commit_sink(struct pipeline* pipeline) {
+    return (struct byte_sink) {
+        .write_byte = push_committed_byte,
+        .apply_edit = pipeline->session->byte_sink.apply_edit != nullptr ? push_committed_edit : nullptr,
+        .context = pipeline
+    };
+}
+
+/*
+ * Applies a single event to the session's Bit Array on the commit thread, pushing each committed byte to the output
+ * thread
+ *
+ * Returns false if the exit key was pressed, true otherwise
+ */
+static bool commit_pipeline_event(struct pipeline* pipeline, const struct pipeline_event* item) {
+    struct stenobyte_session* session = pipeline->session;
+    if (item->kind == PIPELINE_STATE_EVENT) {
+        if (item->set_bits) {
+            resync_chord(&session->chord, item->bit_mask);
+        }
+        pipeline->redraw_pending = pipeline->redraw_pending || item->redraw;
+        pipeline->render_update_pending = true;
+        return true;
+    }
+
+    const struct input_event* current_event = &item->event;
+    if (current_event->type != EV_KEY) {
+        add_to_metric(&session->metrics.events_filtered, 1);
+        return true;
+    }
+    if (get_keymap_entry(current_event->code).action == KEY_ACTION_EXIT) {
+        atomic_store(&pipeline->exit_requested, true);
+        stop_stenobyte(session);
+        return false;
+    }
+
+    if (!process_key_presses(session, current_event)) {
+        return true;
+    }
+    if (session->chord.ready_to_compute_byte) {
+        compute_byte(&session->chord);
+        count_committed_chord(session, current_event);
+        if (session->mode == WRITER) {
+            const struct byte_sink output_sink = get_commit_sink(pipeline);
+            write_stroke_to_sink(session, &output_sink, get_event_time_us(current_event));
+        }
+    }
+    pipeline->render_update_pending = true;
+    return true;
+}
+
+/*
+ * Sends the latest state to the render thread. If the render queue is full, the update is dropped and sent again
+ * after the next batch, since only the latest state needs to be drawn.
+ */
+static void push_render_update(struct pipeline* pipeline) {
+    const struct render_update update = {
+        .bit_mask = pipeline->session->chord.bit_arr_mask, .word = pipeline->session->chord.current_word,
+        .redraw = pipeline->redraw_pending
+    };
+    if (!push_to_spsc_queue(&pipeline->render_queue, &update)) {
+        pipeline->render_queue.drops++;
+        return;
+    }
+    pipeline->render_update_pending = false;
+    pipeline->redraw_pending = false;
+}
+
+/*
+ * Commit Thread: turns key events into bytes and summary updates, one batch of events per wake-up. The session's
+ * Chord State is only changed by this thread while the Pipeline runs.
+ */
+static void* run_commit_stage(void* argument) {
+    struct pipeline* pipeline = argument;
+    struct stenobyte_session* session = pipeline->session;
+    const struct byte_sink output_sink = get_commit_sink(pipeline);
+    struct pipeline_event item;
+    bool exiting = false;
+
+    while (true) {
+        // Reads producer_finished first, so that no event pushed before it was set can be missed
+        const bool capture_finished = atomic_load(&pipeline->commit_stage.producer_finished);
+
+        const size_t bytes_before = pipeline->output_queue.slots != nullptr
+                                        ? atomic_load(&pipeline->output_queue.tail)
+                                        : 0;
+        while (pop_from_spsc_queue(&pipeline->event_queue, &item)) {
+            // Events after the exit key are discarded
+            exiting = exiting || !commit_pipeline_event(pipeline, &item);
+        }
+
+        // Strokes held back by the Dictionary are written out once they time out, or when the Pipeline stops
+        const bool finished = capture_finished && is_spsc_queue_empty(&pipeline->event_queue);
+        if (pipeline->output_queue.slots != nullptr) {
+            if (finished) {
+                flush_stenobyte_strokes(session, &output_sink);
+            } else {
+                add_to_metric(&session->metrics.bytes_committed,
+                              process_translator_timeout(&session->translator, &output_sink));
+            }
+        }
+
+        if (pipeline->render_update_pending && pipeline->render_stage.started) {
+            push_render_update(pipeline);
+            wake_stage(&pipeline->render_stage);
+        }
+        if (pipeline->output_queue.slots != nullptr && atomic_load(&pipeline->output_queue.tail) != bytes_before) {
+            wake_stage(&pipeline->output_stage);
+        }
+
+        if (finished) {
+            break;
+        }
+        wait_for_wake(&pipeline->commit_stage, pipeline->output_queue.slots != nullptr
+                                                   ? get_translator_timeout_ms(&session->translator)
+                                                   : -1);
+    }
+
+    atomic_store(&pipeline->render_stage.producer_finished, true);
+    atomic_store(&pipeline->output_stage.producer_finished, true);
+    wake_stage(&pipeline->render_stage);
+    wake_stage(&pipeline->output_stage);
+    return nullptr;
+}
+
+/*
+ * Render Thread: draws the summary from the latest update, at most one frame every RENDER_FRAME_INTERVAL_MS
+ */
+static void* run_render_stage(void* argument) {
+    struct pipeline* pipeline = argument;
+    struct renderer* renderer = &pipeline->session->renderer;
+    struct render_update update;
+
+    // This thread's own copy of the Chord State, which the summary is drawn from
+    struct chord_state chord = pipeline->session->chord;
+
+    render_frame(renderer, &chord);
+    while (true) {
+        const bool commit_finished = atomic_load(&pipeline->render_stage.producer_finished);
+
+        bool updated = false;
+        while (pop_from_spsc_queue(&pipeline->render_queue, &update)) {
+            chord.bit_arr_mask = update.bit_mask;
+            chord.current_word = update.word;
+            if (update.redraw) {
+                invalidate_renderer(renderer);
+            }
+            updated = true;
+        }
+        if (updated) {
+            mark_renderer_dirty(renderer);
+        }
+
+        if (commit_finished && is_spsc_queue_empty(&pipeline->render_queue)) {
+            if (renderer->dirty) {
+                render_frame(renderer, &chord);
+            }
+            break;
+        }
+        render_frame_if_due(renderer, &chord);
+        wait_for_wake(&pipeline->render_stage, get_renderer_timeout_ms(renderer));
+    }
+    return nullptr;
+}
+
+/*
+ * Output Thread: hands the committed bytes and edits to the session's Byte Sink and flushes the Output Engine when its
+ * flush interval is due
+ */
+static void* run_output_stage(void* argument) {
+    struct pipeline* pipeline = argument;
+    struct stenobyte_session* session = pipeline->session;
+    struct output_item item;
+
+    while (true) {
+        const bool commit_finished = atomic_load(&pipeline->output_stage.producer_finished);
+
+        while (pop_from_spsc_queue(&pipeline->output_queue, &item)) {
+            if (item.is_edit) {
+                session->byte_sink.apply_edit(session->byte_sink.context, (enum chord_edit) item.edit, item.count);
+            } else {
+                session->byte_sink.write_byte(session->byte_sink.context, item.byte);
+            }
+        }
+        process_output_timeout(&session->output_engine);
+        if (session->output_engine.journal_failed) {
+            stop_stenobyte(session);
+        }
+
+        if (commit_finished && is_spsc_queue_empty(&pipeline->output_queue)) {
+            break;
+        }
+        wait_for_wake(&pipeline->output_stage, get_output_flush_timeout_ms(&session->output_engine));
+    }
+    return nullptr;
+}
+
+/*
+ * Creates the queue, the wake-up eventfd and the thread of a stage
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int start_stage(struct pipeline* pipeline, struct pipeline_stage* stage, struct spsc_queue* queue,
+                       const size_t capacity, const size_t element_size, void* (*run_stage)(void*)) {
+    if (setup_spsc_queue(queue, capacity, element_size) != 0) {
+        return 1;
+    }
+
+    stage->wake_file_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stage->wake_file_descriptor < 0) {
+        perror("Failed to create pipeline eventfd");
+        return 1;
+    }
+
+    atomic_init(&stage->producer_finished, false);
+    const int error = pthread_create(&stage->thread, nullptr, run_stage, pipeline);
+    if (error != 0) {
+        errno = error;
+        perror("Failed to start pipeline thread");
+        return 1;
+    }
+    stage->started = true;
+    return 0;
+}
+
+/*
+ * Starts the commit thread, and the render and output threads if there is a summary to draw or a file to write.
+ * Must be called after the Renderer and the Output Engine have been set up.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int start_pipeline(struct pipeline* pipeline, const bool rendering, const bool writing) {
+    // SIGINT & SIGTERM are left to the capture thread, which runs the event loop
+    sigset_t stop_signals;
+    sigset_t previous_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_signals);
+
+    // The consumers are started before their producers, so that the commit thread knows which of them exist
+    int result = 0;
+    if (rendering) {
+        result = start_stage(pipeline, &pipeline->render_stage, &pipeline->render_queue, PIPELINE_RENDER_QUEUE_SIZE,
+                             sizeof(struct render_update), run_render_stage);
+    }
+    if (result == 0 && writing) {
+        result = start_stage(pipeline, &pipeline->output_stage, &pipeline->output_queue, PIPELINE_OUTPUT_QUEUE_SIZE,
+                             sizeof(struct output_item), run_output_stage);
+    }
+    if (result == 0) {
+        result = start_stage(pipeline, &pipeline->commit_stage, &pipeline->event_queue, PIPELINE_EVENT_QUEUE_SIZE,
+                             sizeof(struct pipeline_event), run_commit_stage);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+    return result;
+}
+
+/*
+ * Waits for a stage's thread to finish its queue, then frees its resources
+ */
+static void end_stage(struct pipeline_stage* stage, struct spsc_queue* queue) {
+    if (stage->started) {
+        pthread_join(stage->thread, nullptr);
+        stage->started = false;
+    }
+    if (stage->wake_file_descriptor >= 0) {
+        close(stage->wake_file_descriptor);
+        stage->wake_file_descriptor = -1;
+    }
+    end_spsc_queue(queue);
+}
+
+/*
+ * Stops the Pipeline once every event already captured has been committed, drawn and handed to the Output Engine.
+ * Called by the capture thread when the event loop ends.
+ */
+void stop_pipeline(struct pipeline* pipeline) {
+    // If the commit thread failed to start, its consumers are told to finish directly
+    if (!pipeline->commit_stage.started) {
+        atomic_store(&pipeline->render_stage.producer_finished, true);
+        atomic_store(&pipeline->output_stage.producer_finished, true);
+        wake_stage(&pipeline->render_stage);
+        wake_stage(&pipeline->output_stage);
+    }
+
+    atomic_store(&pipeline->commit_stage.producer_finished, true);
+    wake_stage(&pipeline->commit_stage);
+    end_stage(&pipeline->commit_stage, &pipeline->event_queue);
+    end_stage(&pipeline->render_stage, &pipeline->render_queue);
+    end_stage(&pipeline->output_stage, &pipeline->output_queue);
+}
+
+/*
+ * Prints the capacity, high-water mark, drops and stalls of a queue
+ */
+static void print_queue_counters(const char* name, const struct spsc_queue* queue) {
+    if (queue->capacity == 0) {
+        return;
+    }
+    printf("%-8s %10zu %10zu %10llu %10llu\n", name, queue->capacity, queue->high_water,
+           (unsigned long long) queue->drops, (unsigned long long) queue->stalls);
+}
+
+/*
+ * Prints the counters of the Pipeline's queues
+ */
+void print_pipeline_counters(const struct pipeline* pipeline) {
+    printf("%-8s %10s %10s %10s %10s\n", "Queue", "Capacity", "High-Water", "Drops", "Stalls");
+    print_queue_counters("events", &pipeline->event_queue);
+    print_queue_counters("render", &pipeline->render_queue);
+    print_queue_counters("output", &pipeline->output_queue);
+}
@@ -0,0 +1,112 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Pipeline.h is the header file for defining the Pipeline, which splits the event loop into a capture
+    thread, a commit thread, a render thread and an output thread connected by lock-free queues.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_PIPELINE_H
+#define STENOBYTE_PIPELINE_H
+
+#include "StenoByte_Chord.h"
+#include "StenoByte_Queue.h"
+
+#include <linux/input.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Number of slots in each queue (powers of 2)
+#define PIPELINE_EVENT_QUEUE_SIZE 4096
+#define PIPELINE_RENDER_QUEUE_SIZE 256
+#define PIPELINE_OUTPUT_QUEUE_SIZE 4096
+
+// How long a producer sleeps before trying again when it has to wait for room in a queue
+#define PIPELINE_BACKOFF_NS 50000
+
+enum pipeline_event_kind {
+    PIPELINE_KEY_EVENT = 0, // A key event read from a keyboard or a capture file
+    PIPELINE_STATE_EVENT    // A change made by the capture thread itself, such as a resync or a keyboard unplugged
+};
+
+// Element of the event queue, from the capture thread to the commit thread
+struct pipeline_event {
+    struct input_event event;   // PIPELINE_KEY_EVENT: the event, with its kernel timestamp
+    u_int8_t kind;
+    bool set_bits;      // PIPELINE_STATE_EVENT: replace the Bit Array with bit_mask
+    chord_word bit_mask;
+    bool redraw;        // PIPELINE_STATE_EVENT: draw the whole summary again
+};
+
+// Element of the render queue, from the commit thread to the render thread
+struct render_update {
+    chord_word bit_mask;
+    chord_word word;
+    bool redraw;
+};
+
+// Element of the output queue, from the commit thread to the output thread
+struct output_item {
+    u_int8_t byte;
+    u_int8_t edit;      // The enum chord_edit to apply instead of writing out the byte, if is_edit is set
+    bool is_edit;
+    u_int32_t count;    // is_edit: the edit's repeat count
+};
+
+// A thread of the Pipeline that sleeps on an eventfd until its producer wakes it
+struct pipeline_stage {
+    pthread_t thread;
+    bool started;
+    int wake_file_descriptor;
+    atomic_bool producer_finished;  // Set once nothing more will be pushed to the stage's queue
+};
+
+struct stenobyte_session;
+
+// The threads and queues of a session running as the Pipeline
+struct pipeline {
+    struct stenobyte_session* session;  // The session whose state the threads work on
+
+    struct spsc_queue event_queue;  // Capture thread -> Commit thread
+    struct spsc_queue render_queue; // Commit thread -> Render thread
+    struct spsc_queue output_queue; // Commit thread -> Output thread
+
+    struct pipeline_stage commit_stage;
+    struct pipeline_stage render_stage;
+    struct pipeline_stage output_stage;
+
+    atomic_bool exit_requested; // Set by the commit thread when the exit key is pressed
+
+    // Owned by the capture thread
+    bool resync_pending;    // Whether key events were dropped since the commit thread last got the Bit Array
+
+    // Owned by the commit thread
+    bool render_update_pending; // Whether the render thread has not been sent the latest state yet
+    bool redraw_pending;        // Whether the next summary update must draw the whole summary
+};
+
+// Methods & Functions
+void setup_pipeline(struct pipeline* pipeline, struct stenobyte_session* session);
+int start_pipeline(struct pipeline* pipeline, bool rendering, bool writing);
+void push_key_event_to_pipeline(struct pipeline* pipeline, const struct input_event* event, bool wait_for_room);
+void push_state_to_pipeline(struct pipeline* pipeline, bool set_bits, chord_word bit_mask, bool redraw);
+void wake_pipeline(const struct pipeline* pipeline);
+bool is_pipeline_exit_requested(const struct pipeline* pipeline);
+void stop_pipeline(struct pipeline* pipeline);
+void print_pipeline_counters(const struct pipeline* pipeline);
+
+#endif //STENOBYTE_PIPELINE_H
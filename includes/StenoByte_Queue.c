@@ -0,0 +1,62 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Queue.c is the source file for setting up and freeing the lock-free Single-Producer/Single-Consumer
+    Queues used by the Pipeline. Pushing and popping are inline in StenoByte_Queue.h.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Allocates the slots of an empty queue. The capacity must be a power of 2.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int setup_spsc_queue(struct spsc_queue* queue, const size_t capacity, const size_t element_size) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        fprintf(stderr, "Queue capacity %zu is not a power of 2\n", capacity);
+        return 1;
+    }
+
+    queue->slots = calloc(capacity, element_size);
+    if (queue->slots == nullptr) {
+        perror("Failed to allocate queue");
+        return 1;
+    }
+
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    queue->cached_head = 0;
+    queue->cached_tail = 0;
+    queue->high_water = 0;
+    queue->drops = 0;
+    queue->stalls = 0;
+    queue->capacity = capacity;
+    queue->element_size = element_size;
+    return 0;
+}
+
+/*
+ * Frees the slots of the queue
+ */
+void end_spsc_queue(struct spsc_queue* queue) {
+    free(queue->slots);
+    queue->slots = nullptr;
+}
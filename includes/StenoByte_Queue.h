@@ -0,0 +1,110 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Queue.h is the header file for defining the lock-free Single-Producer/Single-Consumer Queue that passes
+    key events, bytes and summary updates between the threads of the Pipeline.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_QUEUE_H
+#define STENOBYTE_QUEUE_H
+
+#include <sys/types.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Size of a cache line, so that the producer's and the consumer's indexes never share one
+#define QUEUE_CACHE_LINE_SIZE 64
+
+/*
+ * A fixed-size ring of equally sized elements. Exactly one thread may push and exactly one thread may pop.
+ * The indexes run freely and are masked into the ring, so the number of queued elements is always tail - head.
+ */
+struct spsc_queue {
+    // Consumer Side
+    alignas(QUEUE_CACHE_LINE_SIZE) atomic_size_t head;  // Index of the next element to pop
+    size_t cached_tail;     // The consumer's last view of tail, so that it only reloads it when the ring looks empty
+
+    // Producer Side
+    alignas(QUEUE_CACHE_LINE_SIZE) atomic_size_t tail;  // Index of the next free slot
+    size_t cached_head;     // The producer's last view of head, so that it only reloads it when the ring looks full
+    size_t high_water;      // Most elements that were ever queued at once
+    u_int64_t drops;        // Counter of elements the producer gave up on because the ring was full
+    u_int64_t stalls;       // Counter of times the producer had to wait for the consumer to make room
+
+    // Set up once before the threads start
+    alignas(QUEUE_CACHE_LINE_SIZE) size_t capacity;    // Number of slots, a power of 2
+    size_t element_size;
+    unsigned char* slots;
+};
+
+/*
+ * Copies an element into the queue. Called by the producer only.
+ *
+ * Returns true if the element was queued, false if the queue is full
+ */
+static inline bool push_to_spsc_queue(struct spsc_queue* queue, const void* element) {
+    const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - queue->cached_head == queue->capacity) {
+        queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (tail - queue->cached_head == queue->capacity) {
+            return false;
+        }
+    }
+
+    memcpy(queue->slots + (tail & (queue->capacity - 1)) * queue->element_size, element, queue->element_size);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+    if (tail + 1 - queue->cached_head > queue->high_water) {
+        queue->high_water = tail + 1 - queue->cached_head;
+    }
+    return true;
+}
+
+/*
+ * Copies the oldest element out of the queue. Called by the consumer only.
+ *
+ * Returns true if an element was popped, false if the queue is empty
+ */
+static inline bool pop_from_spsc_queue(struct spsc_queue* queue, void* element) {
+    const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == queue->cached_tail) {
+        queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head == queue->cached_tail) {
+            return false;
+        }
+    }
+
+    memcpy(element, queue->slots + (head & (queue->capacity - 1)) * queue->element_size, queue->element_size);
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+/*
+ * Checks whether the queue is empty. Called by the consumer only.
+ */
+static inline bool is_spsc_queue_empty(struct spsc_queue* queue) {
+    return atomic_load_explicit(&queue->head, memory_order_relaxed) ==
+           atomic_load_explicit(&queue->tail, memory_order_acquire);
+}
+
+// Methods & Functions
+int setup_spsc_queue(struct spsc_queue* queue, size_t capacity, size_t element_size);
+void end_spsc_queue(struct spsc_queue* queue);
+
+#endif //STENOBYTE_QUEUE_H
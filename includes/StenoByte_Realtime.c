@@ -0,0 +1,129 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Realtime.c is the source file for implementing Real-Time Mode, which moves the calling thread to
+    SCHED_FIFO, pins it to a CPU and locks the process's memory, then puts everything back when the session ends.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// cpu_set_t & pthread_setaffinity_np() are GNU extensions
+#define _GNU_SOURCE
+
+#include "StenoByte_Realtime.h"
+
+#include <sys/mman.h>
+#include <assert.h>
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(cpu_set_t) == sizeof(((struct realtime_state*) nullptr)->original_cpu_mask),
+              "The saved CPU mask must hold a cpu_set_t");
+
+// glibc's defaults for the malloc settings Real-Time Mode changes
+#define DEFAULT_MALLOC_TRIM_THRESHOLD (128 * 1024)
+#define DEFAULT_MALLOC_MMAP_MAX 65536
+
+/*
+ * Touches REALTIME_STACK_PREFAULT_SIZE bytes of stack below the caller, so that those pages are mapped (and locked)
+ * before the event loop needs them
+ */
+[[gnu::noinline]] static void prefault_stack() {
+    volatile u_int8_t stack[REALTIME_STACK_PREFAULT_SIZE];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+/*
+ * Puts the calling thread into Real-Time Mode. The heap is kept from shrinking or growing through mmap(), so that the
+ * buffers allocated at setup stay mapped; every page of the process is locked into memory, now and as it grows; the
+ * stack is prefaulted; then the thread is pinned to cpu (unless it is negative) and moved to SCHED_FIFO at priority.
+ * Threads the calling thread starts afterwards inherit its scheduling, so it should be called once they are running.
+ * Whatever was changed is put back by leave_realtime_mode(), including when this fails part of the way through.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+int enter_realtime_mode(struct realtime_state* state, const int priority, const int cpu) {
+    memset(state, 0, sizeof(*state));
+
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        perror("Failed to lock memory (needs CAP_IPC_LOCK or a higher RLIMIT_MEMLOCK)");
+        return 1;
+    }
+    state->memory_locked = true;
+    prefault_stack();
+
+    int error;
+    if (cpu >= 0) {
+        cpu_set_t cpu_mask;
+        error = pthread_getaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask);
+        if (error == 0) {
+            memcpy(state->original_cpu_mask, &cpu_mask, sizeof(cpu_mask));
+            CPU_ZERO(&cpu_mask);
+            CPU_SET(cpu, &cpu_mask);
+            error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask);
+        }
+        if (error != 0) {
+            errno = error;
+            perror("Failed to pin the event loop to its CPU");
+            return 1;
+        }
+        state->affinity_changed = true;
+    }
+
+    struct sched_param parameters;
+    error = pthread_getschedparam(pthread_self(), &state->original_policy, &parameters);
+    if (error == 0) {
+        state->original_priority = parameters.sched_priority;
+        parameters.sched_priority = priority;
+        error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+    }
+    if (error != 0) {
+        errno = error;
+        perror("Failed to switch the event loop to SCHED_FIFO (needs CAP_SYS_NICE or RLIMIT_RTPRIO)");
+        return 1;
+    }
+    state->scheduler_changed = true;
+    return 0;
+}
+
+/*
+ * Puts back the scheduling, CPU affinity, memory locking and malloc settings that enter_realtime_mode() changed.
+ * Must be called from the same thread.
+ */
+void leave_realtime_mode(struct realtime_state* state) {
+    if (state->scheduler_changed) {
+        const struct sched_param parameters = {.sched_priority = state->original_priority};
+        pthread_setschedparam(pthread_self(), state->original_policy, &parameters);
+        state->scheduler_changed = false;
+    }
+    if (state->affinity_changed) {
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), (const cpu_set_t*) state->original_cpu_mask);
+        state->affinity_changed = false;
+    }
+    if (state->memory_locked) {
+        munlockall();
+        state->memory_locked = false;
+    }
+    mallopt(M_TRIM_THRESHOLD, DEFAULT_MALLOC_TRIM_THRESHOLD);
+    mallopt(M_MMAP_MAX, DEFAULT_MALLOC_MMAP_MAX);
+}
@@ -0,0 +1,51 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Realtime.h is the header file for defining Real-Time Mode, which runs the event loop's thread on a
+    real-time scheduling class, optionally pinned to a CPU, with the process's memory locked and prefaulted.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_REALTIME_H
+#define STENOBYTE_REALTIME_H
+
+#include <sys/types.h>
+#include <stdbool.h>
+
+// SCHED_FIFO priority used by --realtime without a value (1 to 99)
+#define DEFAULT_REALTIME_PRIORITY 50
+
+// Amount of stack touched up front so that the event loop never faults in a stack page
+#define REALTIME_STACK_PREFAULT_SIZE (256 * 1024)
+
+// Words of the saved CPU affinity mask, enough for the 1024 CPUs of a cpu_set_t
+#define REALTIME_CPU_MASK_WORDS 16
+
+// What Real-Time Mode changed, so that leave_realtime_mode() can put it back
+struct realtime_state {
+    bool memory_locked;
+    bool scheduler_changed;
+    int original_policy;
+    int original_priority;
+    bool affinity_changed;
+    u_int64_t original_cpu_mask[REALTIME_CPU_MASK_WORDS];
+};
+
+// Methods & Functions
+int enter_realtime_mode(struct realtime_state* state, int priority, int cpu);
+void leave_realtime_mode(struct realtime_state* state);
+
+#endif //STENOBYTE_REALTIME_H
@@ -0,0 +1,205 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Renderer.c is the source file for implementing the Renderer, which draws the Bit Array Summary once and
+    then uses ANSI cursor movement to redraw only the bit values and last byte that have changed. Bursts of events are
+    collapsed into at most one frame per RENDER_FRAME_INTERVAL_MS.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StenoByte_Renderer.h"
+#include "StenoByte_Core.h"
+#include "StenoByte_Time.h"
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+
+// ANSI escape sequences
+#define ANSI_SAVE_CURSOR "\0337"
+#define ANSI_RESTORE_CURSOR "\0338"
+
+// Number of SIGWINCH signals received, i.e. of times the terminal was resized
+static atomic_uint terminal_resizes;
+
+/*
+ * Counts a resize of the terminal, so that the next frame draws the whole summary again
+ */
+static void handle_resize_signal(const int signal_number) {
+    (void) signal_number;
+    atomic_fetch_add_explicit(&terminal_resizes, 1, memory_order_relaxed);
+}
+
+/*
+ * Sets up the Renderer so that the first frame draws the whole summary, or so that nothing is drawn if not enabled.
+ * Incremental updates are only used when stdout is a terminal; otherwise every frame is a full summary.
+ */
+void setup_renderer(struct renderer* renderer, const bool enabled, const enum stenobyte_mode mode) {
+    renderer->enabled = enabled;
+    renderer->mode = mode;
+    renderer->incremental = isatty(STDOUT_FILENO);
+    renderer->frame_drawn = false;
+    renderer->summary_fits = false;
+    renderer->seen_resizes = atomic_load_explicit(&terminal_resizes, memory_order_relaxed);
+    renderer->dirty = enabled;
+    renderer->last_frame_time = (struct timespec) {0};
+
+    if (enabled && renderer->incremental) {
+        struct sigaction resize_action = {.sa_handler = handle_resize_signal, .sa_flags = SA_RESTART};
+        sigemptyset(&resize_action.sa_mask);
+        sigaction(SIGWINCH, &resize_action, nullptr);
+    }
+}
+
+/*
+ * Records that the state has changed and needs to be drawn in the next frame
+ */
+void mark_renderer_dirty(struct renderer* renderer) {
+    renderer->dirty = renderer->enabled;
+}
+
+/*
+ * Makes the next frame draw the whole summary again, e.g. after something else was printed to the terminal
+ */
+void invalidate_renderer(struct renderer* renderer) {
+    renderer->frame_drawn = false;
+    renderer->dirty = renderer->enabled;
+}
+
+/*
+ * Gets how long the event loop may sleep before the next frame is due
+ *
+ * Returns the timeout in milliseconds, or -1 if there is nothing to draw
+ */
+int get_renderer_timeout_ms(const struct renderer* renderer) {
+    if (!renderer->dirty) {
+        return -1;
+    }
+
+    const long long remaining_ms = RENDER_FRAME_INTERVAL_MS - milliseconds_since(&renderer->last_frame_time);
+    return remaining_ms > 0 ? (int) remaining_ms : 0;
+}
+
+/*
+ * Draws a frame if the state has changed and the previous frame was drawn at least RENDER_FRAME_INTERVAL_MS ago
+ */
+void render_frame_if_due(struct renderer* renderer, const struct chord_state* chord) {
+    if (renderer->frame_drawn &&
+        atomic_load_explicit(&terminal_resizes, memory_order_relaxed) != renderer->seen_resizes) {
+        invalidate_renderer(renderer);
+    }
+    if (get_renderer_timeout_ms(renderer) == 0) {
+        render_frame(renderer, chord);
+    }
+}
+
+/*
+ * Gets the number of columns that the widest line of a text takes up on the terminal, with tabs expanded
+ */
+static int get_text_width(const char* text, const int length) {
+    int width = 0;
+    int column = 0;
+    for (int i = 0; i < length; i++) {
+        if (text[i] == '\n') {
+            column = 0;
+        } else if (text[i] == '\t') {
+            column += RENDER_TAB_WIDTH - column % RENDER_TAB_WIDTH;
+        } else {
+            column++;
+        }
+        if (column > width) {
+            width = column;
+        }
+    }
+    return width;
+}
+
+/*
+ * Gets whether every line of a whole summary fits in the width of the terminal, so that the rows and columns that
+ * incremental updates move to are where its cells actually are
+ */
+static bool does_summary_fit(const char* summary, const int length) {
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0) {
+        return false;
+    }
+    return get_text_width(summary, length) <= size.ws_col;
+}
+
+/*
+ * Draws a frame of the Chord State: the whole summary if it has not been drawn yet, otherwise only the cells that
+ * changed. When the summary is wider than the terminal, its lines wrap and the cells are not where the updates would
+ * move to, so every frame is a whole summary until the terminal is wide enough again.
+ */
+void render_frame(struct renderer* renderer, const struct chord_state* chord) {
+    if (!renderer->enabled) {
+        return;
+    }
+
+    const unsigned int bit_mask = chord->bit_arr_mask;
+    const chord_word current_word = chord->current_word;
+
+    if (!renderer->incremental || !renderer->frame_drawn || !renderer->summary_fits) {
+        char summary[BIT_ARR_SUMMARY_SIZE];
+        const int summary_length = get_bit_arr_summary(summary, renderer->mode, chord);
+        fwrite(summary, 1, (size_t) summary_length, stdout);
+        if (renderer->incremental) {
+            fputs(ANSI_SAVE_CURSOR, stdout);
+            renderer->seen_resizes = atomic_load_explicit(&terminal_resizes, memory_order_relaxed);
+            renderer->summary_fits = does_summary_fit(summary, summary_length);
+        }
+        renderer->frame_drawn = true;
+    } else {
+        char update[RENDER_UPDATE_SIZE];
+        int length = 0;
+
+        // Moves from the saved cursor position (below the summary) to each changed cell, then back again
+        const unsigned int changed_bits = bit_mask ^ renderer->drawn_bit_mask;
+        for (int i = BITS_ARR_SIZE - 1; i >= 0; i--) {
+            if (changed_bits & 1u << i) {
+                const int column = RENDER_FIRST_BIT_COLUMN + RENDER_BIT_COLUMN_WIDTH * (BITS_ARR_SIZE - 1 - i);
+                length += sprintf(update + length, ANSI_RESTORE_CURSOR "\033[%dA\033[%dG%d",
+                                  RENDER_BIT_VALUE_ROW, column, get_bit(chord, i));
+            }
+        }
+
+        if (current_word != renderer->drawn_word) {
+            length += sprintf(update + length, ANSI_RESTORE_CURSOR "\033[%dA\033[%dG%d\033[K",
+                              RENDER_BYTE_DECIMAL_ROW, RENDER_BYTE_DECIMAL_COLUMN, current_word);
+#if CHORD_WORD_SIZE == 1
+            length += sprintf(update + length, ANSI_RESTORE_CURSOR "\033[%dA\033[%dG%c\033[K",
+                              RENDER_BYTE_RAW_ROW, RENDER_BYTE_RAW_COLUMN,
+                              isprint(current_word) ? (char) current_word : ' ');
+#else
+            length += sprintf(update + length, ANSI_RESTORE_CURSOR "\033[%dA\033[%dG0x%04X\033[K",
+                              RENDER_BYTE_RAW_ROW, RENDER_BYTE_RAW_COLUMN, current_word);
+#endif
+        }
+
+        if (length == 0) {
+            renderer->dirty = false;
+            return;
+        }
+        length += sprintf(update + length, ANSI_RESTORE_CURSOR);
+        fwrite(update, 1, (size_t) length, stdout);
+    }
+
+    fflush(stdout);
+    renderer->drawn_bit_mask = bit_mask;
+    renderer->drawn_word = current_word;
+    renderer->dirty = false;
+    clock_gettime(CLOCK_MONOTONIC, &renderer->last_frame_time);
+}
@@ -0,0 +1,72 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Renderer.h is the header file for defining the Renderer, which draws the Bit Array Summary once and then
+    only redraws the cells that have changed.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_RENDERER_H
+#define STENOBYTE_RENDERER_H
+
+#include "StenoByte_Chord.h"
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Shortest time between two frames (about one refresh of a 60 Hz display)
+#define RENDER_FRAME_INTERVAL_MS 16
+
+// Rows of the Bit Array Summary, counted upwards from the line below the summary where the cursor rests
+#define RENDER_BIT_VALUE_ROW 10
+#define RENDER_BYTE_DECIMAL_ROW 5
+#define RENDER_BYTE_RAW_ROW 4
+
+// Columns (1-based) of the cells in the Bit Array Summary, assuming tab stops every 8 columns
+#define RENDER_FIRST_BIT_COLUMN 33
+#define RENDER_BIT_COLUMN_WIDTH 16
+#define RENDER_BYTE_DECIMAL_COLUMN 32
+#define RENDER_BYTE_RAW_COLUMN 34
+
+// Largest update written for a single frame
+#define RENDER_UPDATE_SIZE 512
+
+// Width of a tab stop on the terminal
+#define RENDER_TAB_WIDTH 8
+
+struct renderer {
+    bool enabled;   // Whether anything is drawn at all (false when running headless)
+    enum stenobyte_mode mode;   // The mode shown in the summary
+    bool incremental;   // Whether stdout is a terminal that understands ANSI cursor movement
+    bool frame_drawn;   // Whether the whole summary has been drawn and the cursor position saved
+    bool summary_fits;  // Whether no line of the last whole summary was wider than the terminal (so none wrapped)
+    unsigned int seen_resizes;  // The number of terminal resizes when the last whole summary was drawn
+    bool dirty;         // Whether the state has changed since the last frame
+    unsigned int drawn_bit_mask;    // The bit values currently on the screen
+    chord_word drawn_word;  // The last computed word currently on the screen
+    struct timespec last_frame_time;
+};
+
+// Methods & Functions
+void setup_renderer(struct renderer* renderer, bool enabled, enum stenobyte_mode mode);
+void mark_renderer_dirty(struct renderer* renderer);
+void invalidate_renderer(struct renderer* renderer);
+int get_renderer_timeout_ms(const struct renderer* renderer);
+void render_frame_if_due(struct renderer* renderer, const struct chord_state* chord);
+void render_frame(struct renderer* renderer, const struct chord_state* chord);
+
+#endif //STENOBYTE_RENDERER_H
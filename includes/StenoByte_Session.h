@@ -0,0 +1,75 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Session.h is the header file for defining a StenoByte Session: everything a running instance of
+    StenoByte owns, so that a program can embed one or more sessions side by side.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_SESSION_H
+#define STENOBYTE_SESSION_H
+
+#include "StenoByte_Chord.h"
+#include "StenoByte_Devices.h"
+#include "StenoByte_Dictionary.h"
+#include "StenoByte_Input.h"
+#include "StenoByte_Metrics.h"
+#include "StenoByte_Options.h"
+#include "StenoByte_Output.h"
+#include "StenoByte_Pipeline.h"
+#include "StenoByte_Realtime.h"
+#include "StenoByte_Renderer.h"
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <termios.h>
+
+/*
+ * A StenoByte Session. Every function that works on a session is given it explicitly; the only state shared between
+ * sessions is the Keymap and the key labels, which setup_stenobyte_keymap() loads once before any session is set up.
+ */
+struct stenobyte_session {
+    enum stenobyte_mode mode;   // What mode the session is in
+    struct stenobyte_options options;   // The settings the session was set up with
+    struct chord_state chord;   // The Bit Array and the byte last computed from it
+    bool ignore_exit_key;   // Whether the exit key is ignored instead of ending the session
+
+    struct byte_sink byte_sink; // Where committed bytes go; the Output Engine by default
+    struct chord_dictionary dictionary; // Loaded with --dictionary, empty otherwise
+    struct stroke_translator translator;    // Turns the computed bytes into output through the Dictionary
+    struct output_engine output_engine; // Buffers the bytes and writes them to the file
+    struct renderer renderer;   // Draws the summary and updates only what changed
+    struct stenobyte_metrics metrics;   // Counters & latencies, served by metrics_server if requested
+    struct metrics_server metrics_server;
+
+    struct keyboard_set keyboards;  // The keyboards read when no Event Source is used
+    bool using_event_source;    // Whether key events come from event_source instead of keyboards
+    struct input_source event_source;   // A capture file being replayed, or events supplied by a callback
+    struct capture_recorder capture_recorder;   // Records the key events of the session
+
+    bool pipelined; // Whether the event loop runs as the Pipeline instead of on a single thread
+    struct pipeline pipeline;
+
+    struct realtime_state realtime; // What --realtime changed while the event loop runs
+
+    int epoll_file_descriptor;  // epoll instance the event loop blocks on
+    int wake_file_descriptor;   // eventfd written to by stop_stenobyte() to wake and end the event loop
+
+    bool terminal_settings_saved;   // Whether disable_echo() saved settings for restore_terminal() to restore
+    struct termios original_terminal_settings;  // Termios Struct to store original terminal settings
+};
+
+#endif //STENOBYTE_SESSION_H
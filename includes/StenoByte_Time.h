@@ -0,0 +1,35 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    StenoByte_Time.h is the header file for defining small helpers for measuring time with the monotonic clock.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STENOBYTE_TIME_H
+#define STENOBYTE_TIME_H
+
+#include <time.h>
+
+/*
+ * Returns the number of milliseconds that have passed since the given monotonic time
+ */
+static inline long long milliseconds_since(const struct timespec* start_time) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start_time->tv_sec) * 1000LL + (now.tv_nsec - start_time->tv_nsec) / 1000000;
+}
+
+#endif //STENOBYTE_TIME_H
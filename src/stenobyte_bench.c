@@ -0,0 +1,292 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    stenobyte_bench.c feeds synthetic key event streams through the StenoByte Library and reports the throughput of the
+    whole pipeline and the latency of each of its stages.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "../includes/StenoByte_Core.h"
+
+// Default number of bytes turned into chords for the synthetic event stream
+#define DEFAULT_BENCH_BYTES 200000
+
+// Default file the committed bytes are written to
+#define DEFAULT_BENCH_OUTPUT_PATH "./bench_output.txt"
+
+// The stages of the pipeline that are timed individually
+enum bench_stage {
+    STAGE_PROCESS_KEY_PRESSES = 0,
+    STAGE_COMPUTE_BYTE,
+    STAGE_SUMMARY_RENDERING,
+    STAGE_FILE_OUTPUT,
+    STAGE_COUNT
+};
+
+static const char* stage_names[STAGE_COUNT] = {
+    "process_key_presses", "compute_byte", "summary_rendering", "file_output"
+};
+
+// The session the events are run through
+static struct stenobyte_session session;
+
+// Latency samples (in nanoseconds) of one stage
+struct stage_samples {
+    u_int64_t* samples;
+    size_t count;
+};
+
+// Keys for b0 to b7 in the default Keymap, then the keys of wider chords
+static const int bit_key_codes[BITS_ARR_SIZE] = {
+    KEY_SEMICOLON, KEY_L, KEY_K, KEY_J, KEY_F, KEY_D, KEY_S, KEY_A,
+#if BITS_ARR_SIZE >= 10
+    KEY_N, KEY_V,
+#endif
+#if BITS_ARR_SIZE >= 12
+    KEY_U, KEY_R,
+#endif
+#if BITS_ARR_SIZE >= 16
+    KEY_I, KEY_E, KEY_O, KEY_W
+#endif
+};
+
+/*
+ * Returns the current monotonic time in nanoseconds
+ */
+static u_int64_t now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u_int64_t) now.tv_sec * 1000000000ULL + (u_int64_t) now.tv_nsec;
+}
+
+/*
+ * Appends a key event to the synthetic stream
+ */
+static void add_event(struct input_event* events, size_t* count, const int key_code, const int value) {
+    events[*count] = (struct input_event) {.type = EV_KEY, .code = (u_int16_t) key_code, .value = value};
+    (*count)++;
+}
+
+/*
+ * Generates the events for typing out byte_count pseudo-random chords (bytes, or words for chords wider than 8 bits):
+ * press the chord, press & release SPACE, then release the chord. With COMMIT_ON_RELEASE the chord is only pressed &
+ * released, and SPACE is only pressed for 0x00.
+ *
+ * Returns the number of events generated
+ */
+static size_t generate_events(struct input_event* events, const size_t byte_count,
+                              const enum chord_commit_mode commit_mode) {
+    size_t count = 0;
+    u_int32_t random_state = 0x5EB0B17E;
+
+    for (size_t i = 0; i < byte_count; i++) {
+        random_state = random_state * 1664525u + 1013904223u;
+        const chord_word word = (chord_word) (random_state >> (32 - BITS_ARR_SIZE));
+
+        for (int bit = 0; bit < BITS_ARR_SIZE; bit++) {
+            if (word & 1 << bit) {
+                add_event(events, &count, bit_key_codes[bit], EV_KEY_PRESSED);
+            }
+        }
+        if (commit_mode == COMMIT_ON_KEY || word == 0x00) {
+            add_event(events, &count, KEY_SPACE, EV_KEY_PRESSED);
+            add_event(events, &count, KEY_SPACE, EV_KEY_RELEASED);
+        }
+        for (int bit = 0; bit < BITS_ARR_SIZE; bit++) {
+            if (word & 1 << bit) {
+                add_event(events, &count, bit_key_codes[bit], EV_KEY_RELEASED);
+            }
+        }
+    }
+    return count;
+}
+
+static int compare_samples(const void* a, const void* b) {
+    const u_int64_t left = *(const u_int64_t*) a;
+    const u_int64_t right = *(const u_int64_t*) b;
+    return (left > right) - (left < right);
+}
+
+/*
+ * Returns the sample at the given percentile of a sorted array of samples
+ */
+static u_int64_t get_percentile(const struct stage_samples* stage, const double percentile) {
+    if (stage->count == 0) {
+        return 0;
+    }
+    size_t index = (size_t) (percentile / 100.0 * (double) stage->count);
+    if (index >= stage->count) {
+        index = stage->count - 1;
+    }
+    return stage->samples[index];
+}
+
+/*
+ * Runs the events through the pipeline without per-stage timers, as the event loop does when running headless
+ *
+ * Returns the elapsed time in nanoseconds
+ */
+static u_int64_t run_throughput_pass(const struct input_event* events, const size_t event_count) {
+    const u_int64_t start_time = now_ns();
+    for (size_t i = 0; i < event_count; i++) {
+        process_key_presses(&session, &events[i]);
+        if (session.chord.ready_to_compute_byte) {
+            compute_byte(&session.chord);
+            write_byte_to_sink(&session);
+        }
+    }
+    flush_output_engine(&session.output_engine);
+    return now_ns() - start_time;
+}
+
+/*
+ * Runs the events through the pipeline, timing each stage. The summary is rendered for every event, as it was before
+ * frames were coalesced, to measure the cost of a single frame.
+ */
+static void run_latency_pass(const struct input_event* events, const size_t event_count,
+                             struct stage_samples stages[STAGE_COUNT]) {
+    char summary[BIT_ARR_SUMMARY_SIZE];
+
+    for (size_t i = 0; i < event_count; i++) {
+        u_int64_t start_time = now_ns();
+        process_key_presses(&session, &events[i]);
+        stages[STAGE_PROCESS_KEY_PRESSES].samples[stages[STAGE_PROCESS_KEY_PRESSES].count++] = now_ns() - start_time;
+
+        if (session.chord.ready_to_compute_byte) {
+            start_time = now_ns();
+            compute_byte(&session.chord);
+            stages[STAGE_COMPUTE_BYTE].samples[stages[STAGE_COMPUTE_BYTE].count++] = now_ns() - start_time;
+
+            start_time = now_ns();
+            write_byte_to_sink(&session);
+            stages[STAGE_FILE_OUTPUT].samples[stages[STAGE_FILE_OUTPUT].count++] = now_ns() - start_time;
+        }
+
+        start_time = now_ns();
+        get_bit_arr_summary(summary, session.mode, &session.chord);
+        stages[STAGE_SUMMARY_RENDERING].samples[stages[STAGE_SUMMARY_RENDERING].count++] = now_ns() - start_time;
+    }
+    flush_output_engine(&session.output_engine);
+}
+
+/*
+ * Prints the results as text or as a single JSON object
+ */
+static void print_results(const bool json, const size_t event_count, const size_t byte_count,
+                          const u_int64_t elapsed_ns, struct stage_samples stages[STAGE_COUNT]) {
+    const double elapsed_seconds = (double) elapsed_ns / 1e9;
+    const double events_per_second = (double) event_count / elapsed_seconds;
+    const double bytes_per_second = (double) byte_count / elapsed_seconds;
+
+    if (json) {
+        printf("{\"events\": %zu, \"bytes\": %zu, \"events_per_second\": %.0f, \"bytes_per_second\": %.0f, "
+               "\"stages\": {", event_count, byte_count, events_per_second, bytes_per_second);
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            printf("%s\"%s\": {\"samples\": %zu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu}",
+                   i > 0 ? ", " : "", stage_names[i], stages[i].count,
+                   (unsigned long long) get_percentile(&stages[i], 50.0),
+                   (unsigned long long) get_percentile(&stages[i], 99.0),
+                   (unsigned long long) get_percentile(&stages[i], 99.9));
+        }
+        printf("}}\n");
+        return;
+    }
+
+    printf("Events: %zu\nBytes committed: %zu\n", event_count, byte_count);
+    printf("Throughput (headless pipeline): %.0f events/s, %.0f bytes/s\n\n", events_per_second, bytes_per_second);
+    printf("%-22s %10s %10s %10s %10s\n", "Stage", "Samples", "p50 (ns)", "p99 (ns)", "p999 (ns)");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        printf("%-22s %10zu %10llu %10llu %10llu\n", stage_names[i], stages[i].count,
+               (unsigned long long) get_percentile(&stages[i], 50.0),
+               (unsigned long long) get_percentile(&stages[i], 99.0),
+               (unsigned long long) get_percentile(&stages[i], 99.9));
+    }
+}
+
+int main(int argc, const char* argv[]) {
+    size_t byte_count = DEFAULT_BENCH_BYTES;
+    const char* output_path = DEFAULT_BENCH_OUTPUT_PATH;
+    bool json = false;
+    enum output_mode output_mode = OUTPUT_MODE_WRITE;
+    enum chord_commit_mode commit_mode = COMMIT_ON_KEY;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--bytes=", 8) == 0) {
+            byte_count = strtoul(argv[i] + 8, nullptr, 10);
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output_path = argv[i] + 9;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            output_mode = OUTPUT_MODE_MMAP;
+        } else if (strcmp(argv[i], "--commit=release") == 0) {
+            commit_mode = COMMIT_ON_RELEASE;
+        } else {
+            fprintf(stderr, "Usage: %s [--bytes=N] [--output=FILE] [--json] [--mmap] [--commit=release]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (byte_count == 0) {
+        fprintf(stderr, "The number of bytes must be positive\n");
+        return 1;
+    }
+
+    // Every chord takes at most BITS_ARR_SIZE presses, BITS_ARR_SIZE releases and 2 SPACE events
+    struct input_event* events = malloc(byte_count * (2 * BITS_ARR_SIZE + 2) * sizeof(struct input_event));
+    if (events == nullptr) {
+        perror("Failed to allocate benchmark buffers");
+        return 1;
+    }
+    const size_t event_count = generate_events(events, byte_count, commit_mode);
+    struct stage_samples stages[STAGE_COUNT];
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stages[i] = (struct stage_samples) {.samples = malloc(event_count * sizeof(u_int64_t)), .count = 0};
+        if (stages[i].samples == nullptr) {
+            perror("Failed to allocate benchmark buffers");
+            return 1;
+        }
+    }
+
+    // Only the Output Engine of the session is set up: the events are fed to it directly, without an event loop
+    struct stenobyte_options options = default_stenobyte_options;
+    options.commit_mode = commit_mode;
+    prepare_stenobyte_session(&session, WRITER, &options);
+    setup_stenobyte_keymap(nullptr);
+    if (setup_output_engine(&session.output_engine, output_path, output_mode, FLUSH_ON_SIZE, DURABILITY_NONE, 0) != 0) {
+        return 1;
+    }
+
+    const u_int64_t elapsed_ns = run_throughput_pass(events, event_count);
+
+    // The latency pass commits the same chords again, so the output file is truncated first to hold them only once
+    end_output_engine(&session.output_engine);
+    if (setup_output_engine(&session.output_engine, output_path, output_mode, FLUSH_ON_SIZE, DURABILITY_NONE, 0) != 0) {
+        return 1;
+    }
+    run_latency_pass(events, event_count, stages);
+    end_output_engine(&session.output_engine);
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        qsort(stages[i].samples, stages[i].count, sizeof(u_int64_t), compare_samples);
+    }
+    print_results(json, event_count, byte_count * CHORD_WORD_SIZE, elapsed_ns, stages);
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        free(stages[i].samples);
+    }
+    free(events);
+    return 0;
+}
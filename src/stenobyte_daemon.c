@@ -0,0 +1,86 @@
+/**
+StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "../includes/StenoByte_Core.h"
+#include "../includes/StenoByte_Daemon.h"
+
+// Everything the daemon owns while it runs
+static struct stenobyte_daemon daemon_state;
+
+/*
+ * Signal handler for SIGINT & SIGTERM so that the daemon exits through the normal clean-up path
+ */
+static void handle_stop_signal(const int signal_number) {
+    (void) signal_number;
+    stop_daemon(&daemon_state);
+}
+
+
+int main(int argc, const char* argv[]) {
+    const char* config_file_path = nullptr;
+    const char* control_socket_path = DEFAULT_DAEMON_CONTROL_PATH;
+    const char* keymap_file_path = nullptr;
+    int worker_count = DEFAULT_DAEMON_WORKERS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--config=", 9) == 0) {
+            config_file_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--control=", 10) == 0) {
+            control_socket_path = argv[i] + 10;
+        } else if (strncmp(argv[i], "--keymap=", 9) == 0) {
+            keymap_file_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--workers=", 10) == 0) {
+            worker_count = atoi(argv[i] + 10);
+        } else {
+            config_file_path = nullptr;
+            break;
+        }
+    }
+    if (config_file_path == nullptr || worker_count < 1 || worker_count > MAX_DAEMON_WORKERS) {
+        fprintf(stderr, "Usage: %s --config=FILE [--control=PATH] [--workers=1..%d] [--keymap=FILE]\n", argv[0],
+                MAX_DAEMON_WORKERS);
+        return 1;
+    }
+
+    // Every session shares the Keymap, which is loaded before any session is set up
+    if (setup_stenobyte_keymap(keymap_file_path) != 0) {
+        return 1;
+    }
+
+    // Ctrl+C or a kill request stops the workers rather than terminating without flushing the outputs
+    struct sigaction stop_action = {.sa_handler = handle_stop_signal};
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT, &stop_action, nullptr);
+    sigaction(SIGTERM, &stop_action, nullptr);
+
+    int result = setup_daemon(&daemon_state, config_file_path, control_socket_path);
+    if (result == 0) {
+        printf("Serving %d sessions with %d workers; control socket: %s\n", daemon_state.session_count,
+               worker_count, control_socket_path);
+        result = start_daemon_workers(&daemon_state, worker_count);
+        if (result != 0) {
+            stop_daemon(&daemon_state);
+        }
+        wait_for_daemon(&daemon_state);
+    }
+
+    // Flushes & closes every output, even when setting up failed part way
+    end_daemon(&daemon_state);
+
+    return result;
+}
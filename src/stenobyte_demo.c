@@ -18,18 +18,21 @@
 
 #include "../includes/StenoByte_Core.h"
 
+// Everything the app owns while it runs
+static struct stenobyte_session session;
 
-int main() {
+
+int main(int argc, const char* argv[]) {
     // Performs setup; exits app if there was an error while setting up
-    const int setup_result = setup_stenobyte_demo();
+    const int setup_result = setup_stenobyte_demo(&session, argc, argv);
     if (setup_result != 0) {
         return setup_result;
     }
 
     // Runs the loop
-    run_stenobyte();
+    run_stenobyte(&session);
 
     // Frees up Memory Safely
-    end_stenobyte();
+    end_stenobyte(&session);
     return 0;
 }
@@ -0,0 +1,275 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    stenobyte_encode.c converts bytes into hex, a canonical hexdump, base64 or a C array with the Encoders: either the
+    bytes of a file (such as a Writer's output file), or the bytes a replayed capture file commits, which it gets by
+    running a headless session over it.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "../includes/StenoByte_Core.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+// Number of bytes encoded at a time
+#define ENCODE_CHUNK_SIZE (1 << 20)
+
+// Most arguments passed on to the session that replays a capture file
+#define MAX_SESSION_ARGUMENTS 64
+
+struct encode_settings {
+    enum byte_encoding encoding;
+    const char* input_file_path;    // nullptr for stdin
+    const char* output_file_path;   // nullptr for stdout
+    bool scalar;    // Use the plain C kernels even when the CPU has SSSE3
+    bool bench;     // Report the encoding throughput on stderr
+    struct stenobyte_options options;   // Options of the session that replays a capture file, if --replay was given
+};
+
+// The bytes on their way through the encoder to the output
+struct encode_stream {
+    struct byte_encoder encoder;
+    int file_descriptor;
+    u_int8_t* pending;  // Bytes committed by the session, encoded once ENCODE_CHUNK_SIZE of them have been collected
+    size_t pending_count;
+    char* encoded;
+    u_int64_t bytes_encoded;
+    u_int64_t chars_written;
+    u_int64_t encoding_ns;  // Time spent in the encoder alone
+    bool failed;
+};
+
+// The session that replays a capture file
+static struct stenobyte_session session;
+
+/*
+ * Returns the current monotonic time in nanoseconds
+ */
+static u_int64_t now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u_int64_t) now.tv_sec * 1000000000ULL + (u_int64_t) now.tv_nsec;
+}
+
+/*
+ * Writes all of the chars to the output, retrying on interrupted and partial writes
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int write_encoded_chars(struct encode_stream* stream, const char* chars, const size_t count) {
+    size_t total = 0;
+    while (total < count) {
+        const ssize_t written = write(stream->file_descriptor, chars + total, count - total);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write encoded output");
+            stream->failed = true;
+            return 1;
+        }
+        total += (size_t) written;
+    }
+    stream->chars_written += count;
+    return 0;
+}
+
+/*
+ * Encodes up to ENCODE_CHUNK_SIZE bytes and writes them out
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int encode_chunk(struct encode_stream* stream, const u_int8_t* bytes, const size_t count) {
+    const u_int64_t start_ns = now_ns();
+    const size_t length = encode_bytes(&stream->encoder, bytes, count, stream->encoded);
+    stream->encoding_ns += now_ns() - start_ns;
+    stream->bytes_encoded += count;
+    return write_encoded_chars(stream, stream->encoded, length);
+}
+
+/*
+ * Byte Sink of the replaying session: collects the committed bytes so that they are encoded a chunk at a time
+ */
+static int collect_committed_byte(void* context, const u_int8_t byte) {
+    struct encode_stream* stream = context;
+    stream->pending[stream->pending_count++] = byte;
+    if (stream->pending_count == ENCODE_CHUNK_SIZE) {
+        stream->pending_count = 0;
+        return encode_chunk(stream, stream->pending, ENCODE_CHUNK_SIZE);
+    }
+    return 0;
+}
+
+/*
+ * Encodes every byte of a file, or of stdin
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int encode_input_file(struct encode_stream* stream, const char* input_file_path) {
+    const int input_file_descriptor = input_file_path != nullptr ? open(input_file_path, O_RDONLY | O_CLOEXEC)
+                                                                 : STDIN_FILENO;
+    if (input_file_descriptor < 0) {
+        perror("Failed to open input file");
+        return 1;
+    }
+    posix_fadvise(input_file_descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    int result = 0;
+    while (result == 0) {
+        const ssize_t bytes_read = read(input_file_descriptor, stream->pending, ENCODE_CHUNK_SIZE);
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to read input file");
+            result = 1;
+        } else if (bytes_read == 0) {
+            break;
+        } else {
+            result = encode_chunk(stream, stream->pending, (size_t) bytes_read);
+        }
+    }
+    if (input_file_path != nullptr) {
+        close(input_file_descriptor);
+    }
+    return result;
+}
+
+/*
+ * Encodes the bytes committed by a headless session that replays a capture file. Everything the session prints goes to
+ * stderr, so that the output only ever holds the encoded bytes.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int encode_replayed_session(struct encode_stream* stream, struct stenobyte_options* options) {
+    options->output_file_path = nullptr;
+    options->headless = true;
+    if (setup_stenobyte_keymap(options->keymap_file_path) != 0) {
+        return 1;
+    }
+    options->keymap_file_path = nullptr;
+    if (setup_stenobyte_session(&session, WRITER, options) != 0) {
+        end_stenobyte(&session);
+        return 1;
+    }
+    set_stenobyte_byte_sink(&session, collect_committed_byte, stream);
+    run_stenobyte(&session);
+    end_stenobyte(&session);
+
+    if (stream->failed) {
+        return 1;
+    }
+    return stream->pending_count > 0 ? encode_chunk(stream, stream->pending, stream->pending_count) : 0;
+}
+
+/*
+ * Parses the command line arguments into settings. Arguments the converter does not know are options of the session
+ * that replays a capture file.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int parse_encode_settings(struct encode_settings* settings, const int argc, const char* argv[]) {
+    *settings = (struct encode_settings) {.encoding = ENCODING_HEX};
+
+    const char* session_arguments[MAX_SESSION_ARGUMENTS] = {argv[0]};
+    int session_argument_count = 1;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        if (strncmp(argv[i], "--format=", 9) == 0) {
+            valid = parse_byte_encoding(argv[i] + 9, &settings->encoding) == 0;
+        } else if (strncmp(argv[i], "--input=", 8) == 0) {
+            settings->input_file_path = argv[i] + 8;
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            settings->output_file_path = argv[i] + 9;
+        } else if (strcmp(argv[i], "--scalar") == 0) {
+            settings->scalar = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            settings->bench = true;
+        } else if (strncmp(argv[i], "--", 2) == 0 && session_argument_count < MAX_SESSION_ARGUMENTS) {
+            session_arguments[session_argument_count++] = argv[i];
+        } else {
+            valid = false;
+        }
+    }
+
+    if (!valid || parse_stenobyte_options(&settings->options, session_argument_count, session_arguments) != 0 ||
+        (settings->input_file_path != nullptr && settings->options.replay_file_path != nullptr)) {
+        fprintf(stderr, "Usage: %s [--format=hex|hexdump|base64|c|raw] [--input=FILE | --replay=CAPTURE_FILE]\n"
+                        "       [--output=FILE] [--scalar] [--bench] [SESSION_OPTIONS]\n"
+                        "Encodes a file (stdin by default), or the bytes a replayed capture file commits (with the\n"
+                        "session options, such as --dictionary=FILE), into the format (default: hex) on stdout.\n",
+                argv[0]);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, const char* argv[]) {
+    struct encode_settings settings;
+    if (parse_encode_settings(&settings, argc, argv) != 0) {
+        return 1;
+    }
+    use_scalar_encoder_kernels(settings.scalar);
+
+    struct encode_stream stream = {.file_descriptor = STDOUT_FILENO};
+    if (settings.output_file_path != nullptr) {
+        stream.file_descriptor = open(settings.output_file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (stream.file_descriptor < 0) {
+            perror("Failed to open output file");
+            return 1;
+        }
+    } else if (settings.options.replay_file_path != nullptr) {
+        // Keeps stdout for the encoded bytes alone; what the session prints goes to stderr instead
+        stream.file_descriptor = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+        if (stream.file_descriptor < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            perror("Failed to reserve stdout");
+            return 1;
+        }
+    }
+
+    setup_byte_encoder(&stream.encoder, settings.encoding);
+    stream.pending = malloc(ENCODE_CHUNK_SIZE);
+    stream.encoded = malloc(get_encoded_size_bound(settings.encoding, ENCODE_CHUNK_SIZE));
+    int result = 1;
+    if (stream.pending == nullptr || stream.encoded == nullptr) {
+        perror("Failed to allocate encoding buffers");
+    } else {
+        result = settings.options.replay_file_path != nullptr ? encode_replayed_session(&stream, &settings.options)
+                                                              : encode_input_file(&stream, settings.input_file_path);
+    }
+    if (result == 0) {
+        char tail[ENCODER_TAIL_SIZE];
+        const size_t length = finish_byte_encoder(&stream.encoder, tail);
+        result = write_encoded_chars(&stream, tail, length);
+    }
+
+    if (settings.bench) {
+        const double seconds = (double) stream.encoding_ns / 1e9;
+        fprintf(stderr, "Encoded %llu bytes into %llu chars as %s with the %s kernels in %.3f s (%.1f MB/s)\n",
+                (unsigned long long) stream.bytes_encoded, (unsigned long long) stream.chars_written,
+                get_byte_encoding_name(settings.encoding), get_encoder_kernel_name(), seconds,
+                seconds > 0 ? (double) stream.bytes_encoded / seconds / 1e6 : 0.0);
+    }
+
+    free(stream.pending);
+    free(stream.encoded);
+    if (stream.file_descriptor != STDOUT_FILENO && close(stream.file_descriptor) != 0) {
+        perror("Failed to close output file");
+        result = 1;
+    }
+    return result;
+}
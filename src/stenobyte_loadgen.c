@@ -0,0 +1,612 @@
+/**
+    StenoByte: a stenotype inspired keyboard app for typing out bytes.
+
+    stenobyte_loadgen.c creates a virtual keyboard with uinput, types scripted or random chords on it at a steady rate
+    into a running StenoByte Writer, and matches them against the bytes that appear in the Writer's output file to
+    report the key-to-file latency and any bytes that were lost or corrupted.
+
+    Copyright 2025 Asami De Almeida
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "../includes/StenoByte_Core.h"
+
+#include <libevdev/libevdev-uinput.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
+
+// Name of the virtual keyboard, as the Writer reports it when it is attached
+#define LOADGEN_DEVICE_NAME "StenoByte Load Generator"
+
+// Default number of chords typed in each pass, and how many are typed per second
+#define DEFAULT_LOADGEN_CHORDS 1000
+#define DEFAULT_LOADGEN_RATE 20.0
+
+// Default time the Writer is given to attach the virtual keyboard before the first chord
+#define DEFAULT_LOADGEN_SETTLE_MS 1000
+
+// Default time the last bytes of a pass are waited for after its last chord
+#define DEFAULT_LOADGEN_DRAIN_MS 2000
+
+// Number of expected bytes a received byte may skip over, counting them as lost, to find the byte it matches
+#define LOADGEN_MATCH_WINDOW 8
+
+// Size of the reads from the output file
+#define LOADGEN_READ_SIZE 4096
+
+struct loadgen_settings {
+    const char* output_file_path;   // The output file of the Writer under test
+    const char* keymap_file_path;
+    const char* text;   // Bytes to type out, instead of random ones
+    const char* script_file_path;   // File whose bytes are typed out, instead of random ones
+    size_t chord_count; // 0 for one pass through the text or script
+    double rate;    // Chords per second
+    double sweep_to;    // If above rate, the rate is raised by sweep_step after every pass without errors up to this
+    double sweep_step;
+    u_int32_t seed;
+    enum chord_commit_mode commit_mode;
+    enum chord_byte_order byte_order;
+    int settle_ms;
+    int drain_ms;
+    bool json;
+};
+
+// The uinput device the chords are typed on, with the keys the Keymap uses
+struct virtual_keyboard {
+    struct libevdev* device;
+    struct libevdev_uinput* uinput;
+    int bit_key_codes[BITS_ARR_SIZE];
+    int commit_key_code;
+};
+
+// The bytes a pass expects in the output file, and what has been matched so far
+struct loadgen_pass {
+    double rate;
+    size_t chord_count;
+    chord_word* words;
+    u_int64_t* injected_ns; // When each chord's commit event was written to the virtual keyboard
+    u_int8_t* expected; // CHORD_WORD_SIZE bytes for each chord
+    size_t expected_count;
+    size_t injected_bytes;  // Bytes of the chords typed so far, which are the only ones that may be matched
+    size_t next_expected;   // The first expected byte not matched yet
+    u_int64_t* latencies_ns;    // Key-to-file latency of each matched byte
+    size_t latency_count;
+    size_t bytes_received;
+    size_t bytes_lost;
+    size_t bytes_corrupted;
+    u_int64_t max_lag_ns;   // Furthest the typing fell behind its schedule
+    u_int64_t elapsed_ns;   // From the first chord to the last one
+};
+
+/*
+ * Returns the current monotonic time in nanoseconds
+ */
+static u_int64_t now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u_int64_t) now.tv_sec * 1000000000ULL + (u_int64_t) now.tv_nsec;
+}
+
+static int compare_latencies(const void* a, const void* b) {
+    const u_int64_t left = *(const u_int64_t*) a;
+    const u_int64_t right = *(const u_int64_t*) b;
+    return (left > right) - (left < right);
+}
+
+/*
+ * Returns the latency at the given percentile of a pass, once its latencies are sorted
+ */
+static u_int64_t get_pass_percentile(const struct loadgen_pass* pass, const double percentile) {
+    if (pass->latency_count == 0) {
+        return 0;
+    }
+    size_t index = (size_t) (percentile / 100.0 * (double) pass->latency_count);
+    if (index >= pass->latency_count) {
+        index = pass->latency_count - 1;
+    }
+    return pass->latencies_ns[index];
+}
+
+/*
+ * Creates the virtual keyboard with every key of the Keymap, and finds the key of each bit and the commit key
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int setup_virtual_keyboard(struct virtual_keyboard* keyboard) {
+    keyboard->commit_key_code = -1;
+    for (int i = 0; i < BITS_ARR_SIZE; i++) {
+        keyboard->bit_key_codes[i] = -1;
+    }
+
+    keyboard->device = libevdev_new();
+    if (keyboard->device == nullptr) {
+        perror("Failed to create the virtual keyboard");
+        return 1;
+    }
+    libevdev_set_name(keyboard->device, LOADGEN_DEVICE_NAME);
+    libevdev_enable_event_type(keyboard->device, EV_KEY);
+    for (unsigned int key_code = 0; key_code < KEYMAP_SIZE; key_code++) {
+        const struct keymap_entry entry = keymap[key_code];
+        if (entry.action == KEY_ACTION_NONE) {
+            continue;
+        }
+        libevdev_enable_event_code(keyboard->device, EV_KEY, key_code, nullptr);
+        if (entry.action == KEY_ACTION_BIT && keyboard->bit_key_codes[entry.bit_index] < 0) {
+            keyboard->bit_key_codes[entry.bit_index] = (int) key_code;
+        } else if (entry.action == KEY_ACTION_COMMIT && keyboard->commit_key_code < 0) {
+            keyboard->commit_key_code = (int) key_code;
+        }
+    }
+
+    for (int i = 0; i < BITS_ARR_SIZE; i++) {
+        if (keyboard->bit_key_codes[i] < 0) {
+            fprintf(stderr, "The Keymap has no key for b%d\n", i);
+            return 1;
+        }
+    }
+    if (keyboard->commit_key_code < 0) {
+        fprintf(stderr, "The Keymap has no commit key\n");
+        return 1;
+    }
+
+    const int result = libevdev_uinput_create_from_device(keyboard->device, LIBEVDEV_UINPUT_OPEN_MANAGED,
+                                                          &keyboard->uinput);
+    if (result < 0) {
+        errno = -result;
+        perror("Failed to create the virtual keyboard (is /dev/uinput writable?)");
+        keyboard->uinput = nullptr;
+        return 1;
+    }
+    fprintf(stderr, "Virtual keyboard created: %s\n", libevdev_uinput_get_devnode(keyboard->uinput));
+    return 0;
+}
+
+/*
+ * Destroys the virtual keyboard, which the Writer sees as being unplugged
+ */
+static void end_virtual_keyboard(struct virtual_keyboard* keyboard) {
+    if (keyboard->uinput != nullptr) {
+        libevdev_uinput_destroy(keyboard->uinput);
+        keyboard->uinput = nullptr;
+    }
+    if (keyboard->device != nullptr) {
+        libevdev_free(keyboard->device);
+        keyboard->device = nullptr;
+    }
+}
+
+/*
+ * Presses or releases a key of the virtual keyboard, in a report of its own as a real keyboard sends it
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int write_virtual_key(const struct virtual_keyboard* keyboard, const int key_code, const int value) {
+    return libevdev_uinput_write_event(keyboard->uinput, EV_KEY, (unsigned int) key_code, value) < 0 ||
+           libevdev_uinput_write_event(keyboard->uinput, EV_SYN, SYN_REPORT, 0) < 0;
+}
+
+/*
+ * Types a chord on the virtual keyboard: with COMMIT_ON_KEY, press its keys, press & release the commit key, then
+ * release its keys; with COMMIT_ON_RELEASE, press & release its keys (the commit key alone for 0x00)
+ *
+ * Returns when the event that commits the chord was written, in nanoseconds, or 0 if there were errors
+ */
+static u_int64_t type_chord(const struct virtual_keyboard* keyboard, const chord_word word,
+                            const enum chord_commit_mode commit_mode) {
+    int errors = 0;
+    u_int64_t commit_ns = 0;
+
+    for (int bit = 0; bit < BITS_ARR_SIZE; bit++) {
+        if (word >> bit & 1) {
+            errors |= write_virtual_key(keyboard, keyboard->bit_key_codes[bit], EV_KEY_PRESSED);
+        }
+    }
+    if (commit_mode == COMMIT_ON_KEY || word == 0x00) {
+        errors |= write_virtual_key(keyboard, keyboard->commit_key_code, EV_KEY_PRESSED);
+        commit_ns = now_ns();
+        errors |= write_virtual_key(keyboard, keyboard->commit_key_code, EV_KEY_RELEASED);
+    }
+    for (int bit = 0; bit < BITS_ARR_SIZE; bit++) {
+        if (word >> bit & 1) {
+            errors |= write_virtual_key(keyboard, keyboard->bit_key_codes[bit], EV_KEY_RELEASED);
+        }
+    }
+    if (commit_ns == 0) {
+        commit_ns = now_ns();
+    }
+    return errors ? 0 : commit_ns;
+}
+
+/*
+ * Reads a whole file into memory
+ *
+ * Returns the contents, or nullptr if there were errors
+ */
+static u_int8_t* read_script_file(const char* script_file_path, size_t* length) {
+    FILE* script_file = fopen(script_file_path, "rb");
+    if (script_file == nullptr) {
+        perror("Failed to open script file");
+        return nullptr;
+    }
+    u_int8_t* contents = nullptr;
+    size_t capacity = 0;
+    *length = 0;
+    while (true) {
+        if (*length == capacity) {
+            capacity = capacity > 0 ? capacity * 2 : LOADGEN_READ_SIZE;
+            u_int8_t* grown = realloc(contents, capacity);
+            if (grown == nullptr) {
+                perror("Failed to allocate script");
+                free(contents);
+                fclose(script_file);
+                return nullptr;
+            }
+            contents = grown;
+        }
+        const size_t bytes_read = fread(contents + *length, 1, capacity - *length, script_file);
+        if (bytes_read == 0) {
+            break;
+        }
+        *length += bytes_read;
+    }
+    fclose(script_file);
+    return contents;
+}
+
+/*
+ * Sets up a pass: the chords to type, from the script (taken CHORD_WORD_SIZE bytes at a time in the byte order, and
+ * repeated if more chords are wanted than it holds) or pseudo-random, and the bytes they should write out
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int setup_loadgen_pass(struct loadgen_pass* pass, const struct loadgen_settings* settings,
+                              const u_int8_t* script, const size_t script_length, const double rate) {
+    memset(pass, 0, sizeof(*pass));
+    pass->rate = rate;
+    pass->chord_count = settings->chord_count;
+    if (pass->chord_count == 0) {
+        pass->chord_count = script != nullptr ? (script_length + CHORD_WORD_SIZE - 1) / CHORD_WORD_SIZE
+                                              : DEFAULT_LOADGEN_CHORDS;
+    }
+    pass->expected_count = pass->chord_count * CHORD_WORD_SIZE;
+    pass->words = malloc(pass->chord_count * sizeof(chord_word));
+    pass->injected_ns = malloc(pass->chord_count * sizeof(u_int64_t));
+    pass->expected = malloc(pass->expected_count);
+    pass->latencies_ns = malloc(pass->expected_count * sizeof(u_int64_t));
+    if (pass->words == nullptr || pass->injected_ns == nullptr || pass->expected == nullptr ||
+        pass->latencies_ns == nullptr) {
+        perror("Failed to allocate load generator buffers");
+        return 1;
+    }
+
+    u_int32_t random_state = settings->seed;
+    for (size_t i = 0; i < pass->chord_count; i++) {
+        unsigned int word = 0;
+        if (script != nullptr) {
+            for (int byte = 0; byte < CHORD_WORD_SIZE; byte++) {
+                const size_t position = (i * CHORD_WORD_SIZE + (size_t) byte) % script_length;
+                const int shift = 8 * (settings->byte_order == CHORD_BIG_ENDIAN ? CHORD_WORD_SIZE - 1 - byte : byte);
+                word |= (unsigned int) script[position] << shift;
+            }
+        } else {
+            random_state = random_state * 1664525u + 1013904223u;
+            word = random_state >> (32 - BITS_ARR_SIZE);
+        }
+        pass->words[i] = (chord_word) (word & (CHORD_WORD_COUNT - 1));
+        get_chord_word_bytes(pass->words[i], settings->byte_order, pass->expected + i * CHORD_WORD_SIZE);
+    }
+    return 0;
+}
+
+static void end_loadgen_pass(struct loadgen_pass* pass) {
+    free(pass->words);
+    free(pass->injected_ns);
+    free(pass->expected);
+    free(pass->latencies_ns);
+    memset(pass, 0, sizeof(*pass));
+}
+
+/*
+ * Matches a byte that appeared in the output file against the bytes expected so far. Expected bytes it skips over to
+ * find its match are lost; a byte that matches none of the next LOADGEN_MATCH_WINDOW is corrupted, and takes the
+ * place of the next expected byte.
+ */
+static void match_output_byte(struct loadgen_pass* pass, const u_int8_t byte, const u_int64_t received_ns) {
+    pass->bytes_received++;
+    const size_t window_end = pass->next_expected + LOADGEN_MATCH_WINDOW < pass->injected_bytes
+                                  ? pass->next_expected + LOADGEN_MATCH_WINDOW
+                                  : pass->injected_bytes;
+    for (size_t position = pass->next_expected; position < window_end; position++) {
+        if (pass->expected[position] == byte) {
+            pass->bytes_lost += position - pass->next_expected;
+            pass->latencies_ns[pass->latency_count++] = received_ns - pass->injected_ns[position / CHORD_WORD_SIZE];
+            pass->next_expected = position + 1;
+            return;
+        }
+    }
+    pass->bytes_corrupted++;
+    if (pass->next_expected < pass->injected_bytes) {
+        pass->next_expected++;
+    }
+}
+
+/*
+ * Reads whatever the Writer has added to its output file since the last read, and matches it
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int read_output_file(struct loadgen_pass* pass, const int output_file_descriptor) {
+    u_int8_t buffer[LOADGEN_READ_SIZE];
+    ssize_t bytes_read;
+    while ((bytes_read = read(output_file_descriptor, buffer, sizeof(buffer))) > 0) {
+        const u_int64_t received_ns = now_ns();
+        for (ssize_t i = 0; i < bytes_read; i++) {
+            match_output_byte(pass, buffer[i], received_ns);
+        }
+    }
+    if (bytes_read < 0 && errno != EINTR) {
+        perror("Failed to read the output file");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Types the chords of a pass at its rate, reading the output file whenever the Writer modifies it in between, then
+ * waits up to drain_ms for the bytes of the last chords. Only what the Writer writes after the pass starts is read.
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int run_loadgen_pass(struct loadgen_pass* pass, const struct loadgen_settings* settings,
+                            const struct virtual_keyboard* keyboard, const int output_file_descriptor,
+                            const int epoll_file_descriptor, const int watch_file_descriptor) {
+    if (lseek(output_file_descriptor, 0, SEEK_END) < 0) {
+        perror("Failed to seek to the end of the output file");
+        return 1;
+    }
+
+    const u_int64_t period_ns = (u_int64_t) (1e9 / pass->rate);
+    const u_int64_t start_ns = now_ns();
+    u_int64_t deadline_ns = 0;
+    size_t typed = 0;
+
+    while (typed < pass->chord_count || (pass->next_expected < pass->expected_count && now_ns() < deadline_ns)) {
+        u_int64_t current_ns = now_ns();
+        if (typed < pass->chord_count && current_ns >= start_ns + typed * period_ns) {
+            const u_int64_t lag_ns = current_ns - (start_ns + typed * period_ns);
+            pass->max_lag_ns = lag_ns > pass->max_lag_ns ? lag_ns : pass->max_lag_ns;
+            pass->injected_ns[typed] = type_chord(keyboard, pass->words[typed], settings->commit_mode);
+            if (pass->injected_ns[typed] == 0) {
+                fprintf(stderr, "Failed to type on the virtual keyboard\n");
+                return 1;
+            }
+            typed++;
+            pass->injected_bytes = typed * CHORD_WORD_SIZE;
+            if (typed == pass->chord_count) {
+                pass->elapsed_ns = now_ns() - start_ns;
+                deadline_ns = now_ns() + (u_int64_t) settings->drain_ms * 1000000u;
+            }
+            continue;
+        }
+
+        // Sleeps until the next chord is due, or the Writer modifies the output file
+        current_ns = now_ns();
+        const u_int64_t wake_ns = typed < pass->chord_count ? start_ns + typed * period_ns : deadline_ns;
+        const int timeout_ms = wake_ns > current_ns ? (int) ((wake_ns - current_ns) / 1000000u) : 0;
+        struct epoll_event ready_event;
+        if (epoll_wait(epoll_file_descriptor, &ready_event, 1, timeout_ms) > 0) {
+            char events[sizeof(struct inotify_event) + NAME_MAX + 1];
+            while (read(watch_file_descriptor, events, sizeof(events)) > 0) {}
+        }
+        if (read_output_file(pass, output_file_descriptor) != 0) {
+            return 1;
+        }
+    }
+
+    if (read_output_file(pass, output_file_descriptor) != 0) {
+        return 1;
+    }
+    pass->bytes_lost += pass->expected_count - pass->next_expected;
+    qsort(pass->latencies_ns, pass->latency_count, sizeof(u_int64_t), compare_latencies);
+    return 0;
+}
+
+/*
+ * Prints the results of a pass as text or as a JSON object
+ */
+static void print_loadgen_pass(const struct loadgen_pass* pass, const bool json) {
+    const double achieved_rate = pass->elapsed_ns > 0 && pass->chord_count > 1
+                                     ? (double) (pass->chord_count - 1) / ((double) pass->elapsed_ns / 1e9)
+                                     : 0.0;
+    if (json) {
+        printf("{\"rate\": %.1f, \"achieved_rate\": %.1f, \"chords\": %zu, \"bytes_expected\": %zu, "
+               "\"bytes_received\": %zu, \"bytes_lost\": %zu, \"bytes_corrupted\": %zu, \"max_lag_ns\": %llu, "
+               "\"latency\": {\"samples\": %zu, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, "
+               "\"p999_ns\": %llu, \"max_ns\": %llu}}",
+               pass->rate, achieved_rate, pass->chord_count, pass->expected_count, pass->bytes_received,
+               pass->bytes_lost, pass->bytes_corrupted, (unsigned long long) pass->max_lag_ns, pass->latency_count,
+               (unsigned long long) get_pass_percentile(pass, 50.0),
+               (unsigned long long) get_pass_percentile(pass, 90.0),
+               (unsigned long long) get_pass_percentile(pass, 99.0),
+               (unsigned long long) get_pass_percentile(pass, 99.9),
+               (unsigned long long) get_pass_percentile(pass, 100.0));
+        return;
+    }
+
+    printf("Rate: %.1f chords/s (achieved %.1f, fell behind by up to %.3f ms)\n", pass->rate, achieved_rate,
+           (double) pass->max_lag_ns / 1e6);
+    printf("Chords: %zu\tBytes expected: %zu\treceived: %zu\tlost: %zu\tcorrupted: %zu\n", pass->chord_count,
+           pass->expected_count, pass->bytes_received, pass->bytes_lost, pass->bytes_corrupted);
+    printf("Key-to-file latency (us): p50 %.1f\tp90 %.1f\tp99 %.1f\tp999 %.1f\tmax %.1f\n\n",
+           (double) get_pass_percentile(pass, 50.0) / 1e3, (double) get_pass_percentile(pass, 90.0) / 1e3,
+           (double) get_pass_percentile(pass, 99.0) / 1e3, (double) get_pass_percentile(pass, 99.9) / 1e3,
+           (double) get_pass_percentile(pass, 100.0) / 1e3);
+}
+
+/*
+ * Parses the command line arguments into settings
+ *
+ * Returns 0 if there were no errors, 1 if there were errors
+ */
+static int parse_loadgen_settings(struct loadgen_settings* settings, const int argc, const char* argv[]) {
+    *settings = (struct loadgen_settings) {
+        .rate = DEFAULT_LOADGEN_RATE, .seed = 0x5EB0B17E, .commit_mode = COMMIT_ON_KEY,
+        .byte_order = CHORD_LITTLE_ENDIAN, .settle_ms = DEFAULT_LOADGEN_SETTLE_MS, .drain_ms = DEFAULT_LOADGEN_DRAIN_MS
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--output=", 9) == 0) {
+            settings->output_file_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--chords=", 9) == 0) {
+            settings->chord_count = strtoul(argv[i] + 9, nullptr, 10);
+        } else if (strncmp(argv[i], "--rate=", 7) == 0) {
+            settings->rate = strtod(argv[i] + 7, nullptr);
+        } else if (strncmp(argv[i], "--sweep=", 8) == 0) {
+            char* end;
+            settings->sweep_to = strtod(argv[i] + 8, &end);
+            settings->sweep_step = *end == ':' ? strtod(end + 1, nullptr) : 0.0;
+        } else if (strncmp(argv[i], "--text=", 7) == 0) {
+            settings->text = argv[i] + 7;
+        } else if (strncmp(argv[i], "--script=", 9) == 0) {
+            settings->script_file_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            settings->seed = (u_int32_t) strtoul(argv[i] + 7, nullptr, 0);
+        } else if (strncmp(argv[i], "--keymap=", 9) == 0) {
+            settings->keymap_file_path = argv[i] + 9;
+        } else if (strcmp(argv[i], "--commit=key") == 0) {
+            settings->commit_mode = COMMIT_ON_KEY;
+        } else if (strcmp(argv[i], "--commit=release") == 0) {
+            settings->commit_mode = COMMIT_ON_RELEASE;
+        } else if (strcmp(argv[i], "--byte-order=little") == 0) {
+            settings->byte_order = CHORD_LITTLE_ENDIAN;
+        } else if (strcmp(argv[i], "--byte-order=big") == 0) {
+            settings->byte_order = CHORD_BIG_ENDIAN;
+        } else if (strncmp(argv[i], "--settle=", 9) == 0) {
+            settings->settle_ms = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--drain=", 8) == 0) {
+            settings->drain_ms = atoi(argv[i] + 8);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            settings->json = true;
+        } else {
+            settings->output_file_path = nullptr;
+            break;
+        }
+    }
+
+    if (settings->output_file_path == nullptr || settings->rate <= 0.0 || settings->settle_ms < 0 ||
+        settings->drain_ms < 0 || (settings->sweep_to > 0.0 && settings->sweep_step <= 0.0)) {
+        fprintf(stderr, "Usage: %s --output=FILE [--rate=CHORDS_PER_S] [--chords=N] [--sweep=MAX_RATE:STEP]\n"
+                        "       [--text=STRING | --script=FILE | --seed=N] [--keymap=FILE] [--commit=key|release]\n"
+                        "       [--byte-order=little|big] [--settle=MS] [--drain=MS] [--json]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, const char* argv[]) {
+    struct loadgen_settings settings;
+    if (parse_loadgen_settings(&settings, argc, argv) != 0) {
+        return 1;
+    }
+    if (settings.keymap_file_path != nullptr && load_keymap_file(settings.keymap_file_path, BITS_ARR_SIZE) != 0) {
+        return 1;
+    }
+
+    // The bytes to type out, if they are not random
+    u_int8_t* script = nullptr;
+    size_t script_length = 0;
+    if (settings.script_file_path != nullptr) {
+        script = read_script_file(settings.script_file_path, &script_length);
+        if (script == nullptr) {
+            return 1;
+        }
+    } else if (settings.text != nullptr) {
+        script_length = strlen(settings.text);
+        script = (u_int8_t*) strdup(settings.text);
+    }
+    if (script != nullptr && script_length == 0) {
+        fprintf(stderr, "There is nothing to type\n");
+        free(script);
+        return 1;
+    }
+
+    // The Writer must already be running, so that every byte it writes from now on can be read back
+    const int output_file_descriptor = open(settings.output_file_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (output_file_descriptor < 0) {
+        perror("Failed to open the output file (start StenoByte_Writer with --flush=byte first)");
+        free(script);
+        return 1;
+    }
+    const int watch_file_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    const int epoll_file_descriptor = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event watch_event = {.events = EPOLLIN, .data.fd = watch_file_descriptor};
+    if (watch_file_descriptor < 0 || epoll_file_descriptor < 0 ||
+        inotify_add_watch(watch_file_descriptor, settings.output_file_path, IN_MODIFY) < 0 ||
+        epoll_ctl(epoll_file_descriptor, EPOLL_CTL_ADD, watch_file_descriptor, &watch_event) < 0) {
+        perror("Failed to watch the output file");
+        free(script);
+        return 1;
+    }
+
+    struct virtual_keyboard keyboard = {0};
+    int result = setup_virtual_keyboard(&keyboard);
+    if (result == 0) {
+        // Gives the Writer time to find the new keyboard before typing on it
+        usleep((useconds_t) settings.settle_ms * 1000u);
+    }
+
+    // Runs one pass, or raises the rate after every pass without lost or corrupted bytes
+    double highest_clean_rate = 0.0;
+    const bool sweeping = settings.sweep_to > settings.rate;
+    if (settings.json && result == 0) {
+        printf("{\"passes\": [");
+    }
+    for (double rate = settings.rate; result == 0 && rate <= (sweeping ? settings.sweep_to : settings.rate);
+         rate += sweeping ? settings.sweep_step : 1.0) {
+        struct loadgen_pass pass;
+        result = setup_loadgen_pass(&pass, &settings, script, script_length, rate);
+        if (result == 0) {
+            result = run_loadgen_pass(&pass, &settings, &keyboard, output_file_descriptor, epoll_file_descriptor,
+                                      watch_file_descriptor);
+        }
+        if (result == 0) {
+            if (settings.json) {
+                printf("%s", rate > settings.rate ? ", " : "");
+            }
+            print_loadgen_pass(&pass, settings.json);
+            fflush(stdout);
+        }
+        const bool clean = pass.bytes_lost == 0 && pass.bytes_corrupted == 0;
+        end_loadgen_pass(&pass);
+        if (!clean) {
+            break;
+        }
+        highest_clean_rate = rate;
+    }
+    if (result == 0) {
+        if (settings.json) {
+            printf("], \"highest_clean_rate\": %.1f}\n", highest_clean_rate);
+        } else if (sweeping) {
+            printf("Highest rate without lost or corrupted bytes: %.1f chords/s\n", highest_clean_rate);
+        }
+    }
+
+    end_virtual_keyboard(&keyboard);
+    close(epoll_file_descriptor);
+    close(watch_file_descriptor);
+    close(output_file_descriptor);
+    free(script);
+    return result;
+}
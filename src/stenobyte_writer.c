@@ -18,22 +18,25 @@ StenoByte: a stenotype inspired keyboard app for typing out bytes.
 
 #include "../includes/StenoByte_Core.h"
 
+// Everything the app owns while it runs
+static struct stenobyte_session session;
+
 
 int main(int argc, const char* argv[]) {
 
     // fprintf(output_file_ptr, "Some Text 123!\n");
 
     // Performs setup; exits app if there was an error while setting up
-    const int setup_result = setup_stenobyte_writer(argc, argv);
+    const int setup_result = setup_stenobyte_writer(&session, argc, argv);
     if (setup_result != 0) {
         return setup_result;
     }
 
     // Runs the loop
-    run_stenobyte();
+    run_stenobyte(&session);
 
     // Frees up Memory Safely & Closes the File
-    end_stenobyte_writer();
+    end_stenobyte_writer(&session);
 
     return 0;
 }